@@ -0,0 +1,221 @@
+#ifndef BLOCKINGQUEUE_H
+#define BLOCKINGQUEUE_H
+
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+
+// 多生产者、多消费者的有界队列，所有操作共用一把锁，队列满/空时通过条件变量唤醒等待的线程
+// capacity 为 0 表示不限长度；push/pop 在队列满/空时阻塞，tryPush/tryPop 不阻塞或最多等待 timeout 毫秒
+// close 之后不能再入队，已入队的元素仍可取出，取完后 pop 返回 false，阻塞中的线程全部唤醒
+template <class T>
+class BlockingQueue
+{
+public:
+    explicit BlockingQueue(int capacity = 0) : _capacity(capacity) {};
+
+    bool push(const T &data);
+    bool tryPush(const T &data, int timeout = 0);
+    bool pop(T *data = nullptr);
+    bool tryPop(T *data = nullptr, int timeout = 0);
+
+    int count() const;
+    bool isEmpty() const;
+    bool isFull() const;
+    void clear();
+
+    int capacity() const;
+    void setCapacity(int capacity);
+
+    void close();
+    bool isClosed() const;
+
+private:
+    int _capacity;
+    bool _closed = false;
+    QList<T> _list;
+    mutable QMutex _mutex;
+    QWaitCondition _notEmpty;
+    QWaitCondition _notFull;
+
+    bool _isFull() const;
+    bool _wait(QWaitCondition &condition, QElapsedTimer &timer, int timeout);
+    void _take(T *data);
+
+    Q_DISABLE_COPY(BlockingQueue)
+};
+
+template <class T>
+bool BlockingQueue<T>::push(const T &data)
+{
+    QMutexLocker locker(&_mutex);
+
+    while (!_closed && _isFull()) _notFull.wait(&_mutex);
+
+    if (_closed) return false;
+
+    _list.push_back(data);
+
+    _notEmpty.wakeOne();
+
+    return true;
+}
+
+template <class T>
+bool BlockingQueue<T>::tryPush(const T &data, int timeout)
+{
+    QMutexLocker locker(&_mutex);
+    QElapsedTimer timer;
+
+    timer.start();
+
+    while (!_closed && _isFull())
+    {
+        if (!_wait(_notFull, timer, timeout)) return false;
+    }
+
+    if (_closed) return false;
+
+    _list.push_back(data);
+
+    _notEmpty.wakeOne();
+
+    return true;
+}
+
+template <class T>
+bool BlockingQueue<T>::pop(T *data)
+{
+    QMutexLocker locker(&_mutex);
+
+    while (!_closed && _list.isEmpty()) _notEmpty.wait(&_mutex);
+
+    if (_list.isEmpty()) return false;
+
+    _take(data);
+
+    return true;
+}
+
+template <class T>
+bool BlockingQueue<T>::tryPop(T *data, int timeout)
+{
+    QMutexLocker locker(&_mutex);
+    QElapsedTimer timer;
+
+    timer.start();
+
+    while (!_closed && _list.isEmpty())
+    {
+        if (!_wait(_notEmpty, timer, timeout)) return false;
+    }
+
+    if (_list.isEmpty()) return false;
+
+    _take(data);
+
+    return true;
+}
+
+template <class T>
+int BlockingQueue<T>::count() const
+{
+    QMutexLocker locker(&_mutex);
+
+    return _list.count();
+}
+
+template <class T>
+bool BlockingQueue<T>::isEmpty() const
+{
+    QMutexLocker locker(&_mutex);
+
+    return _list.isEmpty();
+}
+
+template <class T>
+bool BlockingQueue<T>::isFull() const
+{
+    QMutexLocker locker(&_mutex);
+
+    return _isFull();
+}
+
+template <class T>
+void BlockingQueue<T>::clear()
+{
+    QMutexLocker locker(&_mutex);
+
+    _list.clear();
+
+    _notFull.wakeAll();
+}
+
+template <class T>
+int BlockingQueue<T>::capacity() const
+{
+    QMutexLocker locker(&_mutex);
+
+    return _capacity;
+}
+
+template <class T>
+void BlockingQueue<T>::setCapacity(int capacity)
+{
+    QMutexLocker locker(&_mutex);
+
+    _capacity = capacity;
+
+    // 容量调大后唤醒等待中的生产者；调小时超出的元素保留，出队到新容量以下前都视为已满
+    _notFull.wakeAll();
+}
+
+template <class T>
+void BlockingQueue<T>::close()
+{
+    QMutexLocker locker(&_mutex);
+
+    _closed = true;
+
+    _notEmpty.wakeAll();
+    _notFull.wakeAll();
+}
+
+template <class T>
+bool BlockingQueue<T>::isClosed() const
+{
+    QMutexLocker locker(&_mutex);
+
+    return _closed;
+}
+
+template <class T>
+bool BlockingQueue<T>::_isFull() const
+{
+    return _capacity > 0 && _list.count() >= _capacity;
+}
+
+template <class T>
+bool BlockingQueue<T>::_wait(QWaitCondition &condition, QElapsedTimer &timer, int timeout)
+{
+    qint64 remaining = timeout - timer.elapsed();
+
+    if (remaining <= 0) return false;
+
+    condition.wait(&_mutex, static_cast<unsigned long>(remaining));
+
+    return true;
+}
+
+template <class T>
+void BlockingQueue<T>::_take(T *data)
+{
+    if (data) *data = _list.takeFirst();
+    else _list.removeFirst();
+
+    _notFull.wakeOne();
+}
+
+#endif // BLOCKINGQUEUE_H
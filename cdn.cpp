@@ -1,8 +1,8 @@
 #include "cdn.h"
+#include "signer.h"
 
 #include <QNetworkProxy>
 #include <QThread>
-#include <QMessageAuthenticationCode>
 #include <QJsonDocument>
 #include <QJsonArray>
 
@@ -10,11 +10,13 @@
 CDN::CDN() :
     _manager(new QNetworkAccessManager(this)),
     _thread(new QThread),
-    _jobQueue(new JobQueue<Job>),
-    _workQueue(new WorkerQueue<Job>(6))
+    _scheduler(new LaneScheduler<Job>(ConcurrencyController::InitialLimit))
 {
     _registerMetaType();
 
+    // CDN 只有刷新缓存一类排队的请求，只受全局并发上限限制
+    _scheduler->setLane(metadataLane, 32, 1);
+
     _manager->setProxy(QNetworkProxy::NoProxy);
 
     connect(_manager, &QNetworkAccessManager::finished, this, &CDN::_requestFinished);
@@ -39,13 +41,9 @@ CDN::~CDN()
     _thread->requestInterruption();
     _thread = nullptr;
 
-    _workQueue->clear();
-    delete _workQueue;
-    _workQueue = nullptr;
-
-    _jobQueue->clear();
-    delete _jobQueue;
-    _jobQueue = nullptr;
+    _scheduler->clear();
+    delete _scheduler;
+    _scheduler = nullptr;
 }
 
 // Public Methods
@@ -104,7 +102,7 @@ void CDN::purge(const PurgeParams &params)
 
     Job job(purgeOperation, QVariant::fromValue<PurgeParams>(params));
 
-    _jobQueue->push(job);
+    _scheduler->push(metadataLane, job);
 
     _work();
 }
@@ -174,20 +172,21 @@ void CDN::_registerMetaType() const
 
 void CDN::_work()
 {
-    if (_workQueue->isFull()) return;
-    if (_jobQueue->isEmpty()) return;
-
-    Job job = _jobQueue->pop();
-
-    _workQueue->push(job);
+    // 并发上限调大后一次补满
+    Lane lane;
 
-    switch (job.operation)
+    while (_scheduler->nextLane(&lane))
     {
-    case purgeOperation: _purge(job); break;
+        Job job = _scheduler->start(lane);
+
+        switch (job.operation)
+        {
+        case purgeOperation: _purge(job); break;
 #if 0
-    case preheatOperation: _preheat(job); break;
+        case preheatOperation: _preheat(job); break;
 #endif
-    default: qDebug() << "Unknown operation";
+        default: qDebug() << "Unknown operation";
+        }
     }
 }
 
@@ -236,6 +235,8 @@ QNetworkReply* CDN::_sendRequest(const QString &method,
 
     _operationHash.insert(reply, operation);
 
+    _startTimeHash.insert(reply, QDateTime::currentMSecsSinceEpoch());
+
     qDebug() << "Sended requeset";
 
     return reply;
@@ -246,11 +247,10 @@ void CDN::_signRequest(const QString &method,
                        const Operation &operation,
                        const QStringHash &resources)
 {
-    QStringList sign = {
-        method,
-        request.rawHeader(HEADER_CONTENT_MD5),
-        request.header(QNetworkRequest::ContentTypeHeader).toString(),
-        request.rawHeader(HEADER_DATE)
+    static const QStringList excludedKeys = { "domain", "id" };
+    static const QStringList subResourceKeys = {
+        "enable", "disable", "pageSize", "pageNum", "dateFrom", "dateTo", "type", "orderType", "sortField", "serviceType",
+        "status", "isEnabled"
     };
 
     QString url = request.url().toString();
@@ -264,59 +264,63 @@ void CDN::_signRequest(const QString &method,
 
     url += resource;
 
-    QStringHash::const_iterator rci;
-    QStringMap params;
+    QString subResources;
+    QString query;
 
-    for (rci = resources.cbegin(); rci != resources.cend(); ++rci)
-    {
-        QString key = rci.key();
+    Signer::splitQuery(resources, excludedKeys, subResourceKeys, subResources, query);
 
-        if (key != "domain" && key != "id") params.insert(key, rci.value());
-    }
+    if (!subResources.isEmpty()) resource += "?" + subResources;
 
-    if (params.size() > 0)
-    {
-        QStringList subResourceList = {
-            "enable", "disable", "pageSize", "pageNum", "dateFrom", "dateTo", "type", "orderType", "sortField", "serviceType",
-            "status", "isEnabled"
-        };
+    if (!query.isEmpty()) url += "?" + query;
+
+    request.setUrl(QUrl(url));
 
-        QStringList subResources;
-        QStringList query;
-        QStringMap::const_iterator pci;
+//    qDebug() << "request url:" << request.url();
 
-        for (pci = params.cbegin(); pci != params.cend(); ++pci)
-        {
-            QString subQuery = pci.key();
-            if (!pci.value().isEmpty()) subQuery += "=" + pci.value();
+    // 与 NOS 相同，只是没有自定义头
+    QByteArray sign;
 
-            query.append(subQuery);
+    Signer::canonicalString(sign,
+                            method,
+                            request.rawHeader(HEADER_CONTENT_MD5),
+                            request.header(QNetworkRequest::ContentTypeHeader).toString(),
+                            request.rawHeader(HEADER_DATE),
+                            QStringMap(),
+                            resource);
 
-            if (subResourceList.contains(pci.key())) subResources.append(subQuery);
-        }
+//    qDebug() << "sign:" << sign;
 
-        if (subResources.size() > 0) resource += "?" + subResources.join("&");
+    QByteArray signature = Signer::signature(sign, _account.accessSecret.toUtf8());
 
-        url += "?" + query.join("&");
-    }
+//    qDebug() << "signature:" << signature;
 
-    request.setUrl(QUrl(url));
+    request.setRawHeader(HEADER_AUTHORIZATION, ("NCDN " + _account.accessKey + ":").toUtf8() + signature);
+}
 
-//    qDebug() << "request url:" << request.url();
+// _recordRequest
+void CDN::_recordRequest(QNetworkReply *reply)
+{
+    // CDN 接口的请求和响应都很小，以整个请求的耗时作为延迟
+    qint64 latency = QDateTime::currentMSecsSinceEpoch() - _startTimeHash.take(reply);
 
-    sign.append(resource);
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
 
-    QString signString = sign.join("\n");
+    bool changed = false;
 
-//    qDebug() << "sign:" << signString;
+    if (reply->error() == QNetworkReply::TimeoutError)
+        changed = _concurrency.throttle("请求超时");
+    else if (statusCode == 503 || statusCode == 429)
+        changed = _concurrency.throttle(QString("服务端限流 HTTP %1").arg(statusCode));
+    else if (reply->error() == QNetworkReply::NoError)
+        changed = _concurrency.record(0, reply->bytesAvailable(), latency, _scheduler->pendingCount() > 0);
 
-    QString signature = QMessageAuthenticationCode::hash(signString.toUtf8(),
-                                                         _account.accessSecret.toUtf8(),
-                                                         QCryptographicHash::Sha256).toBase64();
+    if (!changed) return;
 
-//    qDebug() << "signature:" << signature;
+    _scheduler->setCapacity(_concurrency.limit());
+
+    qDebug() << "CDN concurrency limit:" << _concurrency.limit() << "reason:" << _concurrency.reason();
 
-    request.setRawHeader(HEADER_AUTHORIZATION, ("NCDN " + _account.accessKey + ":" + signature).toUtf8());
+    emit concurrencyChanged(_concurrency.limit(), _concurrency.reason());
 }
 
 // _purge
@@ -569,6 +573,8 @@ void CDN::_requestFinished(QNetworkReply *reply)
 
     Operation operation = _operationHash.value(reply);
 
+    _recordRequest(reply);
+
     if (error != QNetworkReply::NoError) {
         QString message;
 
@@ -601,11 +607,11 @@ void CDN::_requestFinished(QNetworkReply *reply)
     switch (operation)
     {
     case listDomainOperation: _listDomainHandler(reply); break;
-    case purgeOperation: _workQueue->pop(); _purgeHandler(reply); break;
+    case purgeOperation: _scheduler->finish(metadataLane); _purgeHandler(reply); break;
     case getPurgeStatusOperation: _getPurgeStatusHandler(reply); break;
     case listPurgeOperation: _listPurgeHandler(reply); break;
 #if 0
-    case preheatOperation: _workQueue->pop(); _preheatHandler(reply); break;
+    case preheatOperation: _scheduler->finish(metadataLane); _preheatHandler(reply); break;
     case listPreheatOperation: _listPreheatHandler(reply); break;
     case getPreheatQuotaOperation: _getPreheatQuotaHandler(reply); break;
 #endif
@@ -12,8 +12,8 @@ QT_END_NAMESPACE
 
 #include "account.h"
 
-#include "jobqueue.h"
-#include "workerqueue.h"
+#include "lanescheduler.h"
+#include "concurrencycontroller.h"
 
 #include "qstringmap.h"
 #include "qstringhash.h"
@@ -142,6 +142,9 @@ class CDN : public QObject
 {
     Q_OBJECT
 
+    // tests/ 下的测试直接调用签名
+    friend class SignerTest;
+
 public:
     enum Operation
     {
@@ -185,6 +188,8 @@ signals:
 
     void errorResponse(const QString &message);
 
+    void concurrencyChanged(int limit, const QString &reason);
+
 private:
     const QString METHOD_GET = "GET";
     const QString METHOD_POST = "POST";
@@ -202,11 +207,14 @@ private:
 
     QNetworkAccessManager *_manager;
     QThread *_thread;
-    JobQueue<Job> *_jobQueue;
-    WorkerQueue<Job> *_workQueue;
+    LaneScheduler<Job> *_scheduler;
 
     QHash<QNetworkReply*, Operation> _operationHash;
 
+    // 并发控制
+    ConcurrencyController _concurrency;
+    QHash<QNetworkReply*, qint64> _startTimeHash;
+
     void _registerMetaType() const;
 
     void _work();
@@ -221,6 +229,8 @@ private:
                       const Operation &operation,
                       const QStringHash &resources);
 
+    void _recordRequest(QNetworkReply *reply);
+
     void _purge(const Job &job);
 #if 0
     void _preheat(const Job &job);
@@ -1,14 +1,26 @@
 #include "client.h"
+#include "fileslicedevice.h"
+#include "signer.h"
+#include "percentencoder.h"
 
 #include <QMimeDatabase>
 #include <QCryptographicHash>
-#include <QMessageAuthenticationCode>
-#include <QDomDocument>
+#include <QXmlStreamReader>
 #include <QCoreApplication>
 #include <QNetworkProxy>
 #include <QFile>
+#include <QFileInfo>
 #include <QMetaType>
 #include <QThread>
+#include <QDir>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QTimer>
+#include <QRandomGenerator>
+
+const QString Client::DownloadSuffix = ".part";
 
 // Static Methods
 const QString Client::humanReadableSize(const quint64 &size, int precision)
@@ -46,12 +58,40 @@ const QString Client::humanReadableSize(const quint64 &size, int precision)
     return sizeString + " " + measure;
 }
 
+Lane Client::laneOf(Operation operation)
+{
+    switch (operation)
+    {
+    case putObjectOperation:
+    case initiateMultipartUploadOperation:
+    case resumeMultipartUploadOperation:
+    case uploadPartOperation:
+        return uploadLane;
+    case getObjectOperation:
+    case getObjectSegmentOperation:
+        return downloadLane;
+    case headObjectOperation:
+    case deleteObjectOperation:
+    case deleteObjectsOperation:
+    case copyObjectOperation:
+    case moveObjectOperation:
+    case abortMultipartUploadOperation:
+        return metadataLane;
+    default:
+        return interactiveLane;
+    }
+}
+
 // Constructor
 Client::Client() :
     _manager(new QNetworkAccessManager(this)),
     _thread(new QThread),
-    _jobQueue(new JobQueue<Job>),
-    _workQueue(new WorkerQueue<Job>(6))
+    _watchdog(new QTimer(this)),
+    _stallCount(0),
+    _scheduler(new LaneScheduler<Job>(ConcurrencyController::InitialLimit)),
+    _uploadJournal(new UploadJournal(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/uploads.json")),
+    _uploadRate(0),
+    _hashPool(new QThreadPool(this))
 {
 //    qDebug() << "Client before Thread:" << this->thread();
 
@@ -61,6 +101,15 @@ Client::Client() :
 
     connect(_manager, &QNetworkAccessManager::finished, this, &Client::_requestFinished);
 
+    _watchdog->setInterval(WatchdogInterval);
+
+    connect(_watchdog, &QTimer::timeout, this, &Client::_checkStalls);
+
+    _shareResponses();
+
+    // 预留容量后清空时不会释放，签名时一直复用
+    _signBuffer.reserve(SignBufferSize);
+
     connect(_thread, &QThread::finished, this, &QObject::deleteLater);
 
     this->moveToThread(_thread);
@@ -83,13 +132,13 @@ Client::~Client()
     _thread->requestInterruption();
     _thread = nullptr;
 
-    _workQueue->clear();
-    delete _workQueue;
-    _workQueue = nullptr;
+    _scheduler->clear();
+    delete _scheduler;
+    _scheduler = nullptr;
 
-    _jobQueue->clear();
-    delete _jobQueue;
-    _jobQueue = nullptr;
+    _uploadJournal->flush();
+    delete _uploadJournal;
+    _uploadJournal = nullptr;
 }
 
 // Public Methods
@@ -99,6 +148,9 @@ void Client::setAccount(const Account &account)
 
     _account = account;
 
+    _secretKey = _account.accessSecret.toUtf8();
+    _authorizationPrefix = ("NOS " + _account.accessKey + ":").toUtf8();
+
     qDebug() << _account.endpoint;
     qDebug() << _account.accessKey;
     qDebug() << _account.accessSecret;
@@ -118,15 +170,20 @@ void Client::resetAccount()
 {
     _account.reset();
 
+    _secretKey.clear();
+    _authorizationPrefix.clear();
+
     qDebug() << "account reseted";
 }
 
 const QString Client::encodeObjectKey(const QString &objectKey) const
 {
-    QString encodeKey = QUrl::toPercentEncoding(objectKey);
-    encodeKey.replace("~", "%7E").replace("%2F", "/");
+    QString url;
+    QString resource;
 
-    return encodeKey;
+    PercentEncoder::encodeObjectKey(objectKey, url, resource);
+
+    return url;
 }
 
 // Public Slots
@@ -136,32 +193,18 @@ void Client::listBucket()
 
     qDebug() << "Invoke listBucket()";
 
-    QStringHash headers = {{ HEADER_HOST, _account.endpoint }};
-
-    QByteArray body;
-    QStringHash resources;
+    Job job(listBucketOperation);
 
-    _sendRequest(METHOD_GET, headers, body, listBucketAction, resources, listBucketOperation);
+    _pushRead(job, RequestContext());
 }
 
 void Client::listObject(const ListObjectParams &params)
 {
     qDebug() << "Invoke listObject";
 
-    QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
-
-    QByteArray body;
-
-    QStringHash resources = {{ "bucket", _bucket }};
-
-    if (params.prefix != "") resources.insert("prefix", params.prefix);
-    if (params.marker != "") resources.insert("marker", params.marker);
-    if (params.delimiter != "") resources.insert("delimiter", params.delimiter);
-    if (params.maxKeys != "") resources.insert("max-keys", params.maxKeys);
+    Job job(listObjectOperation, QVariant::fromValue<ListObjectParams>(params));
 
-    qDebug() << "listObject resources:" << resources;
-
-    _sendRequest(METHOD_GET, headers, body, bucketAction, resources, listObjectOperation);
+    _pushRead(job, RequestContext());
 }
 
 void Client::getObject(const GetObjectParams &params)
@@ -173,9 +216,12 @@ void Client::getObject(const GetObjectParams &params)
         return;
     }
 
+    // 用户发起的任务重新计算重试次数
+    _retryCounts.remove(params.objectKey);
+
     Job job(getObjectOperation, QVariant::fromValue<GetObjectParams>(params));
 
-    _jobQueue->push(job);
+    _pushJob(job);
 
     _work();
 }
@@ -189,26 +235,10 @@ void Client::headObject(const HeadObjectParams &params)
         return;
     }
 
-    QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
-
-    if (params.ifModifiedSince != "") headers.insert(HEADER_IF_MODIFIED_SINCE, params.ifModifiedSince);
-
-    QByteArray body;
-
-    QStringHash resources = {
-        { "bucket", _bucket },
-        { "object", encodeObjectKey(params.objectKey) }
-    };
-
-    qDebug() << "headObject resources: " << resources;
-
-    QStringHash extras = {
-        { "objectKey", params.objectKey },
-        { "filePath", params.filePath },
-        { "fileSize", QString::number(params.fileSize) }
-    };
+    Job job(headObjectOperation, QVariant::fromValue<HeadObjectParams>(params));
 
-    _sendRequest(METHOD_HEAD, headers, body, objectAction, resources, headObjectOperation, extras);
+    // 同一对象的查询共用一次请求，结果按各自的 filePath、fileSize 分别通知
+    _pushRead(job, RequestContext(params.objectKey, params.filePath, params.fileSize));
 }
 
 void Client::putObject(const PutObjectParams &params)
@@ -227,9 +257,11 @@ void Client::putObject(const PutObjectParams &params)
         return;
     }
 
+    _retryCounts.remove(params.objectKey);
+
     Job job(putObjectOperation, QVariant::fromValue<PutObjectParams>(params));
 
-    _jobQueue->push(job);
+    _pushJob(job);
 
     _work();
 }
@@ -243,7 +275,13 @@ void Client::putBigObject(const PutBigObjectParams &params)
         return;
     }
 
-    initiateMultipartUpload(params);
+    _retryCounts.remove(params.objectKey);
+
+    Job job(initiateMultipartUploadOperation, QVariant::fromValue<PutBigObjectParams>(params));
+
+    _scheduler->push(laneOf(job.operation), job);
+
+    _work();
 }
 
 void Client::deleteObject(const DeleteObjectParams &params)
@@ -255,9 +293,11 @@ void Client::deleteObject(const DeleteObjectParams &params)
         return;
     }
 
+    _retryCounts.remove(params.objectKey);
+
     Job job(deleteObjectOperation, QVariant::fromValue<DeleteObjectParams>(params));
 
-    _jobQueue->push(job);
+    _pushJob(job);
 
     _work();
 }
@@ -273,7 +313,7 @@ void Client::deleteObjects(const DeleteObjectsParams &params)
 
     Job job(deleteObjectsOperation, QVariant::fromValue<DeleteObjectsParams>(params));
 
-    _jobQueue->push(job);
+    _scheduler->push(laneOf(job.operation), job);
 
     _work();
 }
@@ -292,9 +332,11 @@ void Client::copyObject(const CopyObjectParams &params)
         return;
     }
 
+    _retryCounts.remove(params.sourceObjectKey);
+
     Job job(copyObjectOperation, QVariant::fromValue<CopyObjectParams>(params));
 
-    _jobQueue->push(job);
+    _pushJob(job);
 
     _work();
 }
@@ -313,63 +355,144 @@ void Client::moveObject(const MoveObjectParams &params)
         return;
     }
 
+    _retryCounts.remove(params.sourceObjectKey);
+
     Job job(moveObjectOperation, QVariant::fromValue<MoveObjectParams>(params));
 
-    _jobQueue->push(job);
+    _pushJob(job);
 
     _work();
 }
 
-void Client::initiateMultipartUpload(const PutBigObjectParams &params)
+void Client::setRateLimit(qint64 uploadRate, qint64 downloadRate)
 {
-    qint64 bodySize = 0;
+    qDebug() << "setRateLimit uploadRate:" << uploadRate << "downloadRate:" << downloadRate;
 
-    QFile file(params.filePath);
+    _uploadLimiter.setRate(uploadRate);
+    _downloadLimiter.setRate(downloadRate);
+}
 
-    if (!file.open(QIODevice::ReadOnly))
+void Client::cancelObject(const CancelObjectParams &params)
+{
+    QString objectKey = params.objectKey;
+
+    qDebug() << "cancelObject:" << objectKey << "pause:" << params.pause;
+
+    // 正在等待重试的请求到时不再发出
+    ++_cancelCounts[objectKey];
+
+    _retryCounts.remove(objectKey);
+
+    // 分段下载：标记失败后剩余分段不再请求，结束时按是否暂停决定保留临时文件
+    QHash<QString, DownloadContext>::iterator it = _downloadContexts.end();
+
+    if (!params.downloadPath.isEmpty()) it = _downloadContexts.find(params.downloadPath);
+
+    bool downloading = it != _downloadContexts.end();
+
+    if (downloading)
     {
-        file.close();
+        if (it.value().error == QNetworkReply::NoError) it.value().error = QNetworkReply::OperationCanceledError;
 
-        emit errorResponse("文件: " + params.filePath + " 无法打开");
+        it.value().discard = !params.pause;
+    }
 
-        _workQueue->pop();
+    // 尚未开始的任务直接移出队列，移出的分段仍要计数，否则下载记录不会结束
+    QList<Job> jobs = _scheduler->takeIf([&objectKey](const Job &job) { return _jobObjectKey(job) == objectKey; });
 
-        return;
+    foreach (const Job &job, jobs)
+    {
+        if (job.operation == getObjectSegmentOperation)
+            _finishObjectSegment(job.params.value<GetObjectSegmentParams>().filePath);
+
+        _pendingJobs.remove(_jobKey(job));
     }
 
-    bodySize = file.size();
+    // 未发出结果的任务不再补发
+    QHash<QString, int>::iterator si = _jobSharers.begin();
 
-    file.close();
+    while (si != _jobSharers.end())
+    {
+        if (si.key().section('\n', 1, 1) == objectKey) si = _jobSharers.erase(si);
+        else ++si;
+    }
 
-    QStringHash headers = {
-        { HEADER_HOST, _bucket + "." + _account.endpoint },
-        { HEADER_CONTENT_LENGTH, QString::number(bodySize) }
-    };
+    // 正在计算 MD5 的简单上传
+    QHash<QFutureWatcher<QByteArray>*, QString>::iterator wi = _putWatchers.begin();
 
-    QByteArray body;
+    while (wi != _putWatchers.end())
+    {
+        if (wi.value() != objectKey)
+        {
+            ++wi;
 
-    QStringHash resources = {
-        { "bucket", _bucket },
-        { "object", encodeObjectKey(params.objectKey) },
-        { "uploads", "" }
-    };
+            continue;
+        }
 
-    qDebug() << "initiateMultipartUpload resources: " << resources;
+        QFutureWatcher<QByteArray> *watcher = wi.key();
 
-    QStringHash extras = {
-        { "objectKey", params.objectKey },
-        { "filePath", params.filePath },
-        { "fileSize", QString::number(params.fileSize) }
-    };
+        watcher->disconnect();
+        watcher->deleteLater();
+
+        _scheduler->finish(uploadLane);
+
+        wi = _putWatchers.erase(wi);
+    }
+
+    // 分块上传：其余分块发送前会检查分块表，已发出的分块中止后也不再通知
+    _partsHash.remove(objectKey);
+    _digestHash.remove(objectKey);
+
+    QList<QNetworkReply*> replies;
+
+    QHash<QNetworkReply*, Request>::const_iterator ci;
+
+    for (ci = _requests.cbegin(); ci != _requests.cend(); ++ci)
+    {
+        const RequestContext &context = ci.value().context;
+
+        if (context.objectKey == objectKey || context.sourceObjectKey == objectKey) replies.append(ci.key());
+    }
 
-    _sendRequest(METHOD_POST, headers, body, objectAction, resources, initiateMultipartUploadOperation, extras);
+    _abortReplies(replies);
+
+    _work();
+
+    if (params.pause) return;
+
+    // 取消时放弃服务端未完成的分块上传
+    UploadRecord record;
+
+    if (_uploadJournal->find(_bucket, objectKey, record))
+    {
+        AbortMultipartUploadParams abortParams = { .objectKey = record.objectKey, .uploadId = record.uploadId };
+
+        abortMultipartUpload(abortParams);
+
+        _uploadJournal->remove(_bucket, objectKey);
+    }
+
+    // 没有进行中的下载时直接删除临时文件，否则在下载结束时删除
+    if (!params.downloadPath.isEmpty() && !downloading)
+    {
+        QString partPath = params.downloadPath + DownloadSuffix;
+
+        QFile::remove(partPath);
+
+        DownloadCheckpoint(partPath).remove();
+    }
+}
+
+void Client::initiateMultipartUpload(const PutBigObjectParams &params)
+{
+    putBigObject(params);
 }
 
 void Client::uploadPart(const UploadPartParams &params)
 {
     Job job(uploadPartOperation, QVariant::fromValue<UploadPartParams>(params));
 
-    _jobQueue->push(job);
+    _scheduler->push(laneOf(job.operation), job);
 
     _work();
 }
@@ -378,28 +501,18 @@ void Client::completeMultipartUpload(const CompleteMultipartUploadParams &params
 {
     Job job(completeMultipartUploadOperation, QVariant::fromValue<CompleteMultipartUploadParams>(params));
 
-    _jobQueue->push(job);
+    _scheduler->push(laneOf(job.operation), job);
 
     _work();
 }
 
 void Client::listMultipartUploads(const ListMultipartUploadsParams &params)
 {
-    QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
-
-    if (!params.keyMarker.isEmpty()) headers.insert(HEADER_KEY_MARKER, params.keyMarker);
-    if (!params.maxUploads.isEmpty()) headers.insert(HEADER_MAX_UPLOADS, params.maxUploads);
-
-    QByteArray body;
+    Job job(listMultipartUploadsOperation, QVariant::fromValue<ListMultipartUploadsParams>(params));
 
-    QStringHash resources = {
-        { "bucket", _bucket },
-        { "uploads", "" }
-    };
+    _scheduler->push(laneOf(job.operation), job);
 
-    qDebug() << "listMultipartUploads resources: " << resources;
-
-    _sendRequest(METHOD_GET, headers, body, bucketAction, resources, listMultipartUploadsOperation);
+    _work();
 }
 
 void Client::abortMultipartUpload(const AbortMultipartUploadParams &params)
@@ -411,19 +524,11 @@ void Client::abortMultipartUpload(const AbortMultipartUploadParams &params)
         return;
     }
 
-    QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
-
-    QByteArray body;
-
-    QStringHash resources = {
-        { "bucket", _bucket },
-        { "object", encodeObjectKey(params.objectKey) },
-        { "uploadId", params.uploadId }
-    };
+    Job job(abortMultipartUploadOperation, QVariant::fromValue<AbortMultipartUploadParams>(params));
 
-    qDebug() << "abortMultipartUpload resources: " << resources;
+    _scheduler->push(laneOf(job.operation), job);
 
-    _sendRequest(METHOD_DELETE, headers, body, objectAction, resources, abortMultipartUploadOperation);
+    _work();
 }
 
 void Client::listParts(const ListPartsParams &params)
@@ -435,24 +540,11 @@ void Client::listParts(const ListPartsParams &params)
         return;
     }
 
-    QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
-
-    QByteArray body;
-
-    QStringHash resources = {
-        { "bucket", _bucket },
-        { "object", encodeObjectKey(params.objectKey) },
-        { "uploadId", params.uploadId }
-    };
-
-    if (!params.maxParts.isEmpty()) resources.insert("max-parts", params.maxParts);
-    if (!params.partNumberMarker.isEmpty()) resources.insert("part-number-marker", params.partNumberMarker);
-
-    qDebug() << "listParts resources: " << resources;
+    Job job(listPartsOperation, QVariant::fromValue<ListPartsParams>(params));
 
-    QStringHash extras = {{ "objectKey", params.objectKey }};
+    _scheduler->push(laneOf(job.operation), job);
 
-    _sendRequest(METHOD_GET, headers, body, objectAction, resources, listPartsOperation, extras);
+    _work();
 }
 
 // Private Methods
@@ -460,6 +552,7 @@ void Client::_registerMetaType() const
 {
     qRegisterMetaType<ListObjectParams>("ListObjectParams");
     qRegisterMetaType<GetObjectParams>("GetObjectParams");
+    qRegisterMetaType<GetObjectSegmentParams>("GetObjectSegmentParams");
     qRegisterMetaType<HeadObjectParams>("HeadObjectParams");
     qRegisterMetaType<PutObjectParams>("PutObjectParams");
     qRegisterMetaType<DeleteObjectParams>("DeleteObjectParams");
@@ -469,6 +562,8 @@ void Client::_registerMetaType() const
     qRegisterMetaType<ListMultipartUploadsParams>("ListMultipartUploadsParams");
     qRegisterMetaType<AbortMultipartUploadParams>("AbortMultipartUploadParams");
     qRegisterMetaType<ListPartsParams>("ListPartsParams");
+    qRegisterMetaType<CancelObjectParams>("CancelObjectParams");
+    qRegisterMetaType<RequestContext>("RequestContext");
     qRegisterMetaType<File>("File");
     qRegisterMetaType<QVector<File>>("QVector<File>");
     qRegisterMetaType<Operation>("Operation");
@@ -476,482 +571,1972 @@ void Client::_registerMetaType() const
 
 void Client::_work()
 {
-    if (_workQueue->isFull()) return;
-    if (_jobQueue->isEmpty()) return;
+    // 部分任务（如已失败上传的剩余分块）会直接释放占用的位置，因此循环直到占满
+    Lane lane;
+
+    while (_scheduler->nextLane(&lane))
+    {
+        Job job = _scheduler->start(lane);
+
+        // 排队期间合并进来的相同任务，随该任务的结果一并通知
+        QString key = job.attempt == 0 ? _jobKey(job) : QString();
 
-    Job job = _jobQueue->pop();
+        if (!key.isEmpty())
+        {
+            int sharers = _pendingJobs.take(key);
+
+            if (sharers > 0) _jobSharers[key] += sharers;
+        }
 
-    _workQueue->push(job);
+        switch (job.operation)
+        {
+        case listBucketOperation: _listBucket(job); break;
+        case listObjectOperation: _listObject(job); break;
+        case headObjectOperation: _headObject(job); break;
+        case getObjectOperation: _getObject(job); break;
+        case getObjectSegmentOperation: _getObjectSegment(job); break;
+        case putObjectOperation: _putObject(job); break;
+        case deleteObjectOperation: _deleteObject(job); break;
+        case deleteObjectsOperation: _deleteObjects(job); break;
+        case copyObjectOperation: _copyObject(job); break;
+        case moveObjectOperation: _moveObject(job); break;
+        case uploadPartOperation: _uploadPart(job); break;
+        case initiateMultipartUploadOperation: _putBigObject(job.params.value<PutBigObjectParams>()); break;
+        case completeMultipartUploadOperation: _completeMultipartUpload(job); break;
+        case listMultipartUploadsOperation: _listMultipartUploads(job); break;
+        case abortMultipartUploadOperation: _abortMultipartUpload(job); break;
+        case listPartsOperation: _listParts(job); break;
+        default: qDebug() << "Unknown operation";
+        }
+    }
+}
 
+// _jobObjectKey
+QString Client::_jobObjectKey(const Job &job)
+{
     switch (job.operation)
     {
-    case getObjectOperation: _getObject(job); break;
-    case putObjectOperation: _putObject(job); break;
-    case deleteObjectOperation: _deleteObject(job); break;
-    case deleteObjectsOperation: _deleteObjects(job); break;
-    case copyObjectOperation: _copyObject(job); break;
-    case moveObjectOperation: _moveObject(job); break;
-    case uploadPartOperation: _uploadPart(job); break;
-    case completeMultipartUploadOperation: _completeMultipartUpload(job); break;
-    default: qDebug() << "Unknown operation";
+    case getObjectOperation: return job.params.value<GetObjectParams>().objectKey;
+    case getObjectSegmentOperation: return job.params.value<GetObjectSegmentParams>().objectKey;
+    case putObjectOperation: return job.params.value<PutObjectParams>().objectKey;
+    case deleteObjectOperation: return job.params.value<DeleteObjectParams>().objectKey;
+    case copyObjectOperation: return job.params.value<CopyObjectParams>().sourceObjectKey;
+    case moveObjectOperation: return job.params.value<MoveObjectParams>().sourceObjectKey;
+    case uploadPartOperation: return job.params.value<UploadPartParams>().objectKey;
+    case initiateMultipartUploadOperation: return job.params.value<PutBigObjectParams>().objectKey;
+    case completeMultipartUploadOperation: return job.params.value<CompleteMultipartUploadParams>().objectKey;
+    default: return QString();
     }
 }
 
-QNetworkReply* Client::_sendRequest(const QString &method,
-                                    const QStringHash &headers,
-                                    const QByteArray &body,
-                                    const Action &action,
-                                    const QStringHash &resources,
-                                    const Operation &operation,
-                                    const QStringHash &extras)
+// _jobKey
+QString Client::_jobKey(Operation operation, const QString &objectKey, const QString &target)
 {
-    QNetworkRequest request;
-
-    QString url = "http://" + _account.endpoint + "/";
+    return QString::number(operation) + "\n" + objectKey + "\n" + target;
+}
 
-    if (action == objectAction) url += resources["object"];
+QString Client::_jobKey(const Job &job)
+{
+    switch (job.operation)
+    {
+    case getObjectOperation:
+    {
+        GetObjectParams params = job.params.value<GetObjectParams>();
 
-    request.setUrl(url);
+        // 指定范围或条件的下载结果各不相同，不合并
+        if (!params.range.isEmpty() || !params.ifModifiedSince.isEmpty()) return QString();
 
-    QDateTime dateTime = QDateTime::currentDateTimeUtc();
-    QLocale locale = QLocale::English;
-    QString format = "ddd, dd MMM yyyy HH:mm:ss";
+        return _jobKey(job.operation, params.objectKey, params.filePath);
+    }
+    case putObjectOperation:
+    {
+        PutObjectParams params = job.params.value<PutObjectParams>();
 
-    auto date = locale.toString(dateTime, format) + " GMT";
+        return _jobKey(job.operation, params.objectKey, params.filePath);
+    }
+    case deleteObjectOperation: return _jobKey(job.operation, job.params.value<DeleteObjectParams>().objectKey, "");
+    case copyObjectOperation:
+    case moveObjectOperation:
+    {
+        CopyObjectParams params = job.params.value<CopyObjectParams>();
 
-    request.setRawHeader(HEADER_DATE, date.toUtf8());
+        return _jobKey(job.operation, params.sourceObjectKey,
+                       _copyTarget(params.sourceBucketName, params.destinationBucketName, params.destinationObjectKey));
+    }
+    default: return QString();
+    }
+}
 
-    QStringMap nosHeaders;
+// _copyTarget
+QString Client::_copyTarget(const QString &sourceBucketName,
+                            const QString &destinationBucketName,
+                            const QString &destinationObjectKey)
+{
+    // 跨桶复制、移动时对象名相同的任务未必相同
+    return sourceBucketName + "\n" + destinationBucketName + "\n" + destinationObjectKey;
+}
 
-    QStringHash::const_iterator ci;
+// _pushJob
+void Client::_pushJob(const Job &job)
+{
+    QString key = _jobKey(job);
 
-    for (ci = headers.cbegin(); ci != headers.cend(); ++ci)
+    // 相同的任务已在排队时只记录次数
+    if (!key.isEmpty())
     {
-        QString key = ci.key();
-        QString value = ci.value();
+        QHash<QString, int>::iterator it = _pendingJobs.find(key);
 
-        if (value != "") {
-            request.setRawHeader(key.toUtf8(), value.toUtf8());
+        if (it != _pendingJobs.end())
+        {
+            ++it.value();
 
-            if (key.startsWith("x-nos-")) nosHeaders.insert(key, value);
+            qDebug() << "merge queued job:" << key;
+
+            return;
         }
+
+        _pendingJobs.insert(key, 0);
     }
 
-    if (body.size() > 0)
-    {
-        request.setHeader(QNetworkRequest::ContentLengthHeader, body.size());
+    _scheduler->push(laneOf(job.operation), job);
+}
 
-        QByteArray bodyHash = QCryptographicHash::hash(body, QCryptographicHash::Md5);
+// _shareRead
+bool Client::_shareRead(const QString &readKey, const RequestContext &context)
+{
+    QHash<QString, QList<RequestContext>>::iterator it = _readSharers.find(readKey);
 
-        request.setRawHeader(HEADER_CONTENT_MD5, bodyHash.toHex());
+    if (it == _readSharers.end())
+    {
+        _readSharers.insert(readKey, QList<RequestContext>());
+
+        return false;
     }
 
-    QString contentType = request.header(QNetworkRequest::ContentTypeHeader).toString();
+    it.value().append(context);
 
-    if (contentType.isEmpty() && action == objectAction)
-    {
-        QString filename = resources["object"].split("/").last();
-//        qDebug() << "filename:" << filename;
-        QMimeDatabase db;
-        QMimeType mimeType = db.mimeTypeForFile(filename, QMimeDatabase::MatchExtension);
-        contentType = mimeType.name();
-//        qDebug() << "mimeType.name():" << mimeType.name();
+    qDebug() << "share in-flight request:" << readKey;
 
-        if (contentType.isEmpty()) contentType = "application/octet-stream";
+    return true;
+}
 
-//        qDebug() << "contentType:" << contentType;
+// _readKey
+QString Client::_readKey(const Job &job)
+{
+    switch (job.operation)
+    {
+    case listBucketOperation: return "listBucket";
+    case listObjectOperation:
+    {
+        ListObjectParams params = job.params.value<ListObjectParams>();
 
-        request.setHeader(QNetworkRequest::ContentTypeHeader, contentType);
+        return QStringList({ "listObject", job.bucket, params.prefix, params.marker, params.delimiter, params.maxKeys }).join("\n");
     }
+    case headObjectOperation:
+    {
+        HeadObjectParams params = job.params.value<HeadObjectParams>();
 
-    _signRequest(method, request, nosHeaders, action, resources);
+        return QStringList({ "headObject", job.bucket, params.objectKey, params.ifModifiedSince }).join("\n");
+    }
+    default: return QString();
+    }
+}
 
-    qDebug() << "Build requeset success";
+// _pushRead
+void Client::_pushRead(Job job, const RequestContext &context)
+{
+    // 桶在排队期间可能切换，请求和合并用的键都按入队时的桶
+    job.bucket = _bucket;
+    job.readKey = _readKey(job);
 
-    QNetworkReply *reply;
+    // 相同的读取请求已在排队或进行中时只等待其结果
+    if (_shareRead(job.readKey, context)) return;
 
-    if (method == METHOD_GET) reply = _manager->get(request);
-    if (method == METHOD_POST) reply = _manager->post(request, body);
-    if (method == METHOD_PUT) reply = _manager->put(request, body);
-    if (method == METHOD_DELETE) reply = _manager->deleteResource(request);
-    if (method == METHOD_HEAD) reply = _manager->head(request);
+    _scheduler->push(laneOf(job.operation), job);
 
-    _operationMap.insert(reply, operation);
+    _work();
+}
 
-    QStringHash params;
+// _shareResponses
+void Client::_shareResponses()
+{
+    // 发出结果时补发给合并进来的请求；补发时计数已取走，不会重复
+    connect(this, &Client::listBucketResponse, this, [this](QNetworkReply::NetworkError error, const QStringList &buckets) {
+        QList<RequestContext> sharers = _sharers;
 
-    if (action == objectAction)
-    {
-        params.insert("objectKey", resources["object"]);
+        _sharers.clear();
 
-        if (operation == uploadPartOperation)
-        {
-            params.insert("partNumber", resources["partNumber"]);
-            params.insert("uploadId", resources["uploadId"]);
-        }
+        for (int i = 0; i < sharers.count(); ++i) emit listBucketResponse(error, buckets);
+    });
 
-        _objectHash.insert(reply, params);
-    }
+    connect(this, &Client::listObjectResponse, this, [this](QNetworkReply::NetworkError error,
+            const QStringHash &params,
+            const QStringVector &dirs,
+            const QVector<File> &files) {
+        QList<RequestContext> sharers = _sharers;
+
+        _sharers.clear();
 
-    if (extras.size() > 0) _extraHash.insert(reply, extras);
+        for (int i = 0; i < sharers.count(); ++i) emit listObjectResponse(error, params, dirs, files);
+    });
+
+    connect(this, &Client::headObjectResponse, this, [this](QNetworkReply::NetworkError error, const QStringHash &, const QStringHash &headers) {
+        QList<RequestContext> sharers = _sharers;
 
-    connect(reply, &QNetworkReply::uploadProgress, [this, operation, params, extras](qint64 bytesSent, qint64 bytesTotal) {
-        qDebug() << "Receive QNetworkReply::uploadProgress, bytesSent:" << bytesSent << "bytesTotal:" << bytesTotal;
-        qDebug() << "operation:" << operation;
-        qDebug() << "params:" << params;
-        qDebug() << "extras:" << extras;
+        _sharers.clear();
 
-        if (bytesSent > 0) emit this->updateProgressResponse(operation, params, extras, bytesSent);
+        foreach (const RequestContext &context, sharers) emit headObjectResponse(error, _objectParams(context), headers);
     });
 
-    qDebug() << "Sended requeset";
+    connect(this, &Client::getObjectResponse, this, [this](QNetworkReply::NetworkError error, const QStringHash &params, qint64 bytesReceived) {
+        int sharers = _jobSharers.take(_jobKey(getObjectOperation, params["objectKey"], params["filePath"]));
 
-    return reply;
-}
+        for (int i = 0; i < sharers; ++i) emit getObjectResponse(error, params, bytesReceived);
+    });
 
-void Client::_signRequest(const QString &method,
-                          QNetworkRequest &request,
-                          const QStringMap &nosHeaders,
-                          const Action &action,
-                          const QStringHash &resources)
-{
-    QStringList sign = {
-        method,
-        request.rawHeader(HEADER_CONTENT_MD5),
-        request.header(QNetworkRequest::ContentTypeHeader).toString(),
-        request.rawHeader(HEADER_DATE)
-    };
+    connect(this, &Client::putObjectResponse, this, [this](QNetworkReply::NetworkError error, const QStringHash &params, const QStringHash &headers) {
+        int sharers = _jobSharers.take(_jobKey(putObjectOperation, params["objectKey"], params["filePath"]));
 
-    QStringMap::const_iterator nci;
+        for (int i = 0; i < sharers; ++i) emit putObjectResponse(error, params, headers);
+    });
 
-    if (nosHeaders.size() > 0)
-    {
-        QString headerString;
+    connect(this, &Client::deleteObjectResponse, this, [this](QNetworkReply::NetworkError error, const QStringHash &params) {
+        int sharers = _jobSharers.take(_jobKey(deleteObjectOperation, params["objectKey"], ""));
 
-        for (nci = nosHeaders.cbegin(); nci != nosHeaders.cend(); ++nci)
-            headerString += nci.key() + ":" + nci.value() + "\n";
+        for (int i = 0; i < sharers; ++i) emit deleteObjectResponse(error, params);
+    });
 
-        sign.append(headerString);
-    }
-    else
-        sign.append("");
+    connect(this, &Client::copyObjectResponse, this, [this](QNetworkReply::NetworkError error, const QStringHash &params) {
+        int sharers = _jobSharers.take(_jobKey(copyObjectOperation, params["sourceObjectKey"],
+                                               _copyTarget(params["sourceBucketName"],
+                                                           params["destinationBucketName"],
+                                                           params["destinationObjectKey"])));
 
-    QString resource;
+        for (int i = 0; i < sharers; ++i) emit copyObjectResponse(error, params);
+    });
 
-    switch (action) {
+    connect(this, &Client::moveObjectResponse, this, [this](QNetworkReply::NetworkError error, const QStringHash &params) {
+        int sharers = _jobSharers.take(_jobKey(moveObjectOperation, params["sourceObjectKey"],
+                                               _copyTarget(params["sourceBucketName"],
+                                                           params["destinationBucketName"],
+                                                           params["destinationObjectKey"])));
+
+        for (int i = 0; i < sharers; ++i) emit moveObjectResponse(error, params);
+    });
+}
+
+QNetworkReply* Client::_sendRequest(const QString &method,
+                                    const QStringHash &headers,
+                                    const QByteArray &body,
+                                    const Action &action,
+                                    const QStringHash &resources,
+                                    const Operation &operation,
+                                    const RequestContext &context,
+                                    const Job &job)
+{
+    QByteArray bodyHash;
+
+    if (body.size() > 0) bodyHash = QCryptographicHash::hash(body, QCryptographicHash::Md5);
+
+    // 每次发送（包括重试）都重新生成 Date 和签名
+    QNetworkRequest networkRequest = _buildRequest(method, headers, body.size(), bodyHash, action, resources);
+
+    QNetworkReply *reply = _createReply(method, networkRequest, body, nullptr);
+
+    Request request = {
+        .operation = operation,
+        .context = context,
+        .job = job,
+        .method = method,
+        .headers = headers,
+        .body = body,
+        .action = action,
+        .resources = resources,
+        .file = nullptr,
+        .paced = false,
+        .bodySize = body.size(),
+        .startTime = QDateTime::currentMSecsSinceEpoch(),
+        .latency = -1,
+        .bytes = body.size(),
+        .activeTime = -1,
+        .stall = QString(),
+        .error = QNetworkReply::NoError,
+        .readKey = job.readKey
+    };
+
+    _trackReply(reply, request);
+
+    return reply;
+}
+
+QNetworkReply* Client::_sendRequest(const QString &method,
+                                    const QStringHash &headers,
+                                    FileSliceDevice *body,
+                                    const QByteArray &bodyHash,
+                                    const Action &action,
+                                    const QStringHash &resources,
+                                    const Operation &operation,
+                                    const RequestContext &context,
+                                    const Job &job)
+{
+    // Content-MD5 已在线程池中算好，请求体由 QNetworkAccessManager 从设备读取
+    QNetworkRequest networkRequest = _buildRequest(method, headers, body->size(), bodyHash, action, resources);
+
+    body->setRateLimiter(&_uploadLimiter);
+
+    qint64 bodySize = body->size();
+
+    QNetworkReply *reply = _createReply(method, networkRequest, QByteArray(), body);
+
+    // 设备请求体无法原样重发，总是随任务重新排队
+    Request request = {
+        .operation = operation,
+        .context = context,
+        .job = job,
+        .method = method,
+        .headers = headers,
+        .body = QByteArray(),
+        .action = action,
+        .resources = resources,
+        .file = nullptr,
+        .paced = false,
+        .bodySize = bodySize,
+        .startTime = QDateTime::currentMSecsSinceEpoch(),
+        .latency = -1,
+        .bytes = bodySize,
+        .activeTime = -1,
+        .stall = QString(),
+        .error = QNetworkReply::NoError,
+        .readKey = job.readKey
+    };
+
+    _trackReply(reply, request);
+
+    return reply;
+}
+
+// _createReply
+QNetworkReply* Client::_createReply(const QString &method,
+                                    const QNetworkRequest &request,
+                                    const QByteArray &body,
+                                    QIODevice *device) const
+{
+    QNetworkReply *reply = nullptr;
+
+    if (device)
+    {
+        reply = method == METHOD_POST ? _manager->post(request, device) : _manager->put(request, device);
+
+        // 请求结束前设备必须保持打开
+        device->setParent(reply);
+
+        return reply;
+    }
+
+    if (method == METHOD_GET) reply = _manager->get(request);
+    if (method == METHOD_POST) reply = _manager->post(request, body);
+    if (method == METHOD_PUT) reply = _manager->put(request, body);
+    if (method == METHOD_DELETE) reply = _manager->deleteResource(request);
+    if (method == METHOD_HEAD) reply = _manager->head(request);
+
+    return reply;
+}
+
+QNetworkRequest Client::_buildRequest(const QString &method,
+                                      const QStringHash &headers,
+                                      qint64 bodySize,
+                                      const QByteArray &bodyHash,
+                                      const Action &action,
+                                      const QStringHash &resources)
+{
+    QNetworkRequest request;
+
+    QString url = "http://" + _account.endpoint + "/";
+
+    if (action == objectAction) url += resources["object"];
+
+    request.setUrl(url);
+
+    request.setRawHeader(HEADER_DATE, _requestDate());
+
+    QStringMap nosHeaders;
+
+    QStringHash::const_iterator ci;
+
+    for (ci = headers.cbegin(); ci != headers.cend(); ++ci)
+    {
+        QString key = ci.key();
+        QString value = ci.value();
+
+        if (value != "") {
+            request.setRawHeader(key.toUtf8(), value.toUtf8());
+
+            if (key.startsWith("x-nos-")) nosHeaders.insert(key, value);
+        }
+    }
+
+    if (bodySize > 0)
+    {
+        request.setHeader(QNetworkRequest::ContentLengthHeader, bodySize);
+
+        request.setRawHeader(HEADER_CONTENT_MD5, bodyHash.toHex());
+    }
+
+    QString contentType = request.header(QNetworkRequest::ContentTypeHeader).toString();
+
+    if (contentType.isEmpty() && action == objectAction)
+    {
+        const QString &object = resources["object"];
+
+        contentType = _contentType(object.mid(object.lastIndexOf("/") + 1));
+
+//        qDebug() << "contentType:" << contentType;
+
+        request.setHeader(QNetworkRequest::ContentTypeHeader, contentType);
+    }
+
+    _signRequest(method, request, nosHeaders, action, resources);
+
+    qDebug() << "Build requeset success";
+
+    return request;
+}
+
+// _requestDate
+const QByteArray& Client::_requestDate()
+{
+    // 同一秒内的请求共用格式化好的 Date
+    qint64 second = QDateTime::currentSecsSinceEpoch();
+
+    if (second != _dateSecond)
+    {
+        QLocale locale = QLocale::English;
+        QString format = "ddd, dd MMM yyyy HH:mm:ss";
+
+        _date = (locale.toString(QDateTime::fromSecsSinceEpoch(second, Qt::UTC), format) + " GMT").toUtf8();
+        _dateSecond = second;
+    }
+
+    return _date;
+}
+
+// _contentType
+QString Client::_contentType(const QString &filename)
+{
+    // 按完整扩展名缓存（如 .tar.gz），没有扩展名时按完整文件名（如 Makefile）
+    // 类型也只按缓存的键查询，否则同一扩展名的不同文件名可能得到不同的结果
+    QString suffix = QFileInfo(filename).completeSuffix();
+    QString key = suffix.isEmpty() ? filename : "." + suffix;
+
+    QHash<QString, QString>::const_iterator ci = _mimeTypes.constFind(key);
+
+    if (ci != _mimeTypes.cend()) return ci.value();
+
+    QMimeDatabase db;
+    QString contentType = db.mimeTypeForFile(suffix.isEmpty() ? filename : "file." + suffix, QMimeDatabase::MatchExtension).name();
+
+    if (contentType.isEmpty()) contentType = "application/octet-stream";
+
+    if (_mimeTypes.count() >= MaxMimeTypeCount) _mimeTypes.clear();
+
+    _mimeTypes.insert(key, contentType);
+
+    return contentType;
+}
+
+void Client::_trackReply(QNetworkReply *reply, const Request &request)
+{
+    Operation operation = request.operation;
+    RequestContext context = request.context;
+    qint64 bodySize = request.bodySize;
+
+    _requests.insert(reply, request);
+
+    if (!_watchdog->isActive()) _watchdog->start();
+
+    // 收到响应头、收发数据都说明连接仍在工作
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, reply, bodySize] {
+        QHash<QNetworkReply*, Request>::iterator it = _requests.find(reply);
+
+        if (it == _requests.end()) return;
+
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+        it.value().activeTime = now;
+
+        // 有请求体时响应头要等上传完成，不能反映服务端延迟
+        if (bodySize == 0 && it.value().latency < 0) it.value().latency = now - it.value().startTime;
+    });
+
+    connect(reply, &QNetworkReply::downloadProgress, this, [this, reply, bodySize](qint64 bytesReceived, qint64) {
+        QHash<QNetworkReply*, Request>::iterator it = _requests.find(reply);
+
+        if (it == _requests.end()) return;
+
+        it.value().bytes = bodySize + bytesReceived;
+        it.value().activeTime = QDateTime::currentMSecsSinceEpoch();
+    });
+
+    connect(reply, &QNetworkReply::uploadProgress, this, [this, reply, operation, context](qint64 bytesSent, qint64) {
+        if (bytesSent == 0) return;
+
+        QHash<QNetworkReply*, Request>::iterator it = _requests.find(reply);
+
+        if (it != _requests.end()) it.value().activeTime = QDateTime::currentMSecsSinceEpoch();
+
+        emit updateProgressResponse(operation, context, bytesSent);
+    });
+
+    qDebug() << "Sended requeset";
+}
+
+void Client::_signRequest(const QString &method,
+                          QNetworkRequest &request,
+                          const QStringMap &nosHeaders,
+                          const Action &action,
+                          const QStringHash &resources)
+{
+    static const QStringList excludedKeys = { "bucket", "object", "objectResource" };
+    static const QStringList subResourceKeys = { "acl", "location", "uploadId", "uploads", "partNumber", "delete" };
+
+    QString resource;
+
+    switch (action) {
         case listBucketAction:
             resource = "/";
             break;
 
-        case bucketAction: resource = "/" + resources["bucket"] + "/"; break;
-        case objectAction:
-            QString object = resources["object"];
-            object.replace("/", "%2F");
+        case bucketAction: resource = "/" + resources["bucket"] + "/"; break;
+        case objectAction: resource = "/" + resources["bucket"] + "/" + resources["objectResource"]; break;
+    }
+
+    QString subResources;
+    QString query;
+
+    Signer::splitQuery(resources, excludedKeys, subResourceKeys, subResources, query);
+
+    if (!subResources.isEmpty()) resource += "?" + subResources;
+
+    if (!query.isEmpty()) request.setUrl(QUrl(request.url().toString() + "?" + query));
+
+//    qDebug() << "request url:" << request.url();
+
+    // 待签名字符串拼在复用的缓冲区里
+    Signer::canonicalString(_signBuffer,
+                            method,
+                            request.rawHeader(HEADER_CONTENT_MD5),
+                            request.header(QNetworkRequest::ContentTypeHeader).toString(),
+                            request.rawHeader(HEADER_DATE),
+                            nosHeaders,
+                            resource);
+
+//    qDebug() << "sign:" << _signBuffer;
+
+    QByteArray signature = Signer::signature(_signBuffer, _secretKey);
+
+//    qDebug() << "signature:" << signature;
+
+    request.setRawHeader(HEADER_AUTHORIZATION, _authorizationPrefix + signature);
+}
+
+// _recordRequest
+void Client::_recordRequest(QNetworkReply *reply, const Request &request)
+{
+    QNetworkReply::NetworkError error = request.error;
+
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    bool changed = false;
+
+    // 超时、503 及 429 说明服务端或链路已过载
+    if (error == QNetworkReply::TimeoutError)
+        changed = _concurrency.throttle("请求超时");
+    else if (statusCode == 503 || statusCode == 429)
+        changed = _concurrency.throttle(QString("服务端限流 HTTP %1").arg(statusCode));
+    else if (error == QNetworkReply::NoError)
+        changed = _concurrency.record(laneOf(request.operation), request.bytes, request.latency, _scheduler->pendingCount() > 0);
+
+    if (!changed) return;
+
+    _scheduler->setCapacity(_concurrency.limit());
+
+    qDebug() << "concurrency limit:" << _concurrency.limit() << "reason:" << _concurrency.reason();
+
+    emit concurrencyChanged(_concurrency.limit(), _concurrency.reason());
+}
+
+// _abortReplies
+void Client::_abortReplies(const QList<QNetworkReply*> &replies)
+{
+    // 中止时会同步进入 _requestFinished 并修改 _requests，因此由调用方先取出要中止的响应
+    foreach (QNetworkReply *reply, replies) reply->abort();
+}
+
+// _retryKey
+QString Client::_retryKey(const RequestContext &context)
+{
+    return context.objectKey.isEmpty() ? context.sourceObjectKey : context.objectKey;
+}
+
+// _isIdempotent
+bool Client::_isIdempotent(Operation operation)
+{
+    // 读取、整体写入对象或分块的请求重发结果相同
+    // 对同一 uploadId 重发完成请求是安全的，大对象合并较慢、容易被看门狗中止，需要能重试
+    // 复制、批量删除、移动可能已部分生效，初始化会产生新的 uploadId，中止在首次成功后重发会报错，都不自动重发
+    switch (operation)
+    {
+    case listBucketOperation:
+    case listObjectOperation:
+    case headObjectOperation:
+    case getObjectOperation:
+    case getObjectSegmentOperation:
+    case listMultipartUploadsOperation:
+    case listPartsOperation:
+    case putObjectOperation:
+    case uploadPartOperation:
+    case completeMultipartUploadOperation:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// _retryReason
+QString Client::_retryReason(QNetworkReply *reply, const Request &request)
+{
+    QNetworkReply::NetworkError error = request.error;
+
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    // OperationCanceledError 来自取消、暂停或本地写入失败，都不重试
+    if (error == QNetworkReply::NoError || error == QNetworkReply::OperationCanceledError) return QString();
+
+    // 服务端明确未处理的请求，任何操作都可以重发
+    if (statusCode == 503 || statusCode == 429) return QString("HTTP %1").arg(statusCode);
+    if (error == QNetworkReply::ConnectionRefusedError) return "连接被拒绝";
+
+    // 其余失败时请求可能已经生效，只重发幂等的操作
+    if (!_isIdempotent(request.operation)) return QString();
+
+    if (statusCode == 500 || statusCode == 502 || statusCode == 504) return QString("HTTP %1").arg(statusCode);
+
+    switch (error)
+    {
+    case QNetworkReply::RemoteHostClosedError: return "连接被关闭";
+    case QNetworkReply::TimeoutError: return "请求超时";
+    case QNetworkReply::ProxyTimeoutError: return "代理超时";
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::UnknownNetworkError:
+        return "网络中断";
+    default:
+        return QString();
+    }
+}
+
+// _retryDelay
+qint64 Client::_retryDelay(QNetworkReply *reply, int attempt)
+{
+    // 服务端给出 Retry-After（秒）时照办
+    bool ok = false;
+
+    qint64 retryAfter = reply->rawHeader("Retry-After").toLongLong(&ok);
+
+    qint64 delay = ok && retryAfter > 0 ? retryAfter * 1000 : RetryBaseDelay << qMin(attempt, 16);
+
+    if (delay > MaxRetryDelay) delay = MaxRetryDelay;
+
+    if (ok && retryAfter > 0) return delay;
+
+    // 在 [delay / 2, delay] 中随机，避免大量分块同时失败后又同时重试
+    return delay / 2 + QRandomGenerator::global()->bounded(static_cast<int>(delay / 2) + 1);
+}
+
+// _shouldRetry
+bool Client::_shouldRetry(QNetworkReply *reply, const Request &request)
+{
+    if (request.context.attempt >= MaxRetries) return false;
+
+    if (_retryReason(reply, request).isEmpty()) return false;
+
+    QString key = _retryKey(request.context);
+
+    // 列表等不属于任务的请求只受单个请求的次数限制
+    if (key.isEmpty()) return true;
+
+    int &count = _retryCounts[key];
+
+    if (count >= RetryBudget) return false;
+
+    ++count;
+
+    return true;
+}
+
+// _scheduleRetry
+void Client::_scheduleRetry(QNetworkReply *reply, const Request &request)
+{
+    qint64 delay = _retryDelay(reply, request.context.attempt);
+
+    QString reason = _retryReason(reply, request);
+    QString key = _retryKey(request.context);
+
+    Request retry = request;
+    ++retry.context.attempt;
+    ++retry.job.attempt;
+
+    qDebug() << "retry operation:" << retry.operation << "key:" << key << "attempt:" << retry.context.attempt << "reason:" << reason << "delay:" << delay;
+
+    emit retryResponse(retry.operation, retry.context, reason, delay);
+
+    int cancelCount = _cancelCounts.value(key);
+
+    QTimer::singleShot(static_cast<int>(delay), this, [this, retry, key, cancelCount] {
+        bool canceled = _cancelCounts.value(key) != cancelCount;
+
+        if (retry.job.operation != noOperation)
+        {
+            // 任务重新排队；被取消的分段也要排队，由 _getObjectSegment 计数结束
+            // 查询、列表不属于对象的任务，合并进来的请求仍在等待结果，不随取消丢弃
+            if (!canceled || _jobObjectKey(retry.job).isEmpty() || retry.job.operation == getObjectSegmentOperation)
+                _scheduler->push(laneOf(retry.job.operation), retry.job);
+        }
+        else if (!canceled)
+        {
+            _sendRequest(retry.method, retry.headers, retry.body, retry.action, retry.resources, retry.operation, retry.context);
+        }
+        else
+        {
+            // 分块上传的准备请求一直占用 putObject 的位置
+            _scheduler->finish(uploadLane);
+        }
+
+        _work();
+    });
+}
+
+// _readPaced
+QByteArray Client::_readPaced(QNetworkReply *reply)
+{
+    qint64 available = reply->bytesAvailable();
+    qint64 granted = _downloadLimiter.take(available);
+
+    QHash<QNetworkReply*, Request>::iterator it = _requests.find(reply);
+
+    // 令牌不足时剩余数据留在缓冲区，等补足后再次触发 readyRead
+    if (granted < available && it != _requests.end() && !it.value().paced)
+    {
+        it.value().paced = true;
+
+        QTimer::singleShot(static_cast<int>(_downloadLimiter.delay(available - granted)), reply, [this, reply] {
+            QHash<QNetworkReply*, Request>::iterator it = _requests.find(reply);
+
+            if (it != _requests.end()) it.value().paced = false;
+
+            emit reply->readyRead();
+        });
+    }
+
+    return granted > 0 ? reply->read(granted) : QByteArray();
+}
+
+// _objectParams
+QStringHash Client::_objectParams(const RequestContext &context)
+{
+    return {
+        { "objectKey", context.objectKey },
+        { "filePath", context.filePath },
+        { "fileSize", QString::number(context.fileSize) }
+    };
+}
+
+// _objectResources
+QStringHash Client::_objectResources(const QString &bucket, const QString &objectKey)
+{
+    // URL 和签名分别使用的两种编码一次生成
+    QString object;
+    QString objectResource;
+
+    PercentEncoder::encodeObjectKey(objectKey, object, objectResource);
+
+    return {
+        { "bucket", bucket },
+        { "object", object },
+        { "objectResource", objectResource }
+    };
+}
+
+// _listBucket
+void Client::_listBucket(const Job &job)
+{
+    QStringHash headers = {{ HEADER_HOST, _account.endpoint }};
+
+    QByteArray body;
+    QStringHash resources;
+
+    RequestContext context;
+    context.attempt = job.attempt;
+
+    _sendRequest(METHOD_GET, headers, body, listBucketAction, resources, listBucketOperation, context, job);
+}
+
+// _listObject
+void Client::_listObject(const Job &job)
+{
+    ListObjectParams params = job.params.value<ListObjectParams>();
+
+    QStringHash headers = {{ HEADER_HOST, job.bucket + "." + _account.endpoint }};
+
+    QByteArray body;
+
+    QStringHash resources = {{ "bucket", job.bucket }};
+
+    if (params.prefix != "") resources.insert("prefix", params.prefix);
+    if (params.marker != "") resources.insert("marker", params.marker);
+    if (params.delimiter != "") resources.insert("delimiter", params.delimiter);
+    if (params.maxKeys != "") resources.insert("max-keys", params.maxKeys);
+
+    qDebug() << "listObject resources:" << resources;
+
+    RequestContext context;
+    context.attempt = job.attempt;
+
+    _sendRequest(METHOD_GET, headers, body, bucketAction, resources, listObjectOperation, context, job);
+}
+
+// _headObject
+void Client::_headObject(const Job &job)
+{
+    HeadObjectParams params = job.params.value<HeadObjectParams>();
+
+    QStringHash headers = {{ HEADER_HOST, job.bucket + "." + _account.endpoint }};
+
+    if (params.ifModifiedSince != "") headers.insert(HEADER_IF_MODIFIED_SINCE, params.ifModifiedSince);
+
+    QByteArray body;
+
+    QStringHash resources = _objectResources(job.bucket, params.objectKey);
+
+    qDebug() << "headObject resources: " << resources;
+
+    RequestContext context(params.objectKey, params.filePath, params.fileSize);
+    context.attempt = job.attempt;
+
+    _sendRequest(METHOD_HEAD, headers, body, objectAction, resources, headObjectOperation, context, job);
+}
+
+// _getObject
+void Client::_getObject(const Job &job)
+{
+    GetObjectParams params = job.params.value<GetObjectParams>();
+
+    RequestContext context(params.objectKey, params.filePath, params.fileSize);
+    context.attempt = job.attempt;
+
+    QString partPath = params.filePath + DownloadSuffix;
+
+    bool fileFlag = !params.objectKey.endsWith("/");
+
+    if (fileFlag && _downloadContexts.contains(params.filePath))
+    {
+        _scheduler->finish(downloadLane);
+
+        emit errorResponse("文件: " + params.filePath + " 正在下载");
+
+        // 合并的任务等的是正在进行的下载，暂时移开，不让这次拒绝补发给它们
+        QString key = _jobKey(getObjectOperation, params.objectKey, params.filePath);
+        int sharers = _jobSharers.take(key);
+
+        emit getObjectResponse(QNetworkReply::UnknownContentError, _objectParams(context), 0);
+
+        if (sharers > 0) _jobSharers.insert(key, sharers);
+
+        return;
+    }
+
+    // 临时文件旁有同一对象的下载记录时续传
+    bool checkpointFlag = fileFlag && params.range.isEmpty();
+
+    DownloadCheckpoint checkpoint(partPath);
+
+    bool resumed = checkpointFlag &&
+            checkpoint.load() &&
+            checkpoint.objectKey() == params.objectKey &&
+            (params.fileSize == 0 || checkpoint.fileSize() == params.fileSize) &&
+            QFile::exists(partPath);
+
+    if (!resumed) checkpoint.reset(params.objectKey, params.fileSize);
+
+    if (params.fileSize > SegmentThreshold && checkpointFlag)
+    {
+        _getObjectSegmented(params, checkpoint, resumed);
+
+        return;
+    }
+
+    // 单连接下载的数据总是从头连续写入，只需从已写入的末尾继续
+    qint64 offset = resumed ? qMin(checkpoint.prefixSize(), QFileInfo(partPath).size()) : 0;
+
+    if (params.fileSize > 0 && offset >= params.fileSize) offset = params.fileSize - 1;
+
+    if (offset <= 0)
+    {
+        resumed = false;
+
+        checkpoint.reset(params.objectKey, params.fileSize);
+    }
+
+    QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
+
+    if (params.range != "") headers.insert(HEADER_RANGE, "bytes=" + params.range);
+    if (resumed) headers.insert(HEADER_RANGE, QString("bytes=%1-").arg(offset));
+    if (params.ifModifiedSince != "") headers.insert(HEADER_IF_MODIFIED_SINCE, params.ifModifiedSince);
+
+    QByteArray body;
+
+    QStringHash resources = _objectResources(_bucket, params.objectKey);
+
+    if (params.download != "") resources.insert("download", PercentEncoder::encode(params.download));
+    if (params.ifNotFound != "") resources.insert("ifNotFound", PercentEncoder::encode(params.ifNotFound));
+
+    qDebug() << "getObject resources: " << resources << "offset:" << offset;
+
+    // 文件夹对象只需在本地创建目录，由 _getObjectHandler 处理
+    QFile *file = nullptr;
+
+    if (fileFlag)
+    {
+        QString dirPath = QFileInfo(params.filePath).absolutePath();
+
+        QIODevice::OpenMode mode = QIODevice::ReadWrite;
+
+        if (!resumed) mode = QIODevice::WriteOnly|QIODevice::Truncate;
+
+        file = new QFile(partPath);
+
+        if (!QDir().mkpath(dirPath) || !file->open(mode) || !file->resize(offset) || !file->seek(offset))
+        {
+            delete file;
+
+            _scheduler->finish(downloadLane);
+
+            emit errorResponse("文件: " + params.filePath + " 无法写入");
+            emit getObjectResponse(QNetworkReply::UnknownContentError, _objectParams(context), 0);
+
+            return;
+        }
+    }
+
+    if (checkpointFlag)
+    {
+        DownloadContext downloadContext = {
+            .objectKey = params.objectKey,
+            .filePath = params.filePath,
+            .fileSize = params.fileSize,
+            .segmentCount = 1,
+            .finishedCount = 0,
+            .etag = checkpoint.etag(),
+            .error = QNetworkReply::NoError,
+            .resumed = resumed,
+            .restart = false,
+            .discard = false,
+            .checkpoint = checkpoint
+        };
+
+        _downloadContexts.insert(params.filePath, downloadContext);
+    }
+
+    QNetworkReply *reply = _sendRequest(METHOD_GET, headers, body, objectAction, resources, getObjectOperation, context, job);
+
+    if (!file) return;
+
+    // 数据到达即写入临时文件，不在内存中缓存整个对象
+    file->setParent(reply);
+
+    _requests[reply].file = file;
+
+    QString filePath = params.filePath;
+
+    // 限制缓冲区大小，限速时未读取的数据会让连接暂停接收
+    reply->setReadBufferSize(DownloadBufferSize);
+
+    // 续传前先确认对象未被修改，且服务端按请求的位置返回数据
+    connect(reply, &QNetworkReply::metaDataChanged, file, [this, reply, file, filePath] {
+        QHash<QString, DownloadContext>::iterator it = _downloadContexts.find(filePath);
+
+        if (it == _downloadContexts.end()) return;
+
+        DownloadContext &context = it.value();
+
+        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        QString etag = reply->rawHeader("ETag");
+        QString contentRange = reply->rawHeader("Content-Range");
+
+        if (!context.resumed)
+        {
+            if (statusCode != 200) return;
+
+            context.etag = etag;
+            context.checkpoint.setEtag(etag);
+            context.checkpoint.save();
+
+            return;
+        }
+
+        if (statusCode == 416 ||
+                ((statusCode == 200 || statusCode == 206) && etag != context.etag) ||
+                (statusCode == 206 && !contentRange.startsWith(QString("bytes %1-").arg(file->pos()))))
+        {
+            qDebug() << "getObject resume mismatch:" << filePath << "etag:" << etag << "expected:" << context.etag << "Content-Range:" << contentRange;
+
+            context.restart = true;
+
+            reply->abort();
+
+            return;
+        }
+
+        // 服务端忽略了 Range，从头写入
+        if (statusCode == 200 && file->pos() > 0)
+        {
+            file->seek(0);
+            file->resize(0);
+
+            context.checkpoint.reset(context.objectKey, context.fileSize);
+            context.checkpoint.setEtag(etag);
+            context.checkpoint.save();
+        }
+    });
+
+    connect(reply, &QNetworkReply::readyRead, file, [this, reply, file, filePath] {
+        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+        // 错误响应的内容不写入文件
+        if (statusCode != 200 && statusCode != 206)
+        {
+            reply->readAll();
+
+            return;
+        }
+
+        QByteArray data = _readPaced(reply);
+
+        if (data.isEmpty()) return;
+
+        if (file->write(data) < 0 || !file->flush())
+        {
+            reply->abort();
+
+            return;
+        }
+
+        QHash<QString, DownloadContext>::iterator it = _downloadContexts.find(filePath);
+
+        if (it != _downloadContexts.end()) it.value().checkpoint.update(0, file->pos());
+    });
+}
+
+// _getObjectSegmented
+void Client::_getObjectSegmented(const GetObjectParams &params, DownloadCheckpoint &checkpoint, bool resumed)
+{
+    // 拆分任务本身不发请求，释放占用的位置给各分段
+    _scheduler->finish(downloadLane);
+
+    QFile file(params.filePath + DownloadSuffix);
+
+    // 续传时临时文件必须是完整预分配过的
+    if (resumed && file.size() != params.fileSize) resumed = false;
+
+    if (!resumed)
+    {
+        checkpoint.reset(params.objectKey, params.fileSize);
+
+        // 预分配临时文件，各分段直接写入各自的偏移位置
+        if (!QDir().mkpath(QFileInfo(params.filePath).absolutePath()) ||
+                !file.open(QIODevice::WriteOnly|QIODevice::Truncate) ||
+                !file.resize(params.fileSize))
+        {
+            file.close();
+            file.remove();
+
+            RequestContext context(params.objectKey, params.filePath, params.fileSize);
+
+            emit errorResponse("文件: " + params.filePath + " 无法写入");
+            emit getObjectResponse(QNetworkReply::UnknownContentError, _objectParams(context), 0);
+
+            return;
+        }
+
+        file.close();
+    }
+
+    // 只下载记录中缺少的部分
+    QList<GetObjectSegmentParams> segments;
+
+    foreach (const ByteRange &range, checkpoint.missingRanges())
+    {
+        for (qint64 offset = range.first; offset < range.second; offset += SegmentSize)
+        {
+            qint64 size = range.second - offset;
+
+            if (size > SegmentSize) size = SegmentSize;
+
+            GetObjectSegmentParams segmentParams = {
+                .objectKey = params.objectKey,
+                .filePath = params.filePath,
+                .offset = offset,
+                .size = size
+            };
+
+            segments.append(segmentParams);
+        }
+    }
+
+    qDebug() << "getObjectSegmented:" << params.objectKey << "resumed:" << resumed << "segments:" << segments.size();
+
+    DownloadContext context = {
+        .objectKey = params.objectKey,
+        .filePath = params.filePath,
+        .fileSize = params.fileSize,
+        .segmentCount = segments.size(),
+        .finishedCount = 0,
+        .etag = checkpoint.etag(),
+        .error = QNetworkReply::NoError,
+        .resumed = resumed,
+        .restart = false,
+        .discard = false,
+        .checkpoint = checkpoint
+    };
+
+    _downloadContexts.insert(params.filePath, context);
+
+    // 上次已全部下载，只差改名
+    if (segments.isEmpty())
+    {
+        _finishObjectSegment(params.filePath);
+
+        return;
+    }
+
+    foreach (const GetObjectSegmentParams &segmentParams, segments)
+    {
+        Job segmentJob(getObjectSegmentOperation, QVariant::fromValue<GetObjectSegmentParams>(segmentParams));
+
+        _scheduler->push(laneOf(segmentJob.operation), segmentJob);
+    }
+}
+
+// _getObjectSegment
+void Client::_getObjectSegment(const Job &job)
+{
+    GetObjectSegmentParams params = job.params.value<GetObjectSegmentParams>();
+
+    // 其他分段已失败，剩余分段不再请求
+    if (_downloadContexts.value(params.filePath).error != QNetworkReply::NoError)
+    {
+        _scheduler->finish(downloadLane);
+
+        _finishObjectSegment(params.filePath);
+
+        return;
+    }
+
+    QFile *file = new QFile(params.filePath + DownloadSuffix);
+
+    if (!file->open(QIODevice::ReadWrite) || !file->seek(params.offset))
+    {
+        delete file;
+
+        _scheduler->finish(downloadLane);
+
+        _downloadContexts[params.filePath].error = QNetworkReply::UnknownContentError;
+
+        _finishObjectSegment(params.filePath);
+
+        return;
+    }
+
+    QStringHash headers = {
+        { HEADER_HOST, _bucket + "." + _account.endpoint },
+        { HEADER_RANGE, QString("bytes=%1-%2").arg(params.offset).arg(params.offset + params.size - 1) }
+    };
+
+    QByteArray body;
+
+    QStringHash resources = _objectResources(_bucket, params.objectKey);
+
+    RequestContext context(params.objectKey, params.filePath);
+    context.offset = params.offset;
+    context.size = params.size;
+    context.attempt = job.attempt;
+
+    QNetworkReply *reply = _sendRequest(METHOD_GET, headers, body, objectAction, resources, getObjectSegmentOperation, context, job);
+
+    file->setParent(reply);
+
+    _requests[reply].file = file;
+
+    reply->setReadBufferSize(DownloadBufferSize);
+
+    connect(reply, &QNetworkReply::readyRead, file, [this, reply, file] {
+        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+        // 错误响应的内容不能写入其他分段的位置
+        if (statusCode != 206)
+        {
+            reply->readAll();
+
+            return;
+        }
+
+        if (file->write(_readPaced(reply)) < 0) reply->abort();
+    });
+}
+
+// _finishObjectSegment
+void Client::_finishObjectSegment(const QString &filePath)
+{
+    QHash<QString, DownloadContext>::iterator it = _downloadContexts.find(filePath);
+
+    if (it == _downloadContexts.end()) return;
+
+    DownloadContext &context = it.value();
+
+    if (++context.finishedCount < context.segmentCount) return;
+
+    DownloadContext done = context;
+
+    _downloadContexts.erase(it);
+
+    QStringHash params = {
+        { "objectKey", done.objectKey },
+        { "filePath", done.filePath }
+    };
+
+    QFile file(done.filePath + DownloadSuffix);
+
+    // 对象已被修改，丢弃已下载的内容重新下载
+    if (done.restart && !done.discard)
+    {
+        file.remove();
+        done.checkpoint.remove();
+
+        _restartDownload(done.objectKey, done.filePath, done.fileSize);
+
+        return;
+    }
+
+    if (done.error != QNetworkReply::NoError)
+    {
+        // 保留临时文件和下载记录，下次下载同一对象时续传
+        if (!done.discard && !done.checkpoint.etag().isEmpty() && file.size() == done.fileSize)
+            done.checkpoint.save();
+        else
+        {
+            file.remove();
+            done.checkpoint.remove();
+        }
+
+        emit getObjectResponse(done.error, params, 0);
+
+        return;
+    }
 
-            resource = "/" + resources["bucket"] + "/" + object;
+    done.checkpoint.remove();
 
-            break;
+    // 校验合并后的文件大小
+    if (file.size() != done.fileSize)
+    {
+        file.remove();
+
+        emit getObjectResponse(QNetworkReply::UnknownContentError, params, 0);
+
+        return;
+    }
+
+    if (QFile::exists(done.filePath)) QFile::remove(done.filePath);
+
+    if (!file.rename(done.filePath))
+    {
+        file.remove();
+
+        emit errorResponse("文件: " + done.filePath + " 无法写入");
+        emit getObjectResponse(QNetworkReply::UnknownContentError, params, 0);
+
+        return;
     }
 
-    QStringHash::const_iterator rci;
-    QStringMap params;
+    emit getObjectResponse(QNetworkReply::NoError, params, done.fileSize);
+}
+
+// _restartDownload
+void Client::_restartDownload(const QString &objectKey, const QString &filePath, qint64 fileSize)
+{
+    qDebug() << "restart download:" << objectKey << "=>" << filePath;
+
+    GetObjectParams params(objectKey, filePath, "", "", "", "", fileSize);
+
+    Job job(getObjectOperation, QVariant::fromValue<GetObjectParams>(params));
+
+    _scheduler->push(laneOf(job.operation), job);
+}
+
+// _putObject
+void Client::_putObject(const Job &job)
+{
+    PutObjectParams params = job.params.value<PutObjectParams>();
+
+    RequestContext context(params.objectKey, params.filePath, params.fileSize);
+    context.attempt = job.attempt;
 
-    for (rci = resources.cbegin(); rci != resources.cend(); ++rci)
+    QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
+
+    QStringHash resources = _objectResources(_bucket, params.objectKey);
+
+    qDebug() << "putObject resources: " << resources;
+
+    qint64 fileSize = params.filePath.isEmpty() ? 0 : QFileInfo(params.filePath).size();
+
+    if (fileSize > MultipartThreshold)
+    {
+        PutBigObjectParams bigParams(params);
+
+        // 沿用 putObject 占用的位置
+        _putBigObject(bigParams);
+
+        return;
+    }
+
+    // 空文件和新建文件夹没有请求体
+    if (fileSize == 0)
     {
-        QString key = rci.key();
+        if (!params.filePath.isEmpty() && !QFileInfo(params.filePath).isReadable())
+        {
+            _scheduler->finish(uploadLane);
+
+            emit errorResponse("文件: " + params.filePath + " 无法打开");
+            emit putObjectResponse(QNetworkReply::UnknownContentError, _objectParams(context), QStringHash());
+
+            return;
+        }
+
+        _sendRequest(METHOD_PUT, headers, QByteArray(), objectAction, resources, putObjectOperation, context, job);
+
+        return;
+    }
+
+    // MD5 在线程池中计算，算好后文件内容直接从映射区发送，不读入内存
+    QFuture<QByteArray> digest = QtConcurrent::run(_hashPool, &Client::_fileSliceMd5, params.filePath, qint64(0), fileSize);
+
+    QFutureWatcher<QByteArray> *watcher = new QFutureWatcher<QByteArray>(this);
 
-        if (key != "bucket" && key != "object")
+    _putWatchers.insert(watcher, params.objectKey);
+
+    connect(watcher, &QFutureWatcher<QByteArray>::finished, this, [=] {
+        QByteArray bodyHash = watcher->result();
+
+        watcher->deleteLater();
+
+        _putWatchers.remove(watcher);
+
+        FileSliceDevice *device = new FileSliceDevice(params.filePath, 0, fileSize);
+
+        if (bodyHash.isEmpty() || !device->open(QIODevice::ReadOnly))
         {
-            params.insert(key, rci.value());
+            delete device;
+
+            _scheduler->finish(uploadLane);
+
+            emit errorResponse("文件: " + params.filePath + " 无法打开");
+            emit putObjectResponse(QNetworkReply::UnknownContentError, _objectParams(context), QStringHash());
+
+            _work();
+
+            return;
         }
+
+        _sendRequest(METHOD_PUT, headers, device, bodyHash, objectAction, resources, putObjectOperation, context, job);
+    });
+
+    watcher->setFuture(digest);
+}
+
+// _deleteObject
+void Client::_deleteObject(const Job &job)
+{
+    DeleteObjectParams params = job.params.value<DeleteObjectParams>();
+
+    QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
+
+    QByteArray body;
+
+    QStringHash resources = _objectResources(_bucket, params.objectKey);
+
+    qDebug() << "deleteObject resources: " << resources;
+
+    RequestContext context(params.objectKey);
+    context.attempt = job.attempt;
+
+    _sendRequest(METHOD_DELETE, headers, body, objectAction, resources, deleteObjectOperation, context, job);
+}
+
+// _deleteObjects
+void Client::_deleteObjects(const Job &job)
+{
+    DeleteObjectsParams params = job.params.value<DeleteObjectsParams>();
+
+    QStringHash headers;
+    headers.insert(HEADER_HOST, _bucket + "." + _account.endpoint);
+    headers.insert(HEADER_CONTENT_TYPE, "application/xml");
+
+    QByteArray body = "<Delete><Quiet>true</Quiet>";
+
+    foreach (auto objectKey, params.objectKeys)
+        body.append("<Object><Key>" + objectKey + "</Key></Object>");
+
+    body.append("</Delete>");
+
+    QStringHash resources = {
+        { "bucket", _bucket },
+        { "delete", "" }
+    };
+
+    qDebug() << "deleteObject resources: " << resources;
+
+    RequestContext context;
+    context.attempt = job.attempt;
+
+    _sendRequest(METHOD_POST, headers, body, bucketAction, resources, deleteObjectsOperation, context, job);
+}
+
+// _copyObject
+void Client::_copyObject(const Job &job)
+{
+    CopyObjectParams params = job.params.value<CopyObjectParams>();
+
+    QStringHash headers = {
+        { HEADER_HOST, params.destinationBucketName + "." + _account.endpoint },
+        { HEADER_X_NOS_COPY_SOURCE, PercentEncoder::encode("/" + params.sourceBucketName + "/" + params.sourceObjectKey) }
+    };
+
+    QByteArray body;
+
+    QStringHash resources = _objectResources(params.sourceBucketName, params.destinationObjectKey);
+
+    qDebug() << "copyObject resources: " << resources;
+
+    RequestContext context;
+    context.sourceBucketName = params.sourceBucketName;
+    context.sourceObjectKey = params.sourceObjectKey;
+    context.destinationBucketName = params.destinationBucketName;
+    context.destinationObjectKey = params.destinationObjectKey;
+    context.attempt = job.attempt;
+
+    _sendRequest(METHOD_PUT, headers, body, objectAction, resources, copyObjectOperation, context, job);
+}
+
+// _moveObject
+void Client::_moveObject(const Job &job)
+{
+    MoveObjectParams params = job.params.value<MoveObjectParams>();
+
+    QStringHash headers = {
+        { HEADER_HOST, params.destinationBucketName + "." + _account.endpoint },
+        { HEADER_X_NOS_MOVE_SOURCE, PercentEncoder::encode("/" + params.sourceBucketName + "/" + params.sourceObjectKey) }
+    };
+
+    QByteArray body;
+
+    QStringHash resources = _objectResources(params.sourceBucketName, params.destinationObjectKey);
+
+    qDebug() << "moveObject resources: " << resources;
+
+    RequestContext context;
+    context.sourceBucketName = params.sourceBucketName;
+    context.sourceObjectKey = params.sourceObjectKey;
+    context.destinationBucketName = params.destinationBucketName;
+    context.destinationObjectKey = params.destinationObjectKey;
+    context.attempt = job.attempt;
+
+    _sendRequest(METHOD_PUT, headers, body, objectAction, resources, moveObjectOperation, context, job);
+}
+
+// _putBigObject
+void Client::_putBigObject(const PutBigObjectParams &params)
+{
+    QFile file(params.filePath);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        file.close();
+
+        QStringHash putParams = {
+            { "objectKey", params.objectKey },
+            { "filePath", params.filePath },
+            { "fileSize", QString::number(params.fileSize) }
+        };
+
+        _scheduler->finish(uploadLane);
+
+        emit errorResponse("文件: " + params.filePath + " 无法打开");
+        emit putObjectResponse(QNetworkReply::UnknownContentError, putParams, QStringHash());
+
+        return;
     }
 
-    QString url = request.url().toString();
+    file.close();
 
-    if (params.size() > 0)
+    // 分块数和分块大小都有上限
+    if (file.size() > MaxPartCount * MaxPartSize)
     {
-        QStringList subResourceList = { "acl", "location", "uploadId", "uploads", "partNumber", "delete" };
+        QStringHash putParams = {
+            { "objectKey", params.objectKey },
+            { "filePath", params.filePath },
+            { "fileSize", QString::number(params.fileSize) }
+        };
+
+        _scheduler->finish(uploadLane);
+
+        emit errorResponse("文件: " + params.filePath + " 超过分块上传的大小上限");
+        emit putObjectResponse(QNetworkReply::UnknownContentError, putParams, QStringHash());
+
+        return;
+    }
+
+    QFileInfo fileInfo(params.filePath);
 
-        QStringList subResources;
-        QStringList query;
-        QStringMap::const_iterator pci;
+    RequestContext context(params.objectKey, params.filePath, params.fileSize);
 
-        for (pci = params.cbegin(); pci != params.cend(); ++pci)
+    // 存在未完成的同一文件上传时续传
+    UploadRecord record;
+
+    if (_uploadJournal->find(_bucket, params.objectKey, record))
+    {
+        if (record.filePath == params.filePath &&
+                record.fileSize == fileInfo.size() &&
+                record.lastModified == fileInfo.lastModified().toMSecsSinceEpoch())
         {
-            QString subQuery = pci.key();
-            if (!pci.value().isEmpty()) subQuery += "=" + pci.value();
+            qDebug() << "resume multipart upload:" << record.objectKey << "uploadId:" << record.uploadId;
+
+            context.uploadId = record.uploadId;
+            context.partSize = record.partSize;
+
+            _registerParts(params.objectKey, record.fileSize, record.partSize);
 
-            query.append(subQuery);
+            _listResumeParts(context);
 
-            if (subResourceList.contains(pci.key())) subResources.append(subQuery);
+            return;
         }
 
-        if (subResources.size() > 0) resource += "?" + subResources.join("&");
+        // 本地文件已变化，放弃旧的上传，由当前的 _work 循环发出
+        AbortMultipartUploadParams abortParams = { .objectKey = record.objectKey, .uploadId = record.uploadId };
 
-        url += "?" + query.join("&");
+        _scheduler->push(laneOf(abortMultipartUploadOperation), Job(abortMultipartUploadOperation, QVariant::fromValue<AbortMultipartUploadParams>(abortParams)));
 
-        request.setUrl(QUrl(url));
+        _uploadJournal->remove(_bucket, params.objectKey);
     }
 
-//    qDebug() << "request url:" << request.url();
+    _initiateMultipartUpload(context);
+}
+
+// _initiateMultipartUpload
+void Client::_initiateMultipartUpload(const RequestContext &context)
+{
+    QStringHash headers = {
+        { HEADER_HOST, _bucket + "." + _account.endpoint },
+        { HEADER_CONTENT_LENGTH, QString::number(QFileInfo(context.filePath).size()) }
+    };
 
-    QString signString = sign.join("\n") + resource;
+    QByteArray body;
 
-//    qDebug() << "sign:" << signString;
+    QStringHash resources = _objectResources(_bucket, context.objectKey);
 
-    QString signature = QMessageAuthenticationCode::hash(signString.toUtf8(),
-                                                         _account.accessSecret.toUtf8(),
-                                                         QCryptographicHash::Sha256).toBase64();
+    resources.insert("uploads", "");
 
-//    qDebug() << "signature:" << signature;
+    qDebug() << "initiateMultipartUpload resources: " << resources;
+
+    _sendRequest(METHOD_POST, headers, body, objectAction, resources, initiateMultipartUploadOperation, context);
+}
+
+// _listResumeParts
+void Client::_listResumeParts(const RequestContext &context, const QString &partNumberMarker)
+{
+    QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
+
+    QByteArray body;
+
+    QStringHash resources = _objectResources(_bucket, context.objectKey);
+
+    resources.insert("uploadId", context.uploadId);
+    resources.insert("max-parts", "1000");
+
+    if (!partNumberMarker.isEmpty()) resources.insert("part-number-marker", partNumberMarker);
+
+    qDebug() << "listResumeParts resources: " << resources;
+
+    _sendRequest(METHOD_GET, headers, body, objectAction, resources, resumeMultipartUploadOperation, context);
+}
+
+// _partSize
+qint64 Client::_partSize(qint64 fileSize) const
+{
+    // 按当前速度每个分块约 PartDuration 传完，过小的分块请求开销占比太高，过大的分块失败重传代价高
+    qint64 partSize = _uploadRate > 0 ? static_cast<qint64>(_uploadRate * PartDuration) : DefaultPartSize;
+
+    if (partSize < MinPartSize) partSize = MinPartSize;
+    if (partSize > MaxPartSize) partSize = MaxPartSize;
+
+    // 分块数不能超过服务端限制
+    qint64 minPartSize = (fileSize + MaxPartCount - 1) / MaxPartCount;
+
+    if (partSize < minPartSize) partSize = minPartSize;
+
+    // 按 1M 对齐
+    return (partSize + 1048575) / 1048576 * 1048576;
+}
+
+// _updateUploadRate
+void Client::_updateUploadRate(qint64 bytes, qint64 startTime)
+{
+    qint64 elapsed = QDateTime::currentMSecsSinceEpoch() - startTime;
+
+    // 小请求主要是往返延迟，不能反映带宽
+    if (bytes < MinPartSize || elapsed <= 0) return;
+
+    double rate = static_cast<double>(bytes) / elapsed;
+
+    _uploadRate = _uploadRate > 0 ? _uploadRate * 0.7 + rate * 0.3 : rate;
+}
+
+// _registerParts
+void Client::_registerParts(const QString &objectKey, qint64 fileSize, qint64 partSize)
+{
+    int partCount = static_cast<int>((fileSize + partSize - 1) / partSize);
+
+    // 先登记全部分块，避免已派发的分块先完成时被误判为上传完成
+    QMap<int, QString> &parts = _partsHash[objectKey];
+    parts.clear();
+
+    for (int part = 1; part <= partCount; ++part) parts.insert(part, "");
+}
+
+// _uploadParts
+void Client::_uploadParts(const QString &uploadId, const RequestContext &context)
+{
+    QString objectKey = context.objectKey;
+    QString filePath = context.filePath;
+    qint64 fileSize = QFileInfo(filePath).size();
+    qint64 partSize = context.partSize;
+
+    const QMap<int, QString> parts = _partsHash.value(objectKey);
+
+    bool completeFlag = true;
+
+    QMap<int, QString>::const_iterator pci;
+
+    // 队列中只保存分块描述（文件、偏移、长度），不读取内容
+    for (pci = parts.cbegin(); pci != parts.cend(); ++pci)
+    {
+        int part = pci.key();
+
+        RequestContext partContext = context;
+        partContext.uploadId = uploadId;
+        partContext.partNumber = part;
+
+        qint64 offset = (part - 1) * partSize;
+        qint64 size = fileSize - offset;
+
+        if (size > partSize) size = partSize;
+
+        // 已上传的分块直接计入进度
+        if (!pci.value().isEmpty())
+        {
+            emit updateProgressResponse(uploadPartOperation, partContext, size);
+
+            continue;
+        }
+
+        completeFlag = false;
+
+        UploadPartParams uploadPartParams = {
+            .objectKey = objectKey,
+            .filePath = filePath,
+            .offset = offset,
+            .size = size,
+            .partNumber = part,
+            .uploadId = uploadId,
+            .context = partContext
+        };
+
+        uploadPart(uploadPartParams);
+    }
+
+    if (completeFlag)
+    {
+        CompleteMultipartUploadParams completeParams = {
+            .objectKey = objectKey,
+            .uploadId = uploadId,
+            .parts = parts,
+            .context = context
+        };
+
+        completeMultipartUpload(completeParams);
+
+        _partsHash.remove(objectKey);
+    }
+}
+
+// _uploadPart
+void Client::_uploadPart(const Job &job)
+{
+    UploadPartParams params = job.params.value<UploadPartParams>();
 
-    request.setRawHeader(HEADER_AUTHORIZATION, ("NOS " + _account.accessKey + ":" + signature).toUtf8());
-}
+    // 同一对象的其他分块已失败，剩余分块不再发送，空出的位置立即交给排队的任务
+    if (!_partsHash.contains(params.objectKey))
+    {
+        _scheduler->finish(uploadLane);
 
-// _getObject
-void Client::_getObject(const Job &job)
-{
-    GetObjectParams params = job.params.value<GetObjectParams>();
+        _work();
 
-    QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
+        return;
+    }
 
-    if (params.range != "") headers.insert(HEADER_RANGE, "bytes=" + params.range);
-    if (params.ifModifiedSince != "") headers.insert(HEADER_IF_MODIFIED_SINCE, params.ifModifiedSince);
+    QFuture<QByteArray> digest = _partDigest(params.objectKey, params.filePath, params.partNumber, params.offset, params.size);
 
-    QByteArray body;
+    // 当前分块计算和发送期间，后续分块的 MD5 在线程池中提前计算
+    _prefetchDigests(params);
 
-    QStringHash resources = {
-        { "bucket", _bucket },
-        { "object", encodeObjectKey(params.objectKey) }
-    };
+    // MD5 算好后再签名发送，期间占用的位置不释放
+    QFutureWatcher<QByteArray> *watcher = new QFutureWatcher<QByteArray>(this);
 
-    if (params.download != "") resources.insert("download", QUrl::toPercentEncoding(params.download));
-    if (params.ifNotFound != "") resources.insert("ifNotFound", QUrl::toPercentEncoding(params.ifNotFound));
+    connect(watcher, &QFutureWatcher<QByteArray>::finished, this, [this, watcher, job] {
+        QByteArray bodyHash = watcher->result();
 
-    qDebug() << "getObject resources: " << resources;
+        watcher->deleteLater();
 
-    QStringHash extras = {
-        { "objectKey", params.objectKey },
-        { "filePath", params.filePath }
-    };
+        _sendUploadPart(job, bodyHash);
+    });
 
-    _sendRequest(METHOD_GET, headers, body, objectAction, resources, getObjectOperation, extras);
+    watcher->setFuture(digest);
 }
 
-// _putObject
-void Client::_putObject(const Job &job)
+// _sendUploadPart
+void Client::_sendUploadPart(const Job &job, const QByteArray &bodyHash)
 {
-    PutObjectParams params = job.params.value<PutObjectParams>();
-
-    QByteArray body;
+    UploadPartParams params = job.params.value<UploadPartParams>();
 
-    if (!params.filePath.isEmpty())
+    // 计算期间其他分块已失败
+    if (!_partsHash.contains(params.objectKey))
     {
-        QFile file(params.filePath);
+        _scheduler->finish(uploadLane);
 
-        if (file.size() > PartSize)
-        {
-            PutBigObjectParams bigParams(params);
+        _work();
 
-            putBigObject(bigParams);
+        return;
+    }
 
-            return;
-        }
+    // 发送时才打开分块，内容直接从映射区发送，内存占用与分块大小无关
+    FileSliceDevice *device = new FileSliceDevice(params.filePath, params.offset, params.size);
 
-        if (!file.open(QIODevice::ReadOnly))
-        {
-            file.close();
+    if (bodyHash.isEmpty() || !device->open(QIODevice::ReadOnly))
+    {
+        delete device;
 
-            emit errorResponse("文件: " + params.filePath + " 无法打开");
+        _partsHash.remove(params.objectKey);
+        _digestHash.remove(params.objectKey);
 
-            return;
-        }
+        _scheduler->finish(uploadLane);
 
-        body = file.readAll();
+        emit errorResponse("文件: " + params.filePath + " 读取失败");
+        emit putObjectResponse(QNetworkReply::UnknownContentError, _objectParams(params.context), QStringHash());
 
-        file.close();
+        _work();
+
+        return;
     }
 
     QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
 
-    QStringHash resources = {
-        { "bucket", _bucket },
-        { "object", encodeObjectKey(params.objectKey) }
-    };
+    QStringHash resources = _objectResources(_bucket, params.objectKey);
 
-    qDebug() << "putObject resources: " << resources;
+    resources.insert("partNumber", QString::number(params.partNumber));
+    resources.insert("uploadId", params.uploadId);
 
-    QStringHash extras = {
-        { "objectKey", params.objectKey },
-        { "filePath", params.filePath },
-        { "fileSize", QString::number(params.fileSize) }
-    };
+    qDebug() << "uploadPart resources: " << resources;
+
+    RequestContext context = params.context;
+    context.attempt = job.attempt;
 
-    _sendRequest(METHOD_PUT, headers, body, objectAction, resources, putObjectOperation, extras);
+    _sendRequest(METHOD_PUT, headers, device, bodyHash, objectAction, resources, uploadPartOperation, context, job);
 }
 
-// _deleteObject
-void Client::_deleteObject(const Job &job)
+// _partDigest
+QFuture<QByteArray> Client::_partDigest(const QString &objectKey, const QString &filePath, int partNumber, qint64 offset, qint64 size)
 {
-    DeleteObjectParams params = job.params.value<DeleteObjectParams>();
-
-    QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
+    QHash<int, QFuture<QByteArray>> &digests = _digestHash[objectKey];
 
-    QByteArray body;
+    QHash<int, QFuture<QByteArray>>::const_iterator ci = digests.constFind(partNumber);
 
-    QStringHash resources = {
-        { "bucket", _bucket },
-        { "object", encodeObjectKey(params.objectKey) }
-    };
+    if (ci != digests.cend()) return ci.value();
 
-    qDebug() << "deleteObject resources: " << resources;
+    QFuture<QByteArray> digest = QtConcurrent::run(_hashPool, &Client::_fileSliceMd5, filePath, offset, size);
 
-    QStringHash extras = {{ "objectKey", params.objectKey }};
+    digests.insert(partNumber, digest);
 
-    _sendRequest(METHOD_DELETE, headers, body, objectAction, resources, deleteObjectOperation, extras);
+    return digest;
 }
 
-// _deleteObjects
-void Client::_deleteObjects(const Job &job)
+// _prefetchDigests
+void Client::_prefetchDigests(const UploadPartParams &params)
 {
-    DeleteObjectsParams params = job.params.value<DeleteObjectsParams>();
+    qint64 partSize = params.context.partSize;
+    qint64 fileSize = QFileInfo(params.filePath).size();
 
-    QStringHash headers;
-    headers.insert(HEADER_HOST, _bucket + "." + _account.endpoint);
-    headers.insert(HEADER_CONTENT_TYPE, "application/xml");
+    if (partSize <= 0) return;
 
-    QByteArray body = "<Delete><Quiet>true</Quiet>";
+    const QMap<int, QString> parts = _partsHash.value(params.objectKey);
 
-    foreach (auto objectKey, params.objectKeys)
-        body.append("<Object><Key>" + objectKey + "</Key></Object>");
+    int count = 0;
 
-    body.append("</Delete>");
+    QMap<int, QString>::const_iterator pci;
 
-    QStringHash resources = {
-        { "bucket", _bucket },
-        { "delete", "" }
-    };
+    for (pci = parts.upperBound(params.partNumber); pci != parts.cend() && count < HashLookahead; ++pci)
+    {
+        // 已上传的分块（续传）不需要
+        if (!pci.value().isEmpty()) continue;
 
-    qDebug() << "deleteObject resources: " << resources;
+        ++count;
+
+        qint64 offset = (pci.key() - 1) * partSize;
+        qint64 size = fileSize - offset;
 
-    QStringHash extras;
+        if (size > partSize) size = partSize;
 
-    _sendRequest(METHOD_POST, headers, body, bucketAction, resources, deleteObjectsOperation, extras);
+        if (size > 0) _partDigest(params.objectKey, params.filePath, pci.key(), offset, size);
+    }
 }
 
-// _copyObject
-void Client::_copyObject(const Job &job)
+// _fileSliceMd5
+QByteArray Client::_fileSliceMd5(const QString &filePath, qint64 offset, qint64 size)
 {
-    CopyObjectParams params = job.params.value<CopyObjectParams>();
+    FileSliceDevice device(filePath, offset, size);
+
+    if (!device.open(QIODevice::ReadOnly)) return QByteArray();
+
+    return device.md5();
+}
+
+// _completeMultipartUpload
+void Client::_completeMultipartUpload(const Job &job)
+{
+    CompleteMultipartUploadParams params = job.params.value<CompleteMultipartUploadParams>();
 
     QStringHash headers = {
-        { HEADER_HOST, params.destinationBucketName + "." + _account.endpoint },
-        { HEADER_X_NOS_COPY_SOURCE, QUrl::toPercentEncoding("/" + params.sourceBucketName + "/" + params.sourceObjectKey) }
+        { HEADER_HOST, _bucket + "." + _account.endpoint },
+        { HEADER_CONTENT_TYPE, "application/xml" }
     };
 
-    QByteArray body;
+    QByteArray body = "<CompleteMultipartUpload>";
 
-    QStringHash resources = {
-        { "bucket", params.sourceBucketName },
-        { "object", encodeObjectKey(params.destinationObjectKey) }
-    };
+    QMap<int, QString>::const_iterator pci;
 
-    qDebug() << "copyObject resources: " << resources;
+    for (pci = params.parts.cbegin(); pci != params.parts.cend(); ++pci)
+        body.append("<Part><PartNumber>" + QString::number(pci.key()) + "</PartNumber><ETag>" + pci.value() + "</ETag></Part>");
 
-    QStringHash extras = {
-        { "sourceObjectKey", params.sourceObjectKey },
-        { "destinationObjectKey", params.destinationObjectKey }
-    };
+    body.append("</CompleteMultipartUpload>");
+
+    QStringHash resources = _objectResources(_bucket, params.objectKey);
+
+    resources.insert("uploadId", params.uploadId);
+
+    qDebug() << "completeMultipartUpload resources: " << resources;
+
+    RequestContext context = params.context;
+    context.attempt = job.attempt;
 
-    _sendRequest(METHOD_PUT, headers, body, objectAction, resources, copyObjectOperation, extras);
+    _sendRequest(METHOD_POST, headers, body, objectAction, resources, completeMultipartUploadOperation, context, job);
 }
 
-// _moveObject
-void Client::_moveObject(const Job &job)
+// _listMultipartUploads
+void Client::_listMultipartUploads(const Job &job)
 {
-    MoveObjectParams params = job.params.value<MoveObjectParams>();
+    ListMultipartUploadsParams params = job.params.value<ListMultipartUploadsParams>();
 
-    QStringHash headers = {
-        { HEADER_HOST, params.destinationBucketName + "." + _account.endpoint },
-        { HEADER_X_NOS_MOVE_SOURCE, QUrl::toPercentEncoding("/" + params.sourceBucketName + "/" + params.sourceObjectKey) }
-    };
+    QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
+
+    if (!params.keyMarker.isEmpty()) headers.insert(HEADER_KEY_MARKER, params.keyMarker);
+    if (!params.maxUploads.isEmpty()) headers.insert(HEADER_MAX_UPLOADS, params.maxUploads);
 
     QByteArray body;
 
     QStringHash resources = {
-        { "bucket", params.sourceBucketName },
-        { "object", encodeObjectKey(params.destinationObjectKey) }
+        { "bucket", _bucket },
+        { "uploads", "" }
     };
 
-    qDebug() << "moveObject resources: " << resources;
+    qDebug() << "listMultipartUploads resources: " << resources;
 
-    QStringHash extras = {
-        { "sourceObjectKey", params.sourceObjectKey },
-        { "destinationObjectKey", params.destinationObjectKey }
-    };
+    RequestContext context;
+    context.attempt = job.attempt;
 
-    _sendRequest(METHOD_PUT, headers, body, objectAction, resources, moveObjectOperation, extras);
+    _sendRequest(METHOD_GET, headers, body, bucketAction, resources, listMultipartUploadsOperation, context, job);
 }
 
-// _uploadPart
-void Client::_uploadPart(const Job &job)
+// _abortMultipartUpload
+void Client::_abortMultipartUpload(const Job &job)
 {
-    UploadPartParams params = job.params.value<UploadPartParams>();
+    AbortMultipartUploadParams params = job.params.value<AbortMultipartUploadParams>();
 
     QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
 
-    QStringHash resources = {
-        { "bucket", _bucket },
-        { "object", encodeObjectKey(params.objectKey) },
-        { "partNumber", QString::number(params.partNumber) },
-        { "uploadId", params.uploadId }
-    };
+    QByteArray body;
 
-    qDebug() << "uploadPart resources: " << resources;
+    QStringHash resources = _objectResources(_bucket, params.objectKey);
+
+    resources.insert("uploadId", params.uploadId);
+
+    qDebug() << "abortMultipartUpload resources: " << resources;
 
-    _partsHash[params.objectKey].insert(params.partNumber, "");
+    // 不记录 objectKey：放弃服务端的上传不随该对象的任务一起取消
+    RequestContext context;
+    context.attempt = job.attempt;
 
-    _sendRequest(METHOD_PUT, headers, params.body, objectAction, resources, uploadPartOperation, params.extras);
+    _sendRequest(METHOD_DELETE, headers, body, objectAction, resources, abortMultipartUploadOperation, context, job);
 }
 
-// _completeMultipartUpload
-void Client::_completeMultipartUpload(const Job &job)
+// _listParts
+void Client::_listParts(const Job &job)
 {
-    CompleteMultipartUploadParams params = job.params.value<CompleteMultipartUploadParams>();
+    ListPartsParams params = job.params.value<ListPartsParams>();
 
-    QStringHash headers = {
-        { HEADER_HOST, _bucket + "." + _account.endpoint },
-        { HEADER_CONTENT_TYPE, "application/xml" }
-    };
+    QStringHash headers = {{ HEADER_HOST, _bucket + "." + _account.endpoint }};
 
-    QByteArray body = "<CompleteMultipartUpload>";
+    QByteArray body;
 
-    QMap<int, QString>::const_iterator pci;
+    QStringHash resources = _objectResources(_bucket, params.objectKey);
 
-    for (pci = params.parts.cbegin(); pci != params.parts.cend(); ++pci)
-        body.append("<Part><PartNumber>" + QString::number(pci.key()) + "</PartNumber><ETag>" + pci.value() + "</ETag></Part>");
+    resources.insert("uploadId", params.uploadId);
 
-    body.append("</CompleteMultipartUpload>");
+    if (!params.maxParts.isEmpty()) resources.insert("max-parts", params.maxParts);
+    if (!params.partNumberMarker.isEmpty()) resources.insert("part-number-marker", params.partNumberMarker);
 
-    QStringHash resources = {
-        { "bucket", _bucket },
-        { "object", encodeObjectKey(params.objectKey) },
-        { "uploadId", params.uploadId }
-    };
+    qDebug() << "listParts resources: " << resources;
 
-    qDebug() << "completeMultipartUpload resources: " << resources;
+    RequestContext context(params.objectKey);
+    context.attempt = job.attempt;
 
-    _sendRequest(METHOD_POST, headers, body, objectAction, resources, completeMultipartUploadOperation, params.extras);
+    _sendRequest(METHOD_GET, headers, body, objectAction, resources, listPartsOperation, context, job);
 }
 
 // _listBucketHandler
-void Client::_listBucketHandler(QNetworkReply *reply)
+void Client::_listBucketHandler(QNetworkReply *reply, const Request &request)
 {
     QList<QString> buckets;
 
-    if (reply->error() != QNetworkReply::NoError)
+    if (request.error != QNetworkReply::NoError)
     {
-        emit listBucketResponse(reply->error(), buckets);
+        emit listBucketResponse(request.error, buckets);
 
         return;
     }
@@ -960,173 +2545,250 @@ void Client::_listBucketHandler(QNetworkReply *reply)
 
     qDebug() << data;
 
-    QDomDocument doc;
-
-    if (!doc.setContent(data))
+    if (!_parseListBucket(data, buckets))
     {
-        emit listBucketResponse(reply->error(), buckets);
+        emit listBucketResponse(request.error, QStringList());
 
         return;
     }
 
-    QDomElement root = doc.documentElement();
+    emit listBucketResponse(request.error, buckets);
+}
 
-    QDomNode node = root.firstChild();
+// _listObjectHandler
+void Client::_listObjectHandler(QNetworkReply *reply, const Request &request)
+{
+    QStringHash params;
+    QStringVector dirs;
+    QVector<File> files;
 
-    while (!node.isNull())
+    if (request.error != QNetworkReply::NoError)
     {
-        if (node.isElement() && node.nodeName() == "Buckets")
-        {
-            QDomNodeList childNodes = node.childNodes();
+        emit listObjectResponse(request.error, params, dirs, files);
 
-            for (int i = 0; i < childNodes.count(); ++i)
-            {
-                QDomNode child = childNodes.at(i);
+        return;
+    }
 
-                QDomNodeList bucketNodes = child.childNodes();
+    QByteArray data = reply->readAll();
 
-                for (int j = 0; j < bucketNodes.count(); ++j)
-                {
-                    QDomNode bucketNode = bucketNodes.at(j);
+//    qDebug() << "listObjectHandler data:" << data;
 
-                    if (bucketNode.isElement() && bucketNode.nodeName() == "Name")
-                        buckets.append(bucketNode.toElement().text());
-                }
-            }
-        }
+    if (!_parseListObject(data, params, dirs, files))
+    {
+        emit listObjectResponse(QNetworkReply::InternalServerError, QStringHash(), QStringVector(), QVector<File>());
 
-        node = node.nextSibling();
+        return;
     }
 
-    emit listBucketResponse(reply->error(), buckets);
+//    qDebug() << "listObjectHandler dirs:" << dirs;
+//    qDebug() << "listObjectHandler files:" << files;
+
+    emit listObjectResponse(request.error, params, dirs, files);
 }
 
-// _listObjectHandler
-void Client::_listObjectHandler(QNetworkReply *reply)
+// _getObjectHandler
+void Client::_getObjectHandler(QNetworkReply *reply, const Request &request, bool retry)
 {
-    QStringHash params;
-    QStringVector dirs;
-    QVector<File> files;
+    QStringHash params = _objectParams(request.context);
+    QFile *file = request.file;
 
-    if (reply->error() != QNetworkReply::NoError)
+    QString filePath = request.context.filePath;
+
+    // 处理历史遗留问题：上传文件夹时未在 NOS 创建对应的目录，因此无论结果如何都创建本地目录
+    if (!file)
     {
-        emit listObjectResponse(reply->error(), params, dirs, files);
+        QDir().mkpath(filePath);
+
+        if (retry)
+        {
+            _scheduleRetry(reply, request);
+
+            return;
+        }
+
+        emit getObjectResponse(request.error, params, 0);
 
         return;
     }
 
-    QByteArray data = reply->readAll();
+    // 指定 Range 的下载没有下载记录
+    QHash<QString, DownloadContext>::iterator it = _downloadContexts.find(filePath);
 
-//    qDebug() << "listObjectHandler data:" << data;
+    bool checkpointFlag = it != _downloadContexts.end();
 
-    QDomDocument doc;
+    DownloadContext context;
 
-    if (!doc.setContent(data))
+    if (checkpointFlag)
     {
-        emit listObjectResponse(QNetworkReply::InternalServerError, params, dirs, files);
+        context = it.value();
 
-        return;
+        _downloadContexts.erase(it);
     }
 
-    QDomElement root = doc.documentElement();
-    QDomNode node = root.firstChild();
+    QNetworkReply::NetworkError error = request.error;
+
+    // 写入失败等内部中止按内容错误处理，OperationCanceledError 只留给 cancelObject
+    if (error == QNetworkReply::OperationCanceledError && !(checkpointFlag && context.error == error)) error = QNetworkReply::UnknownContentError;
+
+    if (error == QNetworkReply::NoError && file->write(reply->readAll()) < 0) error = QNetworkReply::UnknownContentError;
 
-    while (!node.isNull())
+    file->flush();
+
+    qint64 bytesReceived = file->size();
+
+    file->close();
+
+    if (checkpointFlag && context.restart && !context.discard)
     {
-        if (node.isElement())
-        {
-            if (node.nodeName() == "Prefix") params.insert("prefix", node.toElement().text());
-            if (node.nodeName() == "Marker") params.insert("marker", node.toElement().text());
-            if (node.nodeName() == "NextMarker") params.insert("nextMarker", node.toElement().text());
-            if (node.nodeName() == "MaxKeys") params.insert("maxKeys", node.toElement().text());
-            if (node.nodeName() == "IsTruncated") params.insert("isTruncated", node.toElement().text());
+        file->remove();
+        context.checkpoint.remove();
 
-            if (node.nodeName() == "CommonPrefixes")
-            {
-                QDomNodeList childNodes = node.childNodes();
-                QDomNode child = childNodes.at(0);
+        _restartDownload(context.objectKey, filePath, context.fileSize);
 
-                if (child.isElement()) dirs.append(child.toElement().text());
-            }
+        return;
+    }
 
-            if (node.nodeName() == "Contents")
-            {
-                QDomNodeList childNodes = node.childNodes();
+    if (error == QNetworkReply::NoError && checkpointFlag && context.fileSize > 0 && bytesReceived != context.fileSize)
+    {
+        qDebug() << "getObject size mismatch:" << bytesReceived << "expected:" << context.fileSize;
 
-                File file;
+        error = QNetworkReply::UnknownContentError;
 
-                for (int i = 0; i < childNodes.count(); ++i)
-                {
-                    QDomNode child = childNodes.at(i);
-
-                    if (child.isElement())
-                    {
-                        if (child.nodeName() == "Key") file.key = child.toElement().text();
-                        if (child.nodeName() == "Size") file.size = child.toElement().text().toUInt();
-                        if (child.nodeName() == "LastModified")
-                        {
-                            QString lastModified = child.toElement().text();
-
-                            file.lastModified = lastModified.replace("T", " ").replace(" +0800", "");
-                        }
-                    }
-                }
+        context.checkpoint.setEtag("");
+    }
 
-                files.append(file);
-            }
+    if (error != QNetworkReply::NoError)
+    {
+        // 已收到部分内容时保留临时文件和下载记录，下次下载同一对象时续传
+        if (checkpointFlag && !context.discard && !context.checkpoint.etag().isEmpty() && bytesReceived > 0)
+        {
+            context.checkpoint.update(0, bytesReceived);
+            context.checkpoint.save();
+        }
+        else
+        {
+            file->remove();
+
+            if (checkpointFlag) context.checkpoint.remove();
         }
 
-        node = node.nextSibling();
+        // 重新排队后按保存的下载记录续传
+        if (retry)
+        {
+            _scheduleRetry(reply, request);
+
+            return;
+        }
+
+        emit getObjectResponse(error, params, 0);
+
+        return;
     }
 
-//    qDebug() << "listObjectHandler dirs:" << dirs;
-//    qDebug() << "listObjectHandler files:" << files;
+    if (checkpointFlag) context.checkpoint.remove();
+
+    // 下载完成后替换目标文件
+    if (QFile::exists(filePath)) QFile::remove(filePath);
+
+    if (!file->rename(filePath))
+    {
+        file->remove();
+
+        emit errorResponse("文件: " + filePath + " 无法写入");
+        emit getObjectResponse(QNetworkReply::UnknownContentError, params, 0);
+
+        return;
+    }
 
-    emit listObjectResponse(reply->error(), params, dirs, files);
+    emit getObjectResponse(error, params, bytesReceived);
 }
 
-// _getObjectHandler
-void Client::_getObjectHandler(QNetworkReply *reply)
+// _getObjectSegmentHandler
+void Client::_getObjectSegmentHandler(QNetworkReply *reply, const Request &request, bool retry)
 {
-    QByteArray data;
-    QStringHash params = _objectHash.value(reply);
-    QStringHash extras = _extraHash.value(reply);
+    QFile *file = request.file;
+
+    QString filePath = request.context.filePath;
+    qint64 offset = request.context.offset;
+    qint64 size = request.context.size;
+
+    QHash<QString, DownloadContext>::iterator it = _downloadContexts.find(filePath);
+
+    if (it == _downloadContexts.end()) return;
+
+    DownloadContext &context = it.value();
+
+    QNetworkReply::NetworkError error = request.error;
+
+    if (error == QNetworkReply::NoError &&
+            reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 206 &&
+            file->write(reply->readAll()) < 0)
+        error = QNetworkReply::UnknownContentError;
+
+    qint64 bytesWritten = file->pos() - offset;
+
+    file->close();
+
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    QString contentRange = reply->rawHeader("Content-Range");
+    QString expectedRange = QString("bytes %1-%2/%3").arg(offset).arg(offset + size - 1).arg(context.fileSize);
+    QString etag = reply->rawHeader("ETag");
+
+    // 各分段必须来自同一版本的对象，续传时还须与上次记录的版本一致
+    if (statusCode == 206 && !context.etag.isEmpty() && context.etag != etag)
+    {
+        if (context.resumed)
+            context.restart = true;
+        else
+            emit errorResponse("对象: " + context.objectKey + " 在下载过程中已被修改");
+
+        error = QNetworkReply::UnknownContentError;
+    }
+    else if (statusCode == 206 && contentRange == expectedRange)
+    {
+        if (context.etag.isEmpty())
+        {
+            context.etag = etag;
+            context.checkpoint.setEtag(etag);
+        }
+
+        // 中断的分段也记录已写入的部分
+        if (bytesWritten > 0) context.checkpoint.update(offset, offset + qMin(bytesWritten, size));
 
-    params.insert("objectKey", extras["objectKey"]);
-    params.insert("filePath", extras["filePath"]);
+        if (error == QNetworkReply::NoError && bytesWritten != size) error = QNetworkReply::UnknownContentError;
+    }
+    else if (error == QNetworkReply::NoError)
+    {
+        qDebug() << "getObjectSegment range mismatch:" << contentRange << "expected:" << expectedRange << "bytesWritten:" << bytesWritten;
+
+        error = QNetworkReply::UnknownContentError;
+    }
 
-    _extraHash.remove(reply);
-    _objectHash.remove(reply);
+    // 写入失败等内部中止按内容错误处理，OperationCanceledError 只留给 cancelObject
+    if (error == QNetworkReply::OperationCanceledError) error = QNetworkReply::UnknownContentError;
 
-    if (reply->error() != QNetworkReply::NoError)
+    // 其他分段都正常时重新下载这一段，不计入已结束的分段
+    if (retry && context.error == QNetworkReply::NoError && !context.restart)
     {
-        emit getObjectResponse(reply->error(), params, data);
+        _scheduleRetry(reply, request);
 
         return;
     }
 
-    data = reply->readAll();
+    if (error != QNetworkReply::NoError && context.error == QNetworkReply::NoError) context.error = error;
 
-    emit getObjectResponse(reply->error(), params, data);
+    _finishObjectSegment(filePath);
 }
 
 // _headObjectHandler
-void Client::_headObjectHandler(QNetworkReply *reply)
+void Client::_headObjectHandler(QNetworkReply *reply, const Request &request)
 {
     QStringHash headers;
-    QStringHash params = _objectHash.value(reply);
-    QStringHash extras = _extraHash.value(reply);
+    QStringHash params = _objectParams(request.context);
 
-    params.insert("objectKey", extras["objectKey"]);
-    params.insert("filePath", extras["filePath"]);
-    params.insert("fileSize", extras["fileSize"]);
-
-    _extraHash.remove(reply);
-    _objectHash.remove(reply);
-
-    if (reply->error() != QNetworkReply::NoError && reply->error() != QNetworkReply::ContentNotFoundError)
+    if (request.error != QNetworkReply::NoError && request.error != QNetworkReply::ContentNotFoundError)
     {
-        emit headObjectResponse(reply->error(), params, headers);
+        emit headObjectResponse(request.error, params, headers);
 
         return;
     }
@@ -1136,54 +2798,42 @@ void Client::_headObjectHandler(QNetworkReply *reply)
     foreach (QByteArray rawHeader, rawHeaders)
         headers.insert(rawHeader, reply->rawHeader(rawHeader));
 
-    emit headObjectResponse(reply->error(), params, headers);
+    emit headObjectResponse(request.error, params, headers);
 }
 
 // _putObjectHandler
-void Client::_putObjectHandler(QNetworkReply *reply)
+void Client::_putObjectHandler(QNetworkReply *reply, const Request &request)
 {
     QStringHash headers;
-    QStringHash params = _objectHash.value(reply);
-    QStringHash extras = _extraHash.value(reply);
-
-    params.insert("objectKey", extras["objectKey"]);
-    params.insert("filePath", extras["filePath"]);
-    params.insert("fileSize", extras["fileSize"]);
-
-    _extraHash.remove(reply);
-    _objectHash.remove(reply);
+    QStringHash params = _objectParams(request.context);
 
-    if (reply->error() != QNetworkReply::NoError)
+    if (request.error != QNetworkReply::NoError)
     {
-        emit putObjectResponse(reply->error(), params, headers);
+        emit putObjectResponse(request.error, params, headers);
 
         return;
     }
 
+    _updateUploadRate(request.bodySize, request.startTime);
+
     QList<QByteArray> rawHeaders = reply->rawHeaderList();
 
     foreach (QByteArray rawHeader, rawHeaders)
         headers.insert(rawHeader, reply->rawHeader(rawHeader));
 
-    emit putObjectResponse(reply->error(), params, headers);
+    emit putObjectResponse(request.error, params, headers);
 }
 
 // _deleteObjectHandler
-void Client::_deleteObjectHandler(QNetworkReply *reply)
+void Client::_deleteObjectHandler(QNetworkReply *reply, const Request &request)
 {
-    QStringHash params = _objectHash.value(reply);
-    QStringHash extras = _extraHash.value(reply);
-
-    params.insert("objectKey", extras["objectKey"]);
+    QStringHash params = {{ "objectKey", request.context.objectKey }};
 
-    _extraHash.remove(reply);
-    _objectHash.remove(reply);
-
-    emit deleteObjectResponse(reply->error(), params);
+    emit deleteObjectResponse(request.error, params);
 }
 
 // _deleteObjectsHandler
-void Client::_deleteObjectsHandler(QNetworkReply *reply)
+void Client::_deleteObjectsHandler(QNetworkReply *reply, const Request &request)
 {
     QStringHash params;
     QStringHash headers;
@@ -1192,52 +2842,19 @@ void Client::_deleteObjectsHandler(QNetworkReply *reply)
 
     qDebug() << "deleteObjectsHandler data:" << data;
 
-    QDomDocument doc;
-
-    if (!doc.setContent(data))
+    if (request.error != QNetworkReply::NoError)
     {
-        emit deleteObjectsResponse(QNetworkReply::InternalServerError, params, headers);
+        emit deleteObjectsResponse(request.error, params, headers);
 
         return;
     }
 
-    QDomElement root = doc.documentElement();
-    QDomNode node = root.firstChild();
-
-    while (!node.isNull())
+    // 成功的响应必须能解析出删除结果，不能时按服务端错误处理
+    if (!_parseDeleteObjects(data, params))
     {
-        if (node.isElement())
-        {
-            if (node.nodeName() == "Deleted")
-            {
-                QDomNodeList childNodes = node.childNodes();
-                QDomNode child = childNodes.at(0);
-
-                if (child.isElement()) params.insert(child.toElement().text(), "Deleted");
-            }
-            else if (node.nodeName() == "Error")
-            {
-                QDomNodeList childNodes = node.childNodes();
-
-                QString objectKey;
-                QString message;
-
-                for (int i = 0; i < childNodes.count(); ++i)
-                {
-                    QDomNode child = childNodes.at(i);
-
-                    if (child.isElement())
-                    {
-                        if (child.nodeName() == "Key") objectKey = child.toElement().text();
-                        if (child.nodeName() == "Message") message = child.toElement().text();
-                    }
-                }
-
-                params.insert(objectKey, "Error: " + message);
-            }
-        }
+        emit deleteObjectsResponse(QNetworkReply::InternalServerError, QStringHash(), headers);
 
-        node = node.nextSibling();
+        return;
     }
 
     QList<QByteArray> rawHeaders = reply->rawHeaderList();
@@ -1245,57 +2862,44 @@ void Client::_deleteObjectsHandler(QNetworkReply *reply)
     foreach (QByteArray rawHeader, rawHeaders)
         headers.insert(rawHeader, reply->rawHeader(rawHeader));
 
-    emit deleteObjectsResponse(reply->error(), params, headers);
+    emit deleteObjectsResponse(request.error, params, headers);
 }
 
 // _copyObjectHandler
-void Client::_copyObjectHandler(QNetworkReply *reply)
+void Client::_copyObjectHandler(QNetworkReply *reply, const Request &request)
 {
-    QStringHash params = _objectHash.value(reply);
-    QStringHash extras = _extraHash.value(reply);
-
-    params.insert("sourceObjectKey", extras["sourceObjectKey"]);
-    params.insert("destinationObjectKey", extras["destinationObjectKey"]);
-
-    _extraHash.remove(reply);
-    _objectHash.remove(reply);
+    QStringHash params = {
+        { "sourceBucketName", request.context.sourceBucketName },
+        { "sourceObjectKey", request.context.sourceObjectKey },
+        { "destinationBucketName", request.context.destinationBucketName },
+        { "destinationObjectKey", request.context.destinationObjectKey }
+    };
 
-    emit copyObjectResponse(reply->error(), params);
+    emit copyObjectResponse(request.error, params);
 }
 
 // _moveObjectHandler
-void Client::_moveObjectHandler(QNetworkReply *reply)
+void Client::_moveObjectHandler(QNetworkReply *reply, const Request &request)
 {
-    QStringHash params = _objectHash.value(reply);
-    QStringHash extras = _extraHash.value(reply);
-
-    params.insert("sourceObjectKey", extras["sourceObjectKey"]);
-    params.insert("destinationObjectKey", extras["destinationObjectKey"]);
-
-    _extraHash.remove(reply);
-    _objectHash.remove(reply);
+    QStringHash params = {
+        { "sourceBucketName", request.context.sourceBucketName },
+        { "sourceObjectKey", request.context.sourceObjectKey },
+        { "destinationBucketName", request.context.destinationBucketName },
+        { "destinationObjectKey", request.context.destinationObjectKey }
+    };
 
-    emit moveObjectResponse(reply->error(), params);
+    emit moveObjectResponse(request.error, params);
 }
 
 // _initiateMultipartUploadHandler
-void Client::_initiateMultipartUploadHandler(QNetworkReply *reply)
+void Client::_initiateMultipartUploadHandler(QNetworkReply *reply, const Request &request)
 {
-    QStringHash params = _objectHash.value(reply);
-    QStringHash extras = _extraHash.value(reply);
-
-    params.insert("objectKey", extras["objectKey"]);
-    params.insert("filePath", extras["filePath"]);
-    params.insert("fileSize", extras["fileSize"]);
-
-    _extraHash.remove(reply);
-    _objectHash.remove(reply);
-
+    QStringHash params = _objectParams(request.context);
     QStringHash headers;
 
-    if (reply->error() != QNetworkReply::NoError)
+    if (request.error != QNetworkReply::NoError)
     {
-        emit putObjectResponse(reply->error(), params, headers);
+        emit putObjectResponse(request.error, params, headers);
 
         return;
     }
@@ -1304,86 +2908,77 @@ void Client::_initiateMultipartUploadHandler(QNetworkReply *reply)
 
     qDebug() << "initiateMultipartUploadHandler data:" << data;
 
-    QDomDocument doc;
+    QStringHash uploadParams;
 
-    if (!doc.setContent(data))
+    if (!_parseResult(data, { { "Bucket", "bucket" }, { "Key", "key" }, { "UploadId", "uploadId" } }, uploadParams))
     {
         emit putObjectResponse(QNetworkReply::InternalServerError, params, headers);
 
         return;
     }
 
-    QDomElement root = doc.documentElement();
-    QDomNode node = root.firstChild();
-
-    QStringHash uploadParams;
-
-    while (!node.isNull())
-    {
-        if (node.isElement())
-        {
-            if (node.nodeName() == "Bucket") uploadParams.insert("bucket", node.toElement().text());
-            if (node.nodeName() == "Key") uploadParams.insert("key", node.toElement().text());
-            if (node.nodeName() == "UploadId") uploadParams.insert("uploadId", node.toElement().text());
-        }
-
-        node = node.nextSibling();
-    }
+    RequestContext context = request.context;
 
-    QFile file(params["filePath"]);
+    QString objectKey = context.objectKey;
+    QString filePath = context.filePath;
 
-    file.open(QIODevice::ReadOnly);
+    QFileInfo fileInfo(filePath);
 
-    int part = 1;
+    qint64 partSize = _partSize(fileInfo.size());
 
-    while (!file.atEnd()) {
-        extras.insert("part", QString::number(part));
+    qDebug() << "multipart upload:" << objectKey << "partSize:" << partSize << "uploadRate:" << _uploadRate;
 
-        QByteArray partBody = file.read(PartSize);
+    context.partSize = partSize;
 
-        UploadPartParams uploadPartParams = {
-            .objectKey = uploadParams["key"],
-            .body = partBody,
-            .partNumber = part,
-            .uploadId = uploadParams["uploadId"],
-            .extras = extras
-        };
+    // 记录上传信息，中断后可续传
+    UploadRecord record;
+    record.bucket = _bucket;
+    record.objectKey = objectKey;
+    record.filePath = filePath;
+    record.fileSize = fileInfo.size();
+    record.lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+    record.partSize = partSize;
+    record.uploadId = uploadParams["uploadId"];
 
-        uploadPart(uploadPartParams);
+    _uploadJournal->save(record);
 
-        ++part;
-    }
+    _registerParts(objectKey, record.fileSize, record.partSize);
 
-    file.close();
+    _uploadParts(record.uploadId, context);
 }
 
 // _uploadPartHandler
-void Client::_uploadPartHandler(QNetworkReply *reply)
+void Client::_uploadPartHandler(QNetworkReply *reply, const Request &request)
 {
-    QStringHash params = _objectHash.value(reply);
-    QStringHash extras = _extraHash.value(reply);
-
-    QString objectKey = params["objectKey"];
+    const RequestContext &context = request.context;
 
-    params.insert("objectKey", extras["objectKey"]);
-    params.insert("filePath", extras["filePath"]);
-    params.insert("fileSize", extras["fileSize"]);
-
-    _extraHash.remove(reply);
-    _objectHash.remove(reply);
+    QString objectKey = context.objectKey;
+    int partNumber = context.partNumber;
 
+    QStringHash params = _objectParams(context);
     QStringHash headers;
 
-    if (reply->error() != QNetworkReply::NoError)
+    // 该对象已有分块失败并已通知
+    if (!_partsHash.contains(objectKey)) return;
+
+    if (request.error != QNetworkReply::NoError)
     {
-        emit putObjectResponse(reply->error(), params, headers);
+        _partsHash.remove(objectKey);
+        _digestHash.remove(objectKey);
+
+        emit putObjectResponse(request.error, params, headers);
 
         return;
     }
 
+    _updateUploadRate(request.bodySize, request.startTime);
+
     QString etag = reply->rawHeader("ETag");
 
-    _partsHash[objectKey][params["partNumber"].toInt()] = etag;
+    _partsHash[objectKey][partNumber] = etag;
+    _digestHash[objectKey].remove(partNumber);
+
+    _uploadJournal->setPart(_bucket, objectKey, partNumber, etag);
 
     bool completeFlag = true;
 
@@ -1405,59 +3000,41 @@ void Client::_uploadPartHandler(QNetworkReply *reply)
     {
         CompleteMultipartUploadParams completeParams = {
             .objectKey = objectKey,
-            .uploadId = params["uploadId"],
+            .uploadId = context.uploadId,
             .parts = _partsHash[objectKey],
-            .extras = extras
+            .context = context
         };
 
         completeMultipartUpload(completeParams);
 
         _partsHash.remove(objectKey);
+        _digestHash.remove(objectKey);
     }
 }
 
 // _completeMultipartUploadHandler
-void Client::_completeMultipartUploadHandler(QNetworkReply *reply)
+void Client::_completeMultipartUploadHandler(QNetworkReply *reply, const Request &request)
 {
-    QStringHash params = _objectHash.value(reply);
-    QStringHash extras = _extraHash.value(reply);
-
-    params.insert("objectKey", extras["objectKey"]);
-    params.insert("filePath", extras["filePath"]);
-    params.insert("fileSize", extras["fileSize"]);
-
-    _extraHash.remove(reply);
-    _objectHash.remove(reply);
-
+    QStringHash params = _objectParams(request.context);
     QStringHash headers;
 
     QByteArray data = reply->readAll();
 
     qDebug() << "completeMultipartUploadHandler data:" << data;
 
-    QDomDocument doc;
-
-    if (!doc.setContent(data))
+    if (request.error != QNetworkReply::NoError)
     {
-        emit putObjectResponse(QNetworkReply::InternalServerError, params, headers);
+        emit putObjectResponse(request.error, params, headers);
 
         return;
     }
 
-    QDomElement root = doc.documentElement();
-    QDomNode node = root.firstChild();
-
-    while (!node.isNull())
+    // 成功的响应必须带有合并结果，没有时按服务端错误处理
+    if (!_parseResult(data, { { "Location", "location" }, { "Bucket", "bucket" }, { "Key", "key" }, { "ETag", "etag" } }, params))
     {
-        if (node.isElement())
-        {
-            if (node.nodeName() == "Location") params.insert("location", node.toElement().text());
-            if (node.nodeName() == "Bucket") params.insert("bucket", node.toElement().text());
-            if (node.nodeName() == "Key") params.insert("key", node.toElement().text());
-            if (node.nodeName() == "ETag") params.insert("etag", node.toElement().text());
-        }
+        emit putObjectResponse(QNetworkReply::InternalServerError, _objectParams(request.context), headers);
 
-        node = node.nextSibling();
+        return;
     }
 
     QList<QByteArray> rawHeaders = reply->rawHeaderList();
@@ -1465,18 +3042,20 @@ void Client::_completeMultipartUploadHandler(QNetworkReply *reply)
     foreach (QByteArray rawHeader, rawHeaders)
         headers.insert(rawHeader, reply->rawHeader(rawHeader));
 
-    emit putObjectResponse(reply->error(), params, headers);
+    _uploadJournal->remove(_bucket, request.context.objectKey);
+
+    emit putObjectResponse(request.error, params, headers);
 }
 
 // _listMultipartUploadsHandler
-void Client::_listMultipartUploadsHandler(QNetworkReply *reply)
+void Client::_listMultipartUploadsHandler(QNetworkReply *reply, const Request &request)
 {
     QStringHash params;
     QList<QHash<QString, QVariant>> uploads;
 
-    if (reply->error() != QNetworkReply::NoError)
+    if (request.error != QNetworkReply::NoError)
     {
-        emit listMultipartUploadsResponse(reply->error(), params, uploads);
+        emit listMultipartUploadsResponse(request.error, params, uploads);
 
         return;
     }
@@ -1485,186 +3064,403 @@ void Client::_listMultipartUploadsHandler(QNetworkReply *reply)
 
     qDebug() << "listMultipartUploadsHandler data:" << data;
 
-    QDomDocument doc;
-
-    if (!doc.setContent(data))
+    if (!_parseListMultipartUploads(data, params, uploads))
     {
-        emit listMultipartUploadsResponse(QNetworkReply::InternalServerError, params, uploads);
+        emit listMultipartUploadsResponse(QNetworkReply::InternalServerError, QStringHash(), QList<QHash<QString, QVariant>>());
 
         return;
     }
 
-    QDomElement root = doc.documentElement();
-    QDomNode node = root.firstChild();
+    emit listMultipartUploadsResponse(request.error, params, uploads);
+}
 
-    while (!node.isNull())
+// _abortMultipartUploadHandler
+void Client::_abortMultipartUploadHandler(QNetworkReply *reply, const Request &request)
+{
+    if (request.error != QNetworkReply::NoError)
     {
-        if (node.isElement())
-        {
-            if (node.nodeName() == "Bucket") params.insert("bucket", node.toElement().text());
-            if (node.nodeName() == "NextKeyMarker") params.insert("nextKeyMarker", node.toElement().text());
-            if (node.nodeName() == "IsTruncated") params.insert("isTruncated", node.toElement().text());
+        emit abortMultipartUploadResponse(request.error);
 
-            if (node.nodeName() == "Upload")
-            {
-                QDomNodeList childNodes = node.childNodes();
+        return;
+    }
 
-                QHash<QString, QVariant> upload;
+    QByteArray data = reply->readAll();
 
-                for (int i = 0; i < childNodes.count(); ++i)
-                {
-                    QDomNode child = childNodes.at(i);
+    qDebug() << "abortMultipartUploadHandler data:" << data;
 
-                    if (!child.isElement()) continue;
+    qDebug() << "rawHeaderList" << reply->rawHeaderList();
 
-                    if (child.nodeName() == "Key") upload.insert("key", child.toElement().text());
-                    if (child.nodeName() == "UploadId") upload.insert("uploadId", child.toElement().text());
-                    if (child.nodeName() == "StorageClass") upload.insert("storageClass", child.toElement().text());
-                    if (child.nodeName() == "Initiated") upload.insert("initiated", child.toElement().text());
+    emit abortMultipartUploadResponse(request.error);
+}
 
-                    if (child.nodeName() == "Owner")
-                    {
-                        QHash<QString, QVariant> owner;
+// _listPartsHandler
+void Client::_listPartsHandler(QNetworkReply *reply, const Request &request)
+{    
+    QHash<QString, QVariant> params;
 
-                        QDomNodeList subChildNodes = child.childNodes();
+    params.insert("objectKey", request.context.objectKey);
 
-                        for (int j = 0; j < subChildNodes.count(); ++j)
-                        {
-                            QDomNode subChild = subChildNodes.at(j);
+    QList<QHash<QString, QVariant>> parts;
 
-                            if (!subChild.isElement()) continue;
+    if (request.error != QNetworkReply::NoError)
+    {
+        emit listPartsResponse(request.error, params, parts);
 
-                            if (subChild.nodeName() == "ID") owner.insert("id", subChild.toElement().text());
-                            if (subChild.nodeName() == "DisplayName") owner.insert("displayName", subChild.toElement().text());
-                        }
+        return;
+    }
 
-                        upload.insert("owner", owner);
-                    }
-                }
+    QByteArray data = reply->readAll();
 
-                uploads.append(upload);
-            }
-        }
+    qDebug() << "listPartsHandler data:" << data;
+
+    if (!_parseListParts(data, params, parts))
+    {
+        emit listPartsResponse(QNetworkReply::InternalServerError, params, parts);
 
-        node = node.nextSibling();
+        return;
     }
 
-    emit listMultipartUploadsResponse(reply->error(), params, uploads);
+    emit listPartsResponse(request.error, params, parts);
 }
 
-// _abortMultipartUploadHandler
-void Client::_abortMultipartUploadHandler(QNetworkReply *reply)
+// _resumeMultipartUploadHandler
+void Client::_resumeMultipartUploadHandler(QNetworkReply *reply, const Request &request)
 {
-    if (reply->error() != QNetworkReply::NoError)
+    RequestContext context = request.context;
+
+    QString objectKey = context.objectKey;
+    QString uploadId = context.uploadId;
+    qint64 fileSize = QFileInfo(context.filePath).size();
+    qint64 partSize = context.partSize;
+
+    // 暂停或取消时 cancelObject 已清除分块表，保留（暂停）或中断（取消）服务端的上传，这里只释放位置
+    if (request.error == QNetworkReply::OperationCanceledError || !_partsHash.contains(objectKey))
     {
-        emit abortMultipartUploadResponse(reply->error());
+        _scheduler->finish(uploadLane);
 
         return;
     }
 
-    QByteArray data = reply->readAll();
+    if (request.error == QNetworkReply::ContentNotFoundError)
+    {
+        // 服务端已不存在该上传（已完成、已中断或过期），重新上传
+        qDebug() << "resume multipart upload not found:" << objectKey;
 
-    qDebug() << "abortMultipartUploadHandler data:" << data;
+        _partsHash.remove(objectKey);
+        _uploadJournal->remove(_bucket, objectKey);
 
-    qDebug() << "rawHeaderList" << reply->rawHeaderList();
+        context.uploadId.clear();
+        context.partSize = 0;
 
-    emit abortMultipartUploadResponse(reply->error());
-}
+        _initiateMultipartUpload(context);
 
-// _listPartsHandler
-void Client::_listPartsHandler(QNetworkReply *reply)
-{    
-    QHash<QString, QVariant> params;
-    QStringHash extras = _extraHash.value(reply);
+        return;
+    }
 
-    params.insert("objectKey", extras["objectKey"]);
+    QHash<QString, QVariant> params;
+    QList<QHash<QString, QVariant>> parts;
 
-    _extraHash.remove(reply);
-    _objectHash.remove(reply);
+    // 其他错误保留上传记录，下次上传同一文件时仍可续传
+    QNetworkReply::NetworkError error = request.error;
 
-    QList<QHash<QString, QVariant>> parts;
+    if (error == QNetworkReply::NoError && !_parseListParts(reply->readAll(), params, parts)) error = QNetworkReply::InternalServerError;
 
-    if (reply->error() != QNetworkReply::NoError)
+    if (error != QNetworkReply::NoError)
     {
-        emit listPartsResponse(reply->error(), params, parts);
+        qDebug() << "resume multipart upload failure:" << objectKey << "error:" << error;
+
+        _partsHash.remove(objectKey);
+
+        _scheduler->finish(uploadLane);
+
+        emit putObjectResponse(error, _objectParams(context), QStringHash());
 
         return;
     }
 
-    QByteArray data = reply->readAll();
+    // 只认可大小与本地分块一致的已上传分块
+    QMap<int, QString> &registered = _partsHash[objectKey];
 
-    qDebug() << "listPartsHandler data:" << data;
+    foreach (auto part, parts)
+    {
+        int partNumber = part["partNumber"].toInt();
+        qint64 size = fileSize - (partNumber - 1) * partSize;
+
+        if (size > partSize) size = partSize;
+
+        if (registered.contains(partNumber) && part["size"].toLongLong() == size)
+        {
+            registered[partNumber] = part["etag"].toString();
 
-    QDomDocument doc;
+            _uploadJournal->setPart(_bucket, objectKey, partNumber, part["etag"].toString());
+        }
+    }
 
-    if (!doc.setContent(data))
+    if (params["isTruncated"].toString() == "true")
     {
-        emit listPartsResponse(QNetworkReply::InternalServerError, params, parts);
+        _listResumeParts(context, params["nextPartNumberMarker"].toString());
 
         return;
     }
 
-    QDomElement root = doc.documentElement();
-    QDomNode node = root.firstChild();
+    _uploadJournal->flush();
+
+    // 续传的准备工作结束，释放 putObject 占用的位置
+    _scheduler->finish(uploadLane);
+
+    _uploadParts(uploadId, context);
+}
+
+// _parseResult
+// 只有一层子元素的结果，names 为元素名到参数名的映射，其余元素跳过
+bool Client::_parseResult(const QByteArray &data, const QStringHash &names, QStringHash &params)
+{
+    QXmlStreamReader reader(data);
+
+    if (!reader.readNextStartElement()) return false;
+
+    while (reader.readNextStartElement())
+    {
+        QStringHash::const_iterator it = names.constFind(reader.name().toString());
+
+        if (it == names.constEnd()) reader.skipCurrentElement();
+        else params.insert(it.value(), reader.readElementText());
+    }
+
+    return !reader.hasError();
+}
+
+// _parseOwner
+QHash<QString, QVariant> Client::_parseOwner(QXmlStreamReader &reader)
+{
+    QHash<QString, QVariant> owner;
+
+    while (reader.readNextStartElement())
+    {
+        if (reader.name() == QLatin1String("ID")) owner.insert("id", reader.readElementText());
+        else if (reader.name() == QLatin1String("DisplayName")) owner.insert("displayName", reader.readElementText());
+        else reader.skipCurrentElement();
+    }
+
+    return owner;
+}
+
+// _parseListBucket
+bool Client::_parseListBucket(const QByteArray &data, QStringList &buckets)
+{
+    QXmlStreamReader reader(data);
+
+    if (!reader.readNextStartElement()) return false;
 
-    while (!node.isNull())
+    while (reader.readNextStartElement())
     {
-        if (node.isElement())
+        if (reader.name() != QLatin1String("Buckets"))
+        {
+            reader.skipCurrentElement();
+
+            continue;
+        }
+
+        // Buckets => Bucket => Name
+        while (reader.readNextStartElement())
         {
-            if (node.nodeName() == "Bucket") params.insert("bucket", node.toElement().text());
-            if (node.nodeName() == "Key") params.insert("key", node.toElement().text());
-            if (node.nodeName() == "UploadId") params.insert("uploadId", node.toElement().text());
-            if (node.nodeName() == "StorageClassName") params.insert("storageClassName", node.toElement().text());
-            if (node.nodeName() == "PartNumberMarker") params.insert("partNumberMarker", node.toElement().text());
-            if (node.nodeName() == "NextPartNumberMarker") params.insert("nextPartNumberMarker", node.toElement().text());
-            if (node.nodeName() == "MaxParts") params.insert("maxParts", node.toElement().text());
-            if (node.nodeName() == "IsTruncated") params.insert("isTruncated", node.toElement().text());
-
-            if (node.nodeName() == "Owner")
+            while (reader.readNextStartElement())
             {
-                QHash<QString, QVariant> owner;
+                if (reader.name() == QLatin1String("Name")) buckets.append(reader.readElementText());
+                else reader.skipCurrentElement();
+            }
+        }
+    }
 
-                QDomNodeList childNodes = node.childNodes();
+    return !reader.hasError();
+}
 
-                for (int i = 0; i < childNodes.count(); ++i)
-                {
-                    QDomNode child = childNodes.at(i);
+// _parseListObject
+bool Client::_parseListObject(const QByteArray &data, QStringHash &params, QStringVector &dirs, QVector<File> &files)
+{
+    QXmlStreamReader reader(data);
+
+    if (!reader.readNextStartElement()) return false;
+
+    while (reader.readNextStartElement())
+    {
+        QStringRef name = reader.name();
+
+        if (name == QLatin1String("Contents"))
+        {
+            File file;
 
-                    if (!child.isElement()) continue;
+            while (reader.readNextStartElement())
+            {
+                QStringRef childName = reader.name();
+
+                if (childName == QLatin1String("Key")) file.key = reader.readElementText();
+                else if (childName == QLatin1String("Size")) file.size = reader.readElementText().toULongLong();
+                else if (childName == QLatin1String("LastModified"))
+                {
+                    QString lastModified = reader.readElementText();
 
-                    if (child.nodeName() == "ID") owner.insert("id", child.toElement().text());
-                    if (child.nodeName() == "DisplayName") owner.insert("displayName", child.toElement().text());
+                    file.lastModified = lastModified.replace("T", " ").replace(" +0800", "");
                 }
+                else reader.skipCurrentElement();
+            }
+
+            files.append(file);
+        }
+        else if (name == QLatin1String("CommonPrefixes"))
+        {
+            // 只取第一个子元素 Prefix
+            if (reader.readNextStartElement())
+            {
+                dirs.append(reader.readElementText());
 
-                params.insert("owner", owner);
+                reader.skipCurrentElement();
             }
+        }
+        else if (name == QLatin1String("Prefix")) params.insert("prefix", reader.readElementText());
+        else if (name == QLatin1String("Marker")) params.insert("marker", reader.readElementText());
+        else if (name == QLatin1String("NextMarker")) params.insert("nextMarker", reader.readElementText());
+        else if (name == QLatin1String("MaxKeys")) params.insert("maxKeys", reader.readElementText());
+        else if (name == QLatin1String("IsTruncated")) params.insert("isTruncated", reader.readElementText());
+        else reader.skipCurrentElement();
+    }
+
+    return !reader.hasError();
+}
 
-            if (node.nodeName() == "Part")
+// _parseDeleteObjects
+bool Client::_parseDeleteObjects(const QByteArray &data, QStringHash &params)
+{
+    QXmlStreamReader reader(data);
+
+    if (!reader.readNextStartElement()) return false;
+
+    while (reader.readNextStartElement())
+    {
+        if (reader.name() == QLatin1String("Deleted"))
+        {
+            if (reader.readNextStartElement())
             {
-                QDomNodeList childNodes = node.childNodes();
+                params.insert(reader.readElementText(), "Deleted");
+
+                reader.skipCurrentElement();
+            }
+        }
+        else if (reader.name() == QLatin1String("Error"))
+        {
+            QString objectKey;
+            QString message;
 
-                QHash<QString, QVariant> part;
+            while (reader.readNextStartElement())
+            {
+                if (reader.name() == QLatin1String("Key")) objectKey = reader.readElementText();
+                else if (reader.name() == QLatin1String("Message")) message = reader.readElementText();
+                else reader.skipCurrentElement();
+            }
 
-                for (int i = 0; i < childNodes.count(); ++i)
-                {
-                    QDomNode child = childNodes.at(i);
+            params.insert(objectKey, "Error: " + message);
+        }
+        else
+        {
+            reader.skipCurrentElement();
+        }
+    }
 
-                    if (!child.isElement()) continue;
+    return !reader.hasError();
+}
 
-                    if (child.nodeName() == "PartNumber") part.insert("partNumber", child.toElement().text());
-                    if (child.nodeName() == "LastModified") part.insert("lastModified", child.toElement().text());
-                    if (child.nodeName() == "ETag") part.insert("etag", child.toElement().text());
-                    if (child.nodeName() == "Size") part.insert("size", child.toElement().text());
-                }
+// _parseListMultipartUploads
+bool Client::_parseListMultipartUploads(const QByteArray &data, QStringHash &params, QList<QHash<QString, QVariant>> &uploads)
+{
+    QXmlStreamReader reader(data);
 
-                parts.append(part);
+    if (!reader.readNextStartElement()) return false;
+
+    while (reader.readNextStartElement())
+    {
+        QStringRef name = reader.name();
+
+        if (name == QLatin1String("Upload"))
+        {
+            QHash<QString, QVariant> upload;
+
+            while (reader.readNextStartElement())
+            {
+                QStringRef childName = reader.name();
+
+                if (childName == QLatin1String("Key")) upload.insert("key", reader.readElementText());
+                else if (childName == QLatin1String("UploadId")) upload.insert("uploadId", reader.readElementText());
+                else if (childName == QLatin1String("StorageClass")) upload.insert("storageClass", reader.readElementText());
+                else if (childName == QLatin1String("Initiated")) upload.insert("initiated", reader.readElementText());
+                else if (childName == QLatin1String("Owner")) upload.insert("owner", _parseOwner(reader));
+                else reader.skipCurrentElement();
             }
+
+            uploads.append(upload);
         }
+        else if (name == QLatin1String("Bucket")) params.insert("bucket", reader.readElementText());
+        else if (name == QLatin1String("NextKeyMarker")) params.insert("nextKeyMarker", reader.readElementText());
+        else if (name == QLatin1String("IsTruncated")) params.insert("isTruncated", reader.readElementText());
+        else reader.skipCurrentElement();
+    }
 
-        node = node.nextSibling();
+    return !reader.hasError();
+}
+
+// _parseListParts
+bool Client::_parseListParts(const QByteArray &data, QHash<QString, QVariant> &params, QList<QHash<QString, QVariant>> &parts)
+{
+    static const QStringHash names = {
+        { "Bucket", "bucket" },
+        { "Key", "key" },
+        { "UploadId", "uploadId" },
+        { "StorageClassName", "storageClassName" },
+        { "PartNumberMarker", "partNumberMarker" },
+        { "NextPartNumberMarker", "nextPartNumberMarker" },
+        { "MaxParts", "maxParts" },
+        { "IsTruncated", "isTruncated" }
+    };
+
+    QXmlStreamReader reader(data);
+
+    if (!reader.readNextStartElement()) return false;
+
+    while (reader.readNextStartElement())
+    {
+        QString name = reader.name().toString();
+
+        if (name == "Part")
+        {
+            QHash<QString, QVariant> part;
+
+            while (reader.readNextStartElement())
+            {
+                QStringRef childName = reader.name();
+
+                if (childName == QLatin1String("PartNumber")) part.insert("partNumber", reader.readElementText());
+                else if (childName == QLatin1String("LastModified")) part.insert("lastModified", reader.readElementText());
+                else if (childName == QLatin1String("ETag")) part.insert("etag", reader.readElementText());
+                else if (childName == QLatin1String("Size")) part.insert("size", reader.readElementText());
+                else reader.skipCurrentElement();
+            }
+
+            parts.append(part);
+        }
+        else if (name == "Owner")
+        {
+            params.insert("owner", _parseOwner(reader));
+        }
+        else if (names.contains(name))
+        {
+            params.insert(names.value(name), reader.readElementText());
+        }
+        else
+        {
+            reader.skipCurrentElement();
+        }
     }
 
-    emit listPartsResponse(reply->error(), params, parts);
+    return !reader.hasError();
 }
 
 // Private Slots
@@ -1672,11 +3468,40 @@ void Client::_requestFinished(QNetworkReply *reply)
 {
 //    qDebug() << "enter _requestFinished Thread:" << this->thread();
 
-    QNetworkReply::NetworkError error = reply->error();
+    // 请求的全部信息一次取出，交给各处理函数
+    Request request = _requests.take(reply);
+
+    // 看门狗中止的请求按超时处理，参与重试和并发控制
+    request.error = request.stall.isEmpty() ? reply->error() : QNetworkReply::TimeoutError;
+
+    QNetworkReply::NetworkError error = request.error;
+
+    Operation operation = request.operation;
+
+    _recordRequest(reply, request);
+
+    // 暂时性的失败不提示，稍后重试；下载要先保存已收到的内容，由处理函数安排重试
+    bool retry = _shouldRetry(reply, request);
+
+    if (retry && operation != getObjectOperation && operation != getObjectSegmentOperation)
+    {
+        // 任务等待重试期间让出位置，分块上传的准备请求保留位置直到重发
+        if (request.job.operation != noOperation) _scheduler->finish(laneOf(operation));
+
+        _scheduleRetry(reply, request);
+
+        reply->disconnect();
+        reply->deleteLater();
 
-    Operation operation = _operationMap.value(reply);
+        _work();
 
-    if (error != QNetworkReply::NoError) {
+        return;
+    }
+
+    // 合并进来的相同请求，由 _shareResponses 补发结果
+    if (!request.readKey.isEmpty()) _sharers = _readSharers.take(request.readKey);
+
+    if (error != QNetworkReply::NoError && !retry) {
         QString message;
 
         switch (error)
@@ -1689,12 +3514,16 @@ void Client::_requestFinished(QNetworkReply *reply)
             message = "远程主机名未找到（无效主机名）";
             qDebug() << "远程主机名未找到（无效主机名） operation:" << operation;
             break;
+        case QNetworkReply::TimeoutError:
+            message = request.stall.isEmpty() ? "请求超时" : "请求超时: " + request.stall;
+            qDebug() << "请求超时 operation:" << operation << "stall:" << request.stall;
+            break;
         case QNetworkReply::TooManyRedirectsError:
             message = "请求超过了设定的最大重定向次数";
             qDebug() << "请求超过了设定的最大重定向次数 operation:" << operation;
             break;
         case QNetworkReply::ContentNotFoundError:
-            if (operation != headObjectOperation)
+            if (operation != headObjectOperation && operation != resumeMultipartUploadOperation)
             {
                 message = "内容不存在";
                 qDebug() << "请求查询的对象不存在 operation:" << operation;
@@ -1710,10 +3539,8 @@ void Client::_requestFinished(QNetworkReply *reply)
         {
             if (operation == getObjectOperation)
             {
-                QStringHash extras = _extraHash.value(reply);
-
                 // 处理历史遗留问题：上传文件夹时未在 NOS 创建对应的目录
-                if (!extras["objectKey"].endsWith("/")) emit errorResponse(message);
+                if (!request.context.objectKey.endsWith("/")) emit errorResponse(message);
             }
         }
         else
@@ -1724,25 +3551,27 @@ void Client::_requestFinished(QNetworkReply *reply)
 
     switch (operation)
     {
-    case listBucketOperation: _listBucketHandler(reply); break;
-    case listObjectOperation: _listObjectHandler(reply); break;
-    case getObjectOperation: _workQueue->pop(); _getObjectHandler(reply); break;
-    case headObjectOperation: _headObjectHandler(reply); break;
-    case putObjectOperation: _workQueue->pop(); _putObjectHandler(reply); break;
-    case deleteObjectOperation: _workQueue->pop(); _deleteObjectHandler(reply); break;
-    case deleteObjectsOperation: _workQueue->pop(); _deleteObjectsHandler(reply); break;
-    case copyObjectOperation: _workQueue->pop(); _copyObjectHandler(reply); break;
-    case moveObjectOperation: _workQueue->pop(); _moveObjectHandler(reply); break;
-    case initiateMultipartUploadOperation: _workQueue->pop(); _initiateMultipartUploadHandler(reply); break;
-    case uploadPartOperation: _workQueue->pop(); _uploadPartHandler(reply); break;
-    case completeMultipartUploadOperation: _workQueue->pop(); _completeMultipartUploadHandler(reply); break;
-    case listMultipartUploadsOperation: _listMultipartUploadsHandler(reply); break;
-    case abortMultipartUploadOperation: _abortMultipartUploadHandler(reply); break;
-    case listPartsOperation: _listPartsHandler(reply); break;
+    case listBucketOperation: _scheduler->finish(laneOf(operation)); _listBucketHandler(reply, request); break;
+    case listObjectOperation: _scheduler->finish(laneOf(operation)); _listObjectHandler(reply, request); break;
+    case getObjectOperation: _scheduler->finish(laneOf(operation)); _getObjectHandler(reply, request, retry); break;
+    case getObjectSegmentOperation: _scheduler->finish(laneOf(operation)); _getObjectSegmentHandler(reply, request, retry); break;
+    case headObjectOperation: _scheduler->finish(laneOf(operation)); _headObjectHandler(reply, request); break;
+    case putObjectOperation: _scheduler->finish(laneOf(operation)); _putObjectHandler(reply, request); break;
+    case deleteObjectOperation: _scheduler->finish(laneOf(operation)); _deleteObjectHandler(reply, request); break;
+    case deleteObjectsOperation: _scheduler->finish(laneOf(operation)); _deleteObjectsHandler(reply, request); break;
+    case copyObjectOperation: _scheduler->finish(laneOf(operation)); _copyObjectHandler(reply, request); break;
+    case moveObjectOperation: _scheduler->finish(laneOf(operation)); _moveObjectHandler(reply, request); break;
+    case initiateMultipartUploadOperation: _scheduler->finish(laneOf(operation)); _initiateMultipartUploadHandler(reply, request); break;
+    case uploadPartOperation: _scheduler->finish(laneOf(operation)); _uploadPartHandler(reply, request); break;
+    case completeMultipartUploadOperation: _scheduler->finish(laneOf(operation)); _completeMultipartUploadHandler(reply, request); break;
+    case listMultipartUploadsOperation: _scheduler->finish(laneOf(operation)); _listMultipartUploadsHandler(reply, request); break;
+    case abortMultipartUploadOperation: _scheduler->finish(laneOf(operation)); _abortMultipartUploadHandler(reply, request); break;
+    case listPartsOperation: _scheduler->finish(laneOf(operation)); _listPartsHandler(reply, request); break;
+    case resumeMultipartUploadOperation: _resumeMultipartUploadHandler(reply, request); break;
     default: qDebug() << "Connect to host success!";
     }
 
-    _operationMap.remove(reply);
+    _sharers.clear();
 
     reply->disconnect();
     reply->deleteLater();
@@ -1750,3 +3579,56 @@ void Client::_requestFinished(QNetworkReply *reply)
 
     _work();
 }
+
+// _checkStalls
+void Client::_checkStalls()
+{
+    if (_requests.isEmpty())
+    {
+        _watchdog->stop();
+
+        return;
+    }
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    QList<QNetworkReply*> replies;
+
+    QHash<QNetworkReply*, Request>::iterator it;
+
+    for (it = _requests.begin(); it != _requests.end(); ++it)
+    {
+        Request &request = it.value();
+
+        if (!request.stall.isEmpty()) continue;
+
+        // 等待下载令牌时连接是有意暂停的
+        if (request.paced)
+        {
+            request.activeTime = now;
+
+            continue;
+        }
+
+        bool transfer = request.bodySize > 0 || request.file;
+
+        if (request.activeTime < 0 && now - request.startTime > ConnectTimeout)
+            request.stall = QString("%1 秒内未开始收发").arg(ConnectTimeout / 1000);
+        else if (request.activeTime >= 0 && now - request.activeTime > IdleTimeout)
+            request.stall = QString("%1 秒内没有数据").arg(IdleTimeout / 1000);
+        else if (!transfer && now - request.startTime > RequestTimeout)
+            request.stall = QString("超过 %1 秒未完成").arg(RequestTimeout / 1000);
+        else
+            continue;
+
+        ++_stallCount;
+
+        qDebug() << "stalled operation:" << request.operation << "key:" << _retryKey(request.context) << "reason:" << request.stall;
+
+        emit stallResponse(request.operation, request.context, request.stall, _stallCount);
+
+        replies.append(it.key());
+    }
+
+    _abortReplies(replies);
+}
@@ -3,16 +3,27 @@
 
 #include <QObject>
 #include <QNetworkReply>
+#include <QFuture>
 
 QT_BEGIN_NAMESPACE
 class QNetworkAccessManager;
 class QNetworkRequest;
 class QThread;
+class QFile;
+class QThreadPool;
+class QTimer;
+class QXmlStreamReader;
+template <typename T> class QFutureWatcher;
 QT_END_NAMESPACE
 
+class FileSliceDevice;
+
 #include "account.h"
-#include "jobqueue.h"
-#include "workerqueue.h"
+#include "lanescheduler.h"
+#include "uploadjournal.h"
+#include "downloadcheckpoint.h"
+#include "concurrencycontroller.h"
+#include "ratelimiter.h"
 
 #include "qstringmap.h"
 #include "qstringhash.h"
@@ -58,6 +69,8 @@ typedef struct listObjectParams
     }
 } ListObjectParams;
 
+Q_DECLARE_METATYPE(ListObjectParams);
+
 typedef struct getObjectParams
 {
     QString objectKey;
@@ -66,6 +79,7 @@ typedef struct getObjectParams
     QString ifModifiedSince;
     QString download;
     QString ifNotFound;
+    qint64 fileSize; // 已知对象大小时用于分段下载，0 表示未知
 
     getObjectParams(
         const QString &pObjectKey = "",
@@ -73,17 +87,78 @@ typedef struct getObjectParams
         const QString &pRange = "",
         const QString &pIfModifiedSince = "",
         const QString &pDownload = "",
-        const QString &pIfNotFound = ""
+        const QString &pIfNotFound = "",
+        qint64 pFileSize = 0
     ) : objectKey(pObjectKey),
         filePath(pFilePath),
         range(pRange),
         ifModifiedSince(pIfModifiedSince),
         download(pDownload),
-        ifNotFound(pIfNotFound) {}
+        ifNotFound(pIfNotFound),
+        fileSize(pFileSize) {}
 } GetObjectParams;
 
 Q_DECLARE_METATYPE(GetObjectParams);
 
+// 分段下载的一段，写入临时文件的 offset 处
+typedef struct
+{
+    QString objectKey;
+    QString filePath;
+    qint64 offset;
+    qint64 size;
+} GetObjectSegmentParams;
+
+Q_DECLARE_METATYPE(GetObjectSegmentParams);
+
+typedef struct
+{
+    QString objectKey;
+    QString filePath;
+    qint64 fileSize;
+    int segmentCount;
+    int finishedCount;
+    QString etag;
+    QNetworkReply::NetworkError error;
+    bool resumed; // 从上次中断的位置继续
+    bool restart; // 对象已被修改，需要重新下载
+    bool discard; // 已取消，不保留临时文件和下载记录
+    DownloadCheckpoint checkpoint;
+} DownloadContext;
+
+// 请求涉及的对象信息，随请求发出、随响应取回，处理响应时直接读取
+typedef struct requestContext
+{
+    QString objectKey;
+    QString sourceBucketName;
+    QString sourceObjectKey;
+    QString destinationBucketName;
+    QString destinationObjectKey;
+    QString filePath;
+    qint64 fileSize;
+    QString uploadId;
+    qint64 partSize;
+    int partNumber;
+    qint64 offset; // 分段下载的位置
+    qint64 size; // 分段下载的长度
+    int attempt; // 第几次重试，首次发送为 0
+
+    requestContext(
+        const QString &pObjectKey = "",
+        const QString &pFilePath = "",
+        qint64 pFileSize = 0
+    ) : objectKey(pObjectKey),
+        filePath(pFilePath),
+        fileSize(pFileSize),
+        partSize(0),
+        partNumber(0),
+        offset(0),
+        size(0),
+        attempt(0) {}
+} RequestContext;
+
+Q_DECLARE_METATYPE(RequestContext);
+
 typedef struct headObjectParams
 {
     QString objectKey;
@@ -102,6 +177,8 @@ typedef struct headObjectParams
         ifModifiedSince(pIfModifiedSince) {}
 } HeadObjectParams;
 
+Q_DECLARE_METATYPE(HeadObjectParams);
+
 typedef struct
 {
     QString objectKey;
@@ -152,13 +229,16 @@ typedef struct transferObjectParams
 
 Q_DECLARE_METATYPE(CopyObjectParams);
 
+// 分块只记录文件位置，发送时再从磁盘读取
 typedef struct
 {
     QString objectKey;
-    QByteArray body;
+    QString filePath;
+    qint64 offset;
+    qint64 size;
     int partNumber;
     QString uploadId;
-    QStringHash extras;
+    RequestContext context;
 } UploadPartParams;
 
 Q_DECLARE_METATYPE(UploadPartParams);
@@ -168,11 +248,21 @@ typedef struct
     QString objectKey;
     QString uploadId;
     QMap<int, QString> parts;
-    QStringHash extras;
+    RequestContext context;
 } CompleteMultipartUploadParams;
 
 Q_DECLARE_METATYPE(CompleteMultipartUploadParams);
 
+// 取消或暂停某个对象的传输，暂停时保留续传所需的临时文件和上传记录
+typedef struct
+{
+    QString objectKey;
+    QString downloadPath; // 下载的本地路径，其他操作为空
+    bool pause;
+} CancelObjectParams;
+
+Q_DECLARE_METATYPE(CancelObjectParams);
+
 typedef struct listMultipartUploadsParams
 {
     QString keyMarker;
@@ -182,12 +272,16 @@ typedef struct listMultipartUploadsParams
         keyMarker(pKeyMarker), maxUploads(pMaxUploads) {}
 } ListMultipartUploadsParams;
 
+Q_DECLARE_METATYPE(ListMultipartUploadsParams);
+
 typedef struct
 {
     QString objectKey;
     QString uploadId;
 } AbortMultipartUploadParams;
 
+Q_DECLARE_METATYPE(AbortMultipartUploadParams);
+
 typedef struct listPartsParams
 {
     QString objectKey;
@@ -206,10 +300,18 @@ typedef struct listPartsParams
         partNumberMarker(pPartNumberMarker) {}
 } ListPartsParams;
 
+Q_DECLARE_METATYPE(ListPartsParams);
+
 class Client : public QObject
 {
     Q_OBJECT
 
+    // tests/ 下的测试、基准直接使用内部实现
+    friend class RequestBuilderBenchmark;
+    friend class RequestContextBenchmark;
+    friend class ResponseParserBenchmark;
+    friend class SignerTest;
+
 public:
     enum Action {
         listBucketAction,
@@ -234,20 +336,57 @@ public:
         completeMultipartUploadOperation,       // 12
         abortMultipartUploadOperation,          // 13
         listMultipartUploadsOperation,          // 14
-        listPartsOperation                      // 15
+        listPartsOperation,                     // 15
+        getObjectSegmentOperation,              // 16
+        resumeMultipartUploadOperation          // 17
     };
 
     typedef struct job
     {
         Operation operation;
         QVariant params;
+        int attempt; // 第几次重试
+        QString bucket; // 入队时的桶，列表、查询请求按它发出
+        QString readKey; // 可合并的读取请求，入队时生成，见 _readSharers
 
-        job(Operation pOperation, const QVariant &pParams) : operation(pOperation), params(pParams) {}
+        job(Operation pOperation = noOperation, const QVariant &pParams = QVariant()) :
+            operation(pOperation), params(pParams), attempt(0) {}
     } Job;
 
-    static const qint64 PartSize = 10485760; // 10M
+    static const qint64 MultipartThreshold = 33554432; // 32M，超过时分块上传
+
+    // 分块大小按文件大小和上传速度选择
+    static const qint64 DefaultPartSize = 10485760; // 10M
+    static const qint64 MinPartSize = 5242880; // 5M
+    static const qint64 MaxPartSize = 104857600; // 100M
+    static const qint64 MaxPartCount = 10000;
+    static const qint64 PartDuration = 10000; // 每个分块期望的上传时间，毫秒
+    static const int HashLookahead = 2; // 提前计算 MD5 的分块数
+
+    static const qint64 DownloadBufferSize = 1048576; // 1M，下载连接的读缓冲区上限
+
+    static const qint64 SegmentSize = 16777216; // 16M
+    static const qint64 SegmentThreshold = 33554432; // 32M
+
+    // 暂时性失败的重试：间隔按次数指数增长并加随机抖动，同一任务（大对象的全部分块）共用重试次数
+    static const int MaxRetries = 4; // 单个请求
+    static const int RetryBudget = 32; // 单个任务
+    static const qint64 RetryBaseDelay = 500; // 毫秒
+    static const qint64 MaxRetryDelay = 30000; // 毫秒
+
+    // 看门狗，毫秒：发出后迟迟没有任何收发、传输中途停止收发、不传输数据的请求总耗时
+    static const qint64 ConnectTimeout = 30000;
+    static const qint64 IdleTimeout = 60000;
+    static const qint64 RequestTimeout = 300000;
+    static const int WatchdogInterval = 1000;
+
+    static const int SignBufferSize = 1024;
+    static const int MaxMimeTypeCount = 1024; // 缓存的扩展名数量上限，超过时清空
+
+    static const QString DownloadSuffix;
 
     static const QString humanReadableSize(const quint64 &size, int precision);
+    static Lane laneOf(Operation operation);
 
     explicit Client();
     ~Client();
@@ -277,13 +416,18 @@ public slots:
     void abortMultipartUpload(const AbortMultipartUploadParams &params);
     void listParts(const ListPartsParams &params);
 
+    // 上传、下载限速，每秒字节数，0 表示不限速
+    void setRateLimit(qint64 uploadRate, qint64 downloadRate);
+
+    void cancelObject(const CancelObjectParams &params);
+
 signals:
     void listBucketResponse(QNetworkReply::NetworkError error, const QStringList &buckets);
     void listObjectResponse(QNetworkReply::NetworkError error,
                             const QStringHash &params,
                             const QStringVector &dirs,
                             const QVector<File> &files);
-    void getObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params, const QByteArray &data);
+    void getObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params, qint64 bytesReceived);
     void headObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params, const QStringHash &headers);
     void putObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params, const QStringHash &headers);
     void deleteObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params);
@@ -298,10 +442,18 @@ signals:
                            const QHash<QString, QVariant> &params,
                            const QList<QHash<QString, QVariant>> &parts);
 
-    void updateProgressResponse(Operation operation, const QStringHash &params, const QStringHash &extras, qint64 bytesSent);
+    void updateProgressResponse(Operation operation, const RequestContext &context, qint64 bytesSent);
+
+    // 请求失败后将在 delay 毫秒后重试，context.attempt 为即将进行的重试次数
+    void retryResponse(Operation operation, const RequestContext &context, const QString &reason, qint64 delay);
 
     void errorResponse(const QString &message);
 
+    // 看门狗中止了停滞的请求，stallCount 为累计次数
+    void stallResponse(Operation operation, const RequestContext &context, const QString &reason, int stallCount);
+
+    void concurrencyChanged(int limit, const QString &reason);
+
 private:
     const QString METHOD_GET = "GET";
     const QString METHOD_POST = "POST";
@@ -330,28 +482,134 @@ private:
 
     QNetworkAccessManager *_manager;
     QThread *_thread;
-    JobQueue<Client::Job> *_jobQueue;
-    WorkerQueue<Client::Job> *_workQueue;
-
-    // 区分操作
-    QMap<QNetworkReply*, Operation> _operationMap;
 
-    // 暂存数据
-    QHash<QNetworkReply*, QStringHash> _objectHash;
-    QHash<QNetworkReply*, QStringHash> _extraHash;
+    // 进行中的请求，响应结束时整条取出
+    typedef struct request
+    {
+        Operation operation;
+        RequestContext context;
+        Job job; // 发出请求的任务，重试时重新排队；不经过队列的请求为空，重试时原样重发
+        QString method;
+        QStringHash headers;
+        QByteArray body;
+        Action action;
+        QStringHash resources;
+        QFile *file; // 下载中的临时文件
+        bool paced; // 正在等待下载令牌
+        qint64 bodySize;
+        qint64 startTime;
+        qint64 latency; // 收到响应头的耗时，-1 表示不计
+        qint64 bytes; // 已传输的字节数，供并发控制使用
+        qint64 activeTime; // 最近一次收发数据的时间，-1 表示尚未开始
+        QString stall; // 被看门狗中止的原因
+        QNetworkReply::NetworkError error; // 响应结束时的错误，被看门狗中止的按超时处理
+        QString readKey; // 可合并的读取请求，见 _readSharers
+    } Request;
+
+    QHash<QNetworkReply*, Request> _requests;
+
+    // 定时检查停滞的请求，没有进行中的请求时停止
+    QTimer *_watchdog;
+    int _stallCount;
+
+    LaneScheduler<Client::Job> *_scheduler;
+
+    // 并发控制
+    ConcurrencyController _concurrency;
+
+    // 分块上传中各分块的 ETag
     QHash<QString, QMap<int, QString>> _partsHash;
 
+    // 分段下载，以本地文件路径区分
+    QHash<QString, DownloadContext> _downloadContexts;
+
+    // 未完成的大对象上传记录
+    UploadJournal *_uploadJournal;
+
+    // 单个连接的上传速度，字节/毫秒
+    double _uploadRate;
+
+    // 计算 Content-MD5 的线程池，以及已开始计算的分块 MD5（objectKey => partNumber => MD5）
+    QThreadPool *_hashPool;
+    QHash<QString, QHash<int, QFuture<QByteArray>>> _digestHash;
+
+    // 正在计算 MD5 的简单上传（watcher => objectKey），同一对象可能同时有多个请求，每个请求一项
+    QHash<QFutureWatcher<QByteArray>*, QString> _putWatchers;
+
+    // 限速
+    RateLimiter _uploadLimiter;
+    RateLimiter _downloadLimiter;
+
+    // 构造请求用到的缓存：按秒缓存的 Date、扩展名对应的 Content-Type、账号的签名密钥，以及复用的待签名缓冲区
+    qint64 _dateSecond = -1;
+    QByteArray _date;
+    QHash<QString, QString> _mimeTypes;
+    QByteArray _secretKey;
+    QByteArray _authorizationPrefix;
+    QByteArray _signBuffer;
+
+    // 排队或进行中的列表、查询请求（readKey => 合并进来的相同请求），结果同样发给它们
+    QHash<QString, QList<RequestContext>> _readSharers;
+    QList<RequestContext> _sharers; // 正在处理的响应要额外通知的请求
+
+    // 排队中的任务合并进来的相同任务数，开始后转入 _jobSharers，结束时补发相同的结果
+    QHash<QString, int> _pendingJobs;
+    QHash<QString, int> _jobSharers;
+
+    // 各任务已用的重试次数，以及取消次数（等待重试期间被取消的请求不再发出）
+    QHash<QString, int> _retryCounts;
+    QHash<QString, int> _cancelCounts;
+
     void _registerMetaType() const;
 
     void _work();
 
+    static QString _jobObjectKey(const Job &job);
+    static QString _jobKey(Operation operation, const QString &objectKey, const QString &target);
+    static QString _jobKey(const Job &job);
+    static QString _copyTarget(const QString &sourceBucketName,
+                               const QString &destinationBucketName,
+                               const QString &destinationObjectKey);
+    void _pushJob(const Job &job);
+    bool _shareRead(const QString &readKey, const RequestContext &context);
+    static QString _readKey(const Job &job);
+    void _pushRead(Job job, const RequestContext &context);
+    void _shareResponses();
+
     QNetworkReply* _sendRequest(const QString &method,
                                 const QStringHash &headers,
                                 const QByteArray &body,
                                 const Action &action,
                                 const QStringHash &resources,
                                 const Operation &operation,
-                                const QStringHash &extras = QStringHash());
+                                const RequestContext &context = RequestContext(),
+                                const Job &job = Job());
+
+    QNetworkReply* _sendRequest(const QString &method,
+                                const QStringHash &headers,
+                                FileSliceDevice *body,
+                                const QByteArray &bodyHash,
+                                const Action &action,
+                                const QStringHash &resources,
+                                const Operation &operation,
+                                const RequestContext &context = RequestContext(),
+                                const Job &job = Job());
+
+    QNetworkReply* _createReply(const QString &method,
+                                const QNetworkRequest &request,
+                                const QByteArray &body,
+                                QIODevice *device) const;
+
+    QNetworkRequest _buildRequest(const QString &method,
+                                  const QStringHash &headers,
+                                  qint64 bodySize,
+                                  const QByteArray &bodyHash,
+                                  const Action &action,
+                                  const QStringHash &resources);
+
+    const QByteArray& _requestDate();
+    QString _contentType(const QString &filename);
+    void _trackReply(QNetworkReply *reply, const Request &request);
 
     void _signRequest(const QString &method,
                       QNetworkRequest &request,
@@ -359,33 +617,78 @@ private:
                       const Action &action,
                       const QStringHash &resources);
 
+    void _recordRequest(QNetworkReply *reply, const Request &request);
+    void _abortReplies(const QList<QNetworkReply*> &replies);
+    static QString _retryKey(const RequestContext &context);
+    static bool _isIdempotent(Operation operation);
+    static QString _retryReason(QNetworkReply *reply, const Request &request);
+    static qint64 _retryDelay(QNetworkReply *reply, int attempt);
+    bool _shouldRetry(QNetworkReply *reply, const Request &request);
+    void _scheduleRetry(QNetworkReply *reply, const Request &request);
+    static QStringHash _objectParams(const RequestContext &context);
+    static QStringHash _objectResources(const QString &bucket, const QString &objectKey);
+    QByteArray _readPaced(QNetworkReply *reply);
+
+    void _listBucket(const Job &job);
+    void _listObject(const Job &job);
+    void _headObject(const Job &job);
     void _getObject(const Job &job);
+    void _getObjectSegmented(const GetObjectParams &params, DownloadCheckpoint &checkpoint, bool resumed);
+    void _getObjectSegment(const Job &job);
+    void _finishObjectSegment(const QString &filePath);
+    void _restartDownload(const QString &objectKey, const QString &filePath, qint64 fileSize);
     void _putObject(const Job &job);
     void _deleteObject(const Job &job);
     void _deleteObjects(const Job &job);
     void _copyObject(const Job &job);
     void _moveObject(const Job &job);
+    void _putBigObject(const PutBigObjectParams &params);
+    void _initiateMultipartUpload(const RequestContext &context);
+    void _listResumeParts(const RequestContext &context, const QString &partNumberMarker = "");
+    qint64 _partSize(qint64 fileSize) const;
+    void _updateUploadRate(qint64 bytes, qint64 startTime);
+    void _registerParts(const QString &objectKey, qint64 fileSize, qint64 partSize);
+    void _uploadParts(const QString &uploadId, const RequestContext &context);
     void _uploadPart(const Job &job);
+    void _sendUploadPart(const Job &job, const QByteArray &bodyHash);
+    QFuture<QByteArray> _partDigest(const QString &objectKey, const QString &filePath, int partNumber, qint64 offset, qint64 size);
+    void _prefetchDigests(const UploadPartParams &params);
+    static QByteArray _fileSliceMd5(const QString &filePath, qint64 offset, qint64 size);
     void _completeMultipartUpload(const Job &job);
-
-    void _listBucketHandler(QNetworkReply *reply);
-    void _listObjectHandler(QNetworkReply *reply);
-    void _getObjectHandler(QNetworkReply *reply);
-    void _headObjectHandler(QNetworkReply *reply);
-    void _putObjectHandler(QNetworkReply *reply);
-    void _deleteObjectHandler(QNetworkReply *reply);
-    void _deleteObjectsHandler(QNetworkReply *reply);
-    void _copyObjectHandler(QNetworkReply *reply);
-    void _moveObjectHandler(QNetworkReply *reply);
-    void _initiateMultipartUploadHandler(QNetworkReply *reply);
-    void _uploadPartHandler(QNetworkReply *reply);
-    void _completeMultipartUploadHandler(QNetworkReply *reply);
-    void _listMultipartUploadsHandler(QNetworkReply *reply);
-    void _abortMultipartUploadHandler(QNetworkReply *reply);
-    void _listPartsHandler(QNetworkReply *reply);
+    void _listMultipartUploads(const Job &job);
+    void _abortMultipartUpload(const Job &job);
+    void _listParts(const Job &job);
+
+    void _listBucketHandler(QNetworkReply *reply, const Request &request);
+    void _listObjectHandler(QNetworkReply *reply, const Request &request);
+    void _getObjectHandler(QNetworkReply *reply, const Request &request, bool retry);
+    void _getObjectSegmentHandler(QNetworkReply *reply, const Request &request, bool retry);
+    void _headObjectHandler(QNetworkReply *reply, const Request &request);
+    void _putObjectHandler(QNetworkReply *reply, const Request &request);
+    void _deleteObjectHandler(QNetworkReply *reply, const Request &request);
+    void _deleteObjectsHandler(QNetworkReply *reply, const Request &request);
+    void _copyObjectHandler(QNetworkReply *reply, const Request &request);
+    void _moveObjectHandler(QNetworkReply *reply, const Request &request);
+    void _initiateMultipartUploadHandler(QNetworkReply *reply, const Request &request);
+    void _uploadPartHandler(QNetworkReply *reply, const Request &request);
+    void _completeMultipartUploadHandler(QNetworkReply *reply, const Request &request);
+    void _listMultipartUploadsHandler(QNetworkReply *reply, const Request &request);
+    void _abortMultipartUploadHandler(QNetworkReply *reply, const Request &request);
+    void _listPartsHandler(QNetworkReply *reply, const Request &request);
+    void _resumeMultipartUploadHandler(QNetworkReply *reply, const Request &request);
+
+    // XML 应答均为流式解析，不构建 DOM 树
+    bool _parseResult(const QByteArray &data, const QStringHash &names, QStringHash &params);
+    QHash<QString, QVariant> _parseOwner(QXmlStreamReader &reader);
+    bool _parseListBucket(const QByteArray &data, QStringList &buckets);
+    bool _parseListObject(const QByteArray &data, QStringHash &params, QStringVector &dirs, QVector<File> &files);
+    bool _parseDeleteObjects(const QByteArray &data, QStringHash &params);
+    bool _parseListMultipartUploads(const QByteArray &data, QStringHash &params, QList<QHash<QString, QVariant>> &uploads);
+    bool _parseListParts(const QByteArray &data, QHash<QString, QVariant> &params, QList<QHash<QString, QVariant>> &parts);
 
 private slots:
     void _requestFinished(QNetworkReply *reply);
+    void _checkStalls();
 };
 
 #endif // CLIENT_H
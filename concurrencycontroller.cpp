@@ -0,0 +1,170 @@
+#include "concurrencycontroller.h"
+
+#include <QDebug>
+
+#include <algorithm>
+
+// 统计窗口长度，毫秒
+static const qint64 WindowInterval = 2000;
+
+// 减小并发后等待这么久再响应新的限流，避免同一波错误连续减半
+static const qint64 DecreaseCooldown = 2000;
+
+// 吞吐量下降不超过这个比例时才继续增加并发
+static const double ThroughputTolerance = 0.95;
+
+// 平均延迟超过基准延迟的倍数时认为出现排队
+static const double LatencyTolerance = 2.0;
+
+// 基准延迟取最近这么多个窗口平均延迟的最小值，网络变化后基准随之更新
+static const int BaselineWindows = 15;
+
+// 连续这么多个窗口延迟升高才减少并发，偶发的慢请求不影响
+static const int DecreaseWindows = 3;
+
+// Constructor
+ConcurrencyController::ConcurrencyController(int minLimit, int maxLimit) :
+    _limit(InitialLimit),
+    _minLimit(minLimit),
+    _maxLimit(qMin(maxLimit, int(MaxConnectionsPerHost))),
+    _reason("初始值")
+{
+    _window.start();
+}
+
+// Public Methods
+int ConcurrencyController::limit() const
+{
+    return _limit;
+}
+
+const QString& ConcurrencyController::reason() const
+{
+    return _reason;
+}
+
+bool ConcurrencyController::record(int latencyClass, qint64 bytes, qint64 latency, bool saturated)
+{
+    _bytes += bytes;
+    _saturated = _saturated || saturated;
+
+    // 上传请求的响应要等请求体发完，不计入延迟
+    if (latency >= 0)
+    {
+        LatencyStat &stat = _latencies[latencyClass];
+
+        stat.sum += latency;
+        ++stat.count;
+    }
+
+    qint64 elapsed = _window.elapsed();
+
+    if (elapsed < WindowInterval) return false;
+
+    double throughput = _bytes * 1000.0 / elapsed;
+    bool saturatedFlag = _saturated;
+    bool congested = false;
+
+    // 记录延迟升高最明显的一类请求，用于说明原因
+    qint64 averageLatency = 0;
+    qint64 baseLatency = 0;
+    double worstRatio = 0;
+
+    for (QHash<int, LatencyStat>::iterator it = _latencies.begin(); it != _latencies.end(); ++it)
+    {
+        LatencyStat &stat = it.value();
+
+        if (stat.count == 0) continue;
+
+        qint64 average = stat.sum / stat.count;
+        qint64 base = stat.averages.isEmpty() ? 0 : *std::min_element(stat.averages.cbegin(), stat.averages.cend());
+
+        stat.averages.append(average);
+
+        if (stat.averages.count() > BaselineWindows) stat.averages.removeFirst();
+
+        stat.sum = 0;
+        stat.count = 0;
+
+        if (base <= 0) continue;
+
+        double ratio = static_cast<double>(average) / base;
+
+        if (ratio > LatencyTolerance) congested = true;
+
+        if (ratio > worstRatio)
+        {
+            worstRatio = ratio;
+            averageLatency = average;
+            baseLatency = base;
+        }
+    }
+
+    double lastThroughput = _lastThroughput;
+
+    _lastThroughput = throughput;
+
+    _resetWindow();
+
+    _congestedWindows = congested ? _congestedWindows + 1 : 0;
+
+    QString stat = QString("吞吐量 %1 KB/s，平均延迟 %2 ms，基准延迟 %3 ms")
+            .arg(throughput / 1024, 0, 'f', 1)
+            .arg(averageLatency)
+            .arg(baseLatency);
+
+    if (_congestedWindows >= DecreaseWindows && _limit > _minLimit)
+    {
+        --_limit;
+        _reason = "延迟升高，减少并发：" + stat;
+
+        _congestedWindows = 0;
+
+        return true;
+    }
+
+    // 没有排队的请求时增加并发没有意义
+    if (saturatedFlag && !congested && throughput >= lastThroughput * ThroughputTolerance && _limit < _maxLimit)
+    {
+        ++_limit;
+        _reason = "吞吐量未下降，增加并发：" + stat;
+
+        return true;
+    }
+
+    return false;
+}
+
+bool ConcurrencyController::throttle(const QString &cause)
+{
+    if (_lastDecrease.isValid() && _lastDecrease.elapsed() < DecreaseCooldown) return false;
+
+    int limit = _limit / 2;
+
+    if (limit < _minLimit) limit = _minLimit;
+
+    _lastDecrease.start();
+
+    // 限流后重新测量吞吐量
+    _lastThroughput = 0;
+
+    _resetWindow();
+
+    if (limit == _limit) return false;
+
+    _limit = limit;
+    _reason = cause + "，并发减半";
+
+    qDebug() << "ConcurrencyController throttle:" << cause << "limit:" << _limit;
+
+    return true;
+}
+
+// Private Methods
+void ConcurrencyController::_resetWindow()
+{
+    _bytes = 0;
+    _saturated = false;
+
+    _window.restart();
+}
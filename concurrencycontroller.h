@@ -0,0 +1,56 @@
+#ifndef CONCURRENCYCONTROLLER_H
+#define CONCURRENCYCONTROLLER_H
+
+#include <QString>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVector>
+
+// 按加性增、乘性减（AIMD）调整同时进行的请求数
+// 有排队且延迟平稳、吞吐量未下降时加一，延迟连续升高时减一，超时、503 或限流时减半
+class ConcurrencyController
+{
+public:
+    // QNetworkAccessManager 对同一主机最多建立 6 个 HTTP/1.1 连接，超出的请求在其内部排队：
+    // 排队超过连接超时会被看门狗当作超时中止，延迟中也混入了排队时间，因此并发上限不超过连接数
+    static const int MaxConnectionsPerHost = 6;
+    static const int InitialLimit = MaxConnectionsPerHost;
+
+    explicit ConcurrencyController(int minLimit = 2, int maxLimit = MaxConnectionsPerHost);
+
+    int limit() const;
+    const QString& reason() const;
+
+    // latencyClass 区分不同类型的请求，各自维护基准延迟；latency 为收到响应头的耗时，未知时传 -1
+    bool record(int latencyClass, qint64 bytes, qint64 latency, bool saturated);
+    bool throttle(const QString &cause);
+
+private:
+    typedef struct latencyStat
+    {
+        qint64 sum = 0;
+        int count = 0;
+        QVector<qint64> averages; // 最近若干窗口的平均延迟，取最小值作为基准
+    } LatencyStat;
+
+    int _limit;
+    int _minLimit;
+    int _maxLimit;
+    QString _reason;
+
+    // 当前统计窗口
+    QElapsedTimer _window;
+    qint64 _bytes = 0;
+    bool _saturated = false;
+
+    QHash<int, LatencyStat> _latencies;
+
+    double _lastThroughput = 0;
+    int _congestedWindows = 0;
+
+    QElapsedTimer _lastDecrease;
+
+    void _resetWindow();
+};
+
+#endif // CONCURRENCYCONTROLLER_H
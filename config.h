@@ -11,6 +11,8 @@ typedef struct
     QList<Account> accounts;
     QString currentAccount;
     bool skipOlder;
+    qint64 uploadLimit; // KB/s，0 表示不限速
+    qint64 downloadLimit; // KB/s，0 表示不限速
 } Config;
 
 #endif // CONFIG_H
@@ -0,0 +1,167 @@
+#include "downloadcheckpoint.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+// 下载过程中最多每隔这么久写一次记录，漏记的部分续传时重新下载
+static const qint64 FlushInterval = 1000;
+
+// Constructor
+DownloadCheckpoint::DownloadCheckpoint(const QString &partPath) : _path(partPath + ".json")
+{
+    _lastWrite.start();
+}
+
+// Public Methods
+bool DownloadCheckpoint::load()
+{
+    QFile file(_path);
+
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QJsonObject obj = QJsonDocument::fromJson(file.readAll()).object();
+
+    file.close();
+
+    _objectKey = obj["objectKey"].toString();
+    _fileSize = obj["fileSize"].toString().toLongLong();
+    _etag = obj["etag"].toString();
+    _ranges.clear();
+
+    foreach (const QJsonValue &value, obj["ranges"].toArray())
+    {
+        QJsonArray range = value.toArray();
+
+        _addRange(range.at(0).toString().toLongLong(), range.at(1).toString().toLongLong());
+    }
+
+    return !_objectKey.isEmpty() && !_etag.isEmpty();
+}
+
+bool DownloadCheckpoint::save()
+{
+    QJsonArray ranges;
+
+    foreach (const ByteRange &range, _ranges)
+        ranges.append(QJsonArray({ QString::number(range.first), QString::number(range.second) }));
+
+    // 64 位整数以字符串保存，避免 JSON double 精度问题
+    QJsonObject obj = {
+        { "objectKey", _objectKey },
+        { "fileSize", QString::number(_fileSize) },
+        { "etag", _etag },
+        { "ranges", ranges }
+    };
+
+    _lastWrite.restart();
+
+    QSaveFile file(_path);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Open download checkpoint failure:" << _path;
+
+        return false;
+    }
+
+    file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+
+    if (!file.commit())
+    {
+        qWarning() << "Write download checkpoint failure:" << _path;
+
+        return false;
+    }
+
+    return true;
+}
+
+void DownloadCheckpoint::update(qint64 begin, qint64 end)
+{
+    _addRange(begin, end);
+
+    if (_lastWrite.elapsed() >= FlushInterval) save();
+}
+
+void DownloadCheckpoint::remove()
+{
+    QFile::remove(_path);
+}
+
+void DownloadCheckpoint::reset(const QString &objectKey, qint64 fileSize)
+{
+    _objectKey = objectKey;
+    _fileSize = fileSize;
+    _etag.clear();
+    _ranges.clear();
+}
+
+const QString& DownloadCheckpoint::objectKey() const
+{
+    return _objectKey;
+}
+
+qint64 DownloadCheckpoint::fileSize() const
+{
+    return _fileSize;
+}
+
+const QString& DownloadCheckpoint::etag() const
+{
+    return _etag;
+}
+
+void DownloadCheckpoint::setEtag(const QString &etag)
+{
+    _etag = etag;
+}
+
+qint64 DownloadCheckpoint::prefixSize() const
+{
+    if (_ranges.isEmpty() || _ranges.first().first != 0) return 0;
+
+    return _ranges.first().second;
+}
+
+QList<ByteRange> DownloadCheckpoint::missingRanges() const
+{
+    QList<ByteRange> missing;
+
+    qint64 begin = 0;
+
+    foreach (const ByteRange &range, _ranges)
+    {
+        if (range.first > begin) missing.append(ByteRange(begin, range.first));
+
+        begin = range.second;
+    }
+
+    if (begin < _fileSize) missing.append(ByteRange(begin, _fileSize));
+
+    return missing;
+}
+
+// Private Methods
+void DownloadCheckpoint::_addRange(qint64 begin, qint64 end)
+{
+    if (begin < 0 || end <= begin) return;
+
+    // 合并所有与新范围重叠或相邻的范围
+    QList<ByteRange>::iterator it = _ranges.begin();
+
+    while (it != _ranges.end() && it->second < begin) ++it;
+
+    while (it != _ranges.end() && it->first <= end)
+    {
+        begin = qMin(begin, it->first);
+        end = qMax(end, it->second);
+
+        it = _ranges.erase(it);
+    }
+
+    _ranges.insert(it, ByteRange(begin, end));
+}
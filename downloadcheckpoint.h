@@ -0,0 +1,43 @@
+#ifndef DOWNLOADCHECKPOINT_H
+#define DOWNLOADCHECKPOINT_H
+
+#include <QString>
+#include <QList>
+#include <QPair>
+#include <QElapsedTimer>
+
+typedef QPair<qint64, qint64> ByteRange; // [begin, end)
+
+// 记录未完成下载已写入临时文件的字节范围及对象 ETag，保存在临时文件旁的 .json 中
+class DownloadCheckpoint
+{
+public:
+    explicit DownloadCheckpoint(const QString &partPath = "");
+
+    bool load();
+    bool save();
+    void update(qint64 begin, qint64 end);
+    void remove();
+    void reset(const QString &objectKey, qint64 fileSize);
+
+    const QString& objectKey() const;
+    qint64 fileSize() const;
+    const QString& etag() const;
+    void setEtag(const QString &etag);
+
+    qint64 prefixSize() const;
+    QList<ByteRange> missingRanges() const;
+
+private:
+    QString _path;
+    QString _objectKey;
+    qint64 _fileSize = 0;
+    QString _etag;
+    QList<ByteRange> _ranges; // 按起点排序且互不相邻
+
+    QElapsedTimer _lastWrite;
+
+    void _addRange(qint64 begin, qint64 end);
+};
+
+#endif // DOWNLOADCHECKPOINT_H
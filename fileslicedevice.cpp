@@ -0,0 +1,174 @@
+#include "fileslicedevice.h"
+#include "ratelimiter.h"
+
+#include <QCryptographicHash>
+#include <QTimer>
+#include <QDebug>
+
+#include <climits>
+#include <cstring>
+
+// 无法映射时每次从文件读取的大小
+static const qint64 ReadChunkSize = 1048576;
+
+// Constructor
+FileSliceDevice::FileSliceDevice(const QString &filePath, qint64 offset, qint64 size, QObject *parent) :
+    QIODevice(parent),
+    _file(filePath),
+    _offset(offset),
+    _size(size),
+    _map(nullptr),
+    _limiter(nullptr),
+    _isWaiting(false)
+{
+}
+
+// Destructor
+FileSliceDevice::~FileSliceDevice()
+{
+    close();
+}
+
+// Public Methods
+bool FileSliceDevice::open(OpenMode mode)
+{
+    if ((mode & QIODevice::WriteOnly) || _offset < 0 || _size < 0) return false;
+
+    if (!_file.open(QIODevice::ReadOnly)) return false;
+
+    if (_file.size() < _offset + _size)
+    {
+        _file.close();
+
+        return false;
+    }
+
+    // 映射失败（如 32 位进程地址空间不足）时退回普通读取
+    if (_size > 0) _map = _file.map(_offset, _size);
+
+    if (!_map) qDebug() << "FileSliceDevice map failure, fallback to read:" << _file.fileName();
+
+    // 不使用 QIODevice 自带的缓冲，避免再复制一次
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void FileSliceDevice::close()
+{
+    if (_map)
+    {
+        _file.unmap(_map);
+
+        _map = nullptr;
+    }
+
+    _file.close();
+
+    if (isOpen()) QIODevice::close();
+}
+
+bool FileSliceDevice::isSequential() const
+{
+    return false;
+}
+
+qint64 FileSliceDevice::size() const
+{
+    return _size;
+}
+
+QByteArray FileSliceDevice::md5()
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+
+    if (_map)
+    {
+        // 直接对映射区计算，addData 每次最多接受 int 长度
+        for (qint64 done = 0; done < _size; done += INT_MAX)
+        {
+            qint64 length = _size - done;
+
+            if (length > INT_MAX) length = INT_MAX;
+
+            hash.addData(reinterpret_cast<const char*>(_map + done), static_cast<int>(length));
+        }
+
+        return hash.result();
+    }
+
+    if (!_file.seek(_offset)) return QByteArray();
+
+    for (qint64 done = 0; done < _size; )
+    {
+        qint64 length = _size - done;
+
+        if (length > ReadChunkSize) length = ReadChunkSize;
+
+        QByteArray chunk = _file.read(length);
+
+        if (chunk.isEmpty()) return QByteArray();
+
+        hash.addData(chunk);
+
+        done += chunk.size();
+    }
+
+    return hash.result();
+}
+
+void FileSliceDevice::setRateLimiter(RateLimiter *limiter)
+{
+    _limiter = limiter;
+}
+
+// Protected Methods
+qint64 FileSliceDevice::readData(char *data, qint64 maxSize)
+{
+    qint64 position = pos();
+    qint64 length = _size - position;
+
+    if (length <= 0) return 0;
+    if (length > maxSize) length = maxSize;
+
+    // 限速时只交出已有令牌的部分，令牌不足时等补足后通过 readyRead 通知继续读取
+    if (_limiter)
+    {
+        qint64 granted = _limiter->take(length);
+
+        if (granted == 0)
+        {
+            if (!_isWaiting)
+            {
+                _isWaiting = true;
+
+                QTimer::singleShot(static_cast<int>(_limiter->delay(length)), this, [this] {
+                    _isWaiting = false;
+
+                    emit readyRead();
+                });
+            }
+
+            return 0;
+        }
+
+        length = granted;
+    }
+
+    if (_map)
+    {
+        memcpy(data, _map + position, static_cast<size_t>(length));
+
+        return length;
+    }
+
+    if (!_file.seek(_offset + position)) return -1;
+
+    return _file.read(data, length);
+}
+
+qint64 FileSliceDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+
+    return -1;
+}
@@ -0,0 +1,41 @@
+#ifndef FILESLICEDEVICE_H
+#define FILESLICEDEVICE_H
+
+#include <QIODevice>
+#include <QFile>
+
+class RateLimiter;
+
+// 只读的文件片段 [offset, offset + size)，尽量通过内存映射读取，作为请求体时不需要先复制到 QByteArray
+class FileSliceDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit FileSliceDevice(const QString &filePath, qint64 offset, qint64 size, QObject *parent = nullptr);
+    ~FileSliceDevice();
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override;
+    qint64 size() const override;
+
+    QByteArray md5();
+
+    void setRateLimiter(RateLimiter *limiter);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    QFile _file;
+    qint64 _offset;
+    qint64 _size;
+    uchar *_map;
+
+    RateLimiter *_limiter;
+    bool _isWaiting;
+};
+
+#endif // FILESLICEDEVICE_H
@@ -0,0 +1,226 @@
+#ifndef LANESCHEDULER_H
+#define LANESCHEDULER_H
+
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+
+// 调度通道，数值越大同等条件下越优先
+enum Lane
+{
+    uploadLane,             // 上传及分块
+    downloadLane,           // 下载及分段
+    metadataLane,           // 查询、删除、复制、移动、中断分块上传等小请求
+    interactiveLane,        // 列表、完成分块上传等用户等待结果的请求
+    LaneCount
+};
+
+// 按通道排队的调度器：每个通道有自己的并发上限，共享全局上限 capacity
+// 空出位置时交给「运行数 / 权重」最小的通道，即按权重公平分配；空闲通道的份额可被其他通道借用
+template <class T>
+class LaneScheduler
+{
+public:
+    explicit LaneScheduler(int capacity);
+
+    void push(Lane lane, const T &data);
+    bool nextLane(Lane *lane) const;
+    T start(Lane lane);
+    void finish(Lane lane);
+
+    template <class Predicate>
+    QList<T> takeIf(Predicate match);
+
+    int pendingCount() const;
+    int runningCount() const;
+    void clear();
+
+    int capacity() const;
+    void setCapacity(int capacity);
+    void setLane(Lane lane, int limit, int weight);
+
+private:
+    typedef struct laneState
+    {
+        QList<T> pending;
+        int running;
+        int limit;
+        int weight;
+    } LaneState;
+
+    int _capacity;
+    LaneState _lanes[LaneCount];
+    mutable QMutex _mutex;
+
+    int _runningCount() const;
+
+    Q_DISABLE_COPY(LaneScheduler)
+};
+
+template <class T>
+LaneScheduler<T>::LaneScheduler(int capacity) : _capacity(capacity)
+{
+    for (int i = 0; i < LaneCount; ++i) _lanes[i].running = 0;
+
+    setLane(uploadLane, 32, 3);
+    setLane(downloadLane, 32, 3);
+    setLane(metadataLane, 8, 2);
+    setLane(interactiveLane, 4, 2);
+}
+
+template <class T>
+void LaneScheduler<T>::push(Lane lane, const T &data)
+{
+    QMutexLocker locker(&_mutex);
+
+    _lanes[lane].pending.push_back(data);
+}
+
+template <class T>
+bool LaneScheduler<T>::nextLane(Lane *lane) const
+{
+    QMutexLocker locker(&_mutex);
+
+    int running = _runningCount();
+
+    if (running >= _capacity) return false;
+
+    // 上传、下载不占最后一个位置，大批量传输时其他请求不必等分块完成
+    int bulkCapacity = _capacity > 2 ? _capacity - 1 : _capacity;
+    int next = -1;
+
+    for (int i = LaneCount - 1; i >= 0; --i)
+    {
+        const LaneState &state = _lanes[i];
+
+        if (state.pending.isEmpty() || state.running >= state.limit) continue;
+        if ((i == uploadLane || i == downloadLane) && running >= bulkCapacity) continue;
+
+        // 比较 running / weight，相同时保留优先级较高的通道
+        if (next < 0 || state.running * _lanes[next].weight < _lanes[next].running * state.weight) next = i;
+    }
+
+    if (next < 0) return false;
+
+    *lane = static_cast<Lane>(next);
+
+    return true;
+}
+
+template <class T>
+T LaneScheduler<T>::start(Lane lane)
+{
+    QMutexLocker locker(&_mutex);
+
+    ++_lanes[lane].running;
+
+    return _lanes[lane].pending.takeFirst();
+}
+
+template <class T>
+void LaneScheduler<T>::finish(Lane lane)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (_lanes[lane].running > 0) --_lanes[lane].running;
+}
+
+// 取出所有满足条件的排队任务，用于取消或暂停
+template <class T>
+template <class Predicate>
+QList<T> LaneScheduler<T>::takeIf(Predicate match)
+{
+    QMutexLocker locker(&_mutex);
+
+    QList<T> taken;
+
+    for (int i = 0; i < LaneCount; ++i)
+    {
+        typename QList<T>::iterator it = _lanes[i].pending.begin();
+
+        while (it != _lanes[i].pending.end())
+        {
+            if (match(*it))
+            {
+                taken.append(*it);
+
+                it = _lanes[i].pending.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    return taken;
+}
+
+template <class T>
+int LaneScheduler<T>::pendingCount() const
+{
+    QMutexLocker locker(&_mutex);
+
+    int count = 0;
+
+    for (int i = 0; i < LaneCount; ++i) count += _lanes[i].pending.count();
+
+    return count;
+}
+
+template <class T>
+int LaneScheduler<T>::runningCount() const
+{
+    QMutexLocker locker(&_mutex);
+
+    return _runningCount();
+}
+
+template <class T>
+void LaneScheduler<T>::clear()
+{
+    QMutexLocker locker(&_mutex);
+
+    for (int i = 0; i < LaneCount; ++i)
+    {
+        _lanes[i].pending.clear();
+        _lanes[i].running = 0;
+    }
+}
+
+template <class T>
+int LaneScheduler<T>::capacity() const
+{
+    QMutexLocker locker(&_mutex);
+
+    return _capacity;
+}
+
+template <class T>
+void LaneScheduler<T>::setCapacity(int capacity)
+{
+    QMutexLocker locker(&_mutex);
+
+    _capacity = capacity;
+}
+
+template <class T>
+void LaneScheduler<T>::setLane(Lane lane, int limit, int weight)
+{
+    QMutexLocker locker(&_mutex);
+
+    _lanes[lane].limit = limit;
+    _lanes[lane].weight = weight > 0 ? weight : 1;
+}
+
+template <class T>
+int LaneScheduler<T>::_runningCount() const
+{
+    int count = 0;
+
+    for (int i = 0; i < LaneCount; ++i) count += _lanes[i].running;
+
+    return count;
+}
+
+#endif // LANESCHEDULER_H
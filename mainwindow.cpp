@@ -22,6 +22,7 @@
 #include <QMimeData>
 #include <QPushButton>
 #include <QHeaderView>
+#include <QScrollBar>
 #include <QMenuBar>
 #include <QSettings>
 #include <QTimer>
@@ -31,6 +32,8 @@
 #include <QWinTaskbarProgress>
 #include <QVariant>
 
+#include <algorithm>
+
 #include "logger.h"
 #include "otablewidget.h"
 #include "accountwindow.h"
@@ -43,8 +46,8 @@ MainWindow::MainWindow(QWidget *parent) :
     _client(new Client),
     _cdn(new CDN),
     _logger(new Logger),
-    _jobQueue(new JobQueue<Task>),
-    _workQueue(new WorkerQueue<Task>(6)),
+    _scheduler(new LaneScheduler<Task>(ConcurrencyController::InitialLimit)),
+    _taskJournal(new TaskJournal(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/tasks.journal")),
     _taskTimer(new QTimer(this)),
     _progressTimer(new QTimer(this)),
     _winTaskbarButton(new QWinTaskbarButton(this))
@@ -76,6 +79,10 @@ MainWindow::MainWindow(QWidget *parent) :
         _lastSortOrder = static_cast<Qt::SortOrder>(columnAndOrder.last().toInt());
     }
 
+    // 配置文件不存在时默认不限速
+    _config.uploadLimit = 0;
+    _config.downloadLimit = 0;
+
     _initUI();
     _connectSlots();
     _initAccount();
@@ -114,13 +121,13 @@ MainWindow::~MainWindow()
     _logger->deleteLater();
     _logger = nullptr;
 
-    _workQueue->clear();
-    delete _workQueue;
-    _workQueue = nullptr;
+    _scheduler->clear();
+    delete _scheduler;
+    _scheduler = nullptr;
 
-    _jobQueue->clear();
-    delete _jobQueue;
-    _jobQueue = nullptr;
+    // 未完成的任务留在日志中，下次启动时继续
+    delete _taskJournal;
+    _taskJournal = nullptr;
 }
 
 // Public Methods
@@ -449,6 +456,21 @@ void MainWindow::_initUI()
 
     taskTabsLayout->addWidget(_taskCountLabel);
 
+    _concurrencyLabel = new QLabel(tasksWidget);
+    _concurrencyLabel->setObjectName("concurrency-label");
+    _concurrencyLabel->setAlignment(Qt::AlignCenter);
+    _concurrencyLabel->setText("并发: " + QString::number(ConcurrencyController::InitialLimit));
+
+    taskTabsLayout->addWidget(_concurrencyLabel);
+
+    // 被看门狗中止的请求数，出现后才显示
+    _stallLabel = new QLabel(tasksWidget);
+    _stallLabel->setObjectName("stall-label");
+    _stallLabel->setAlignment(Qt::AlignCenter);
+    _stallLabel->hide();
+
+    taskTabsLayout->addWidget(_stallLabel);
+
     tasksLayout->addWidget(taskTabs);
 
     // 任务列表
@@ -460,6 +482,7 @@ void MainWindow::_initUI()
     _taskTable->setSelectionMode(QAbstractItemView::NoSelection);
     _taskTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
     _taskTable->setFocusPolicy(Qt::NoFocus);
+    _taskTable->setContextMenuPolicy(Qt::CustomContextMenu);
 
     QStringList taskHeaderLabels = { "操作", "名称", "大小", "状态" };
 
@@ -543,6 +566,26 @@ void MainWindow::_initMenu()
     _cdnGroup = new QActionGroup(_cdnMenu);
     _cdnGroup->setExclusive(true);
 
+    // 传输
+    _transferMenu = menuBar()->addMenu("传输");
+
+    _uploadLimitAction = new QAction("上传限速: 不限");
+    _transferMenu->addAction(_uploadLimitAction);
+
+    _downloadLimitAction = new QAction("下载限速: 不限");
+    _transferMenu->addAction(_downloadLimitAction);
+
+    _transferMenu->addSeparator();
+
+    _pauseAllAction = new QAction("暂停全部任务");
+    _transferMenu->addAction(_pauseAllAction);
+
+    _resumeAllAction = new QAction("继续全部任务");
+    _transferMenu->addAction(_resumeAllAction);
+
+    _cancelAllAction = new QAction("取消全部任务");
+    _transferMenu->addAction(_cancelAllAction);
+
     // 帮助
     _helpMenu = menuBar()->addMenu("帮助");
 
@@ -561,6 +604,8 @@ void MainWindow::_connectSlots()
     connect(this, &MainWindow::deleteObject, _client, &Client::deleteObject, Qt::QueuedConnection);
     connect(this, &MainWindow::copyObject, _client, &Client::copyObject, Qt::QueuedConnection);
     connect(this, &MainWindow::moveObject, _client, &Client::moveObject, Qt::QueuedConnection);
+    connect(this, &MainWindow::setRateLimit, _client, &Client::setRateLimit, Qt::QueuedConnection);
+    connect(this, &MainWindow::cancelObject, _client, &Client::cancelObject, Qt::QueuedConnection);
 
     connect(_client, &Client::listBucketResponse, this, &MainWindow::_listBucketResponse, Qt::QueuedConnection);
     connect(_client, &Client::listObjectResponse, this, &MainWindow::_listObjectResponse, Qt::QueuedConnection);
@@ -571,7 +616,10 @@ void MainWindow::_connectSlots()
     connect(_client, &Client::copyObjectResponse, this, &MainWindow::_copyObjectResponse, Qt::QueuedConnection);
     connect(_client, &Client::moveObjectResponse, this, &MainWindow::_moveObjectResponse, Qt::QueuedConnection);
     connect(_client, &Client::updateProgressResponse, this, &MainWindow::_updateProgressResponse, Qt::QueuedConnection);
+    connect(_client, &Client::retryResponse, this, &MainWindow::_retryResponse, Qt::QueuedConnection);
+    connect(_client, &Client::stallResponse, this, &MainWindow::_stallResponse, Qt::QueuedConnection);
     connect(_client, &Client::errorResponse, this, &MainWindow::_errorResponse, Qt::QueuedConnection);
+    connect(_client, &Client::concurrencyChanged, this, &MainWindow::_concurrencyChanged, Qt::QueuedConnection);
 
     // CDN
     connect(this, &MainWindow::listDomain, _cdn, &CDN::listDomain, Qt::QueuedConnection);
@@ -605,6 +653,24 @@ void MainWindow::_connectSlots()
         _writeConfigToJSON();
     });
 
+    connect(_uploadLimitAction, &QAction::triggered, [this] {
+        _rateLimitClicked(true);
+    });
+
+    connect(_downloadLimitAction, &QAction::triggered, [this] {
+        _rateLimitClicked(false);
+    });
+
+    connect(_pauseAllAction, &QAction::triggered, [this] {
+        _stopTasks([](const Task &) { return true; }, true);
+    });
+
+    connect(_resumeAllAction, &QAction::triggered, [this] {
+        _resumeTasks([](const Task &) { return true; });
+    });
+
+    connect(_cancelAllAction, &QAction::triggered, this, &MainWindow::_cancelAllClicked);
+
     connect(_listDomainAction, &QAction::triggered, [this] {
         _listDomain();
     });
@@ -634,6 +700,9 @@ void MainWindow::_connectSlots()
     connect(_objectTable, &OTableWidget::selectedRowsChanged, this, &MainWindow::_selectedRowsChange);
 
     connect(_objectTable->horizontalHeader(), &QHeaderView::sectionClicked, this, &MainWindow::_sortByColumn);
+    connect(_objectTable->verticalScrollBar(), &QScrollBar::valueChanged, this, &MainWindow::_objectTableScrolled);
+
+    connect(_taskTable, &QTableWidget::customContextMenuRequested, this, &MainWindow::_showTaskTableMenu);
 
     // Action
     connect(_uploadFileButton, &QPushButton::clicked, this, &MainWindow::_uploadFileClicked);
@@ -705,6 +774,8 @@ bool MainWindow::_initAccount()
 
     _changeSkipOlder(_config.skipOlder);
 
+    _changeRateLimit(root["uploadLimit"].toInt(), root["downloadLimit"].toInt());
+
     if (_config.accounts.length() == 0)
     {
         _openAccountWindow("new");
@@ -962,6 +1033,8 @@ void MainWindow::_writeConfigToJSON()
         root.insert("accounts", accounts);
         root.insert("currentAccount", _config.currentAccount);
         root.insert("skipOlder", _config.skipOlder);
+        root.insert("uploadLimit", _config.uploadLimit);
+        root.insert("downloadLimit", _config.downloadLimit);
 
         QJsonDocument jsonDoc(root);
         QByteArray jsonData = jsonDoc.toJson(QJsonDocument::Compact);
@@ -1078,21 +1151,421 @@ void MainWindow::_log(Client::Operation operation, Status status, const QString
 
 void MainWindow::_perform()
 {
-    if (_workQueue->isFull()) return;
-    if (_jobQueue->isEmpty()) return;
+    // 并发上限调大后一次补满
+    Lane lane;
+
+    while (_scheduler->nextLane(&lane))
+    {
+        Task task = _scheduler->start(lane);
+
+        // 同名任务可能同时存在，结果按名字逐个对应
+        _runningTasks.insertMulti(_taskName(task), task);
+
+        _taskJournal->start(task.journalId);
+
+        switch (task.operation)
+        {
+        case Client::getObjectOperation: _downloadObject(task); break;
+        case Client::putObjectOperation: _putObject(task); break;
+        case Client::deleteObjectOperation: _deleteObject(task); break;
+        case Client::copyObjectOperation: _copyObject(task); break;
+        case Client::moveObjectOperation: _moveObject(task); break;
+        default: qDebug() << "Unknown operation";
+        }
+    }
+}
+
+void MainWindow::_enqueueTask(Task &task)
+{
+    task.id = ++_lastTaskId;
+
+    // 从日志恢复的任务沿用原来的记录
+    if (task.journalId == 0) task.journalId = _taskJournal->add(_taskRecord(task.operation, _journalParams(task), task.group));
+
+    _scheduler->push(Client::laneOf(task.operation), task);
+
+    if (!_taskTimer->isActive()) _taskTimer->start(1000);
+    if (!_progressTimer->isActive()) _progressTimer->start(1000);
+
+    ++_totalTaskCount;
+
+    _perform();
+}
+
+// 排队中的任务直接移出队列，进行中的任务通知 Client 中止请求
+// 暂停的任务保留续传信息，之后可以继续；取消的任务计为已完成
+void MainWindow::_stopTasks(const std::function<bool(const Task&)> &match, bool pause)
+{
+    QList<Task> stopped = _scheduler->takeIf(match);
+
+    QHash<QString, Task>::iterator it = _runningTasks.begin();
+
+    while (it != _runningTasks.end())
+    {
+        if (!match(it.value()))
+        {
+            ++it;
+
+            continue;
+        }
+
+        Task task = it.value();
+
+        it = _runningTasks.erase(it);
+
+        _scheduler->finish(Client::laneOf(task.operation));
+
+        _updateTask(_taskAction(task), _taskName(task), pause ? "已暂停" : "已取消");
+
+        if (task.operation == Client::putObjectOperation) _removeUpload(_taskName(task));
+
+        emit cancelObject(_cancelParams(task, pause));
+
+        stopped.append(task);
+    }
+
+    if (pause)
+    {
+        foreach (const Task &task, stopped) _pausedTasks.insert(task.id, task);
+    }
+    else
+    {
+        QMap<quint64, Task>::iterator pi = _pausedTasks.begin();
+
+        while (pi != _pausedTasks.end())
+        {
+            if (!match(pi.value()))
+            {
+                ++pi;
+
+                continue;
+            }
+
+            Task task = pi.value();
+
+            pi = _pausedTasks.erase(pi);
+
+            int row = _taskRow(task.id);
+
+            if (row > -1)
+            {
+                QTableWidgetItem *statusItem = _taskTable->item(row, 3);
+
+                if (statusItem) statusItem->setText("已取消");
+            }
+
+            emit cancelObject(_cancelParams(task, false));
+
+            stopped.append(task);
+        }
+
+        _doneTaskCount += stopped.count();
+
+        foreach (const Task &task, stopped) _taskJournal->finish(task.journalId);
+    }
+
+    if (stopped.isEmpty()) return;
+
+    _perform();
+
+    _updateTaskCount();
+
+    _checkWorkDone();
+}
+
+void MainWindow::_resumeTasks(const std::function<bool(const Task&)> &match)
+{
+    QList<quint64> ids;
+
+    for (QMap<quint64, Task>::const_iterator ci = _pausedTasks.constBegin(); ci != _pausedTasks.constEnd(); ++ci)
+    {
+        if (match(ci.value())) ids.append(ci.key());
+    }
+
+    if (ids.isEmpty()) return;
+
+    // 按原来加入的顺序重新排队，已计入总数，不再重复计数
+    foreach (quint64 id, ids)
+    {
+        Task task = _pausedTasks.take(id);
+
+        int row = _taskRow(id);
+
+        if (row > -1) _taskTable->removeRow(row);
+
+        _scheduler->push(Client::laneOf(task.operation), task);
+    }
+
+    if (!_taskTimer->isActive()) _taskTimer->start(1000);
+    if (!_progressTimer->isActive()) _progressTimer->start(1000);
+
+    _perform();
+
+    _updateTaskCount();
+}
+
+bool MainWindow::_finishTask(const QString &name)
+{
+    if (!_runningTasks.contains(name)) return false;
+
+    Task task = _runningTasks.take(name);
+
+    _scheduler->finish(Client::laneOf(task.operation));
+
+    // 失败的任务同样算作结束，不在下次启动时重试
+    _taskJournal->finish(task.journalId);
+
+    return true;
+}
+
+bool MainWindow::_findTask(quint64 id, Task &task) const
+{
+    for (QHash<QString, Task>::const_iterator ci = _runningTasks.constBegin(); ci != _runningTasks.constEnd(); ++ci)
+    {
+        if (ci.value().id != id) continue;
+
+        task = ci.value();
+
+        return true;
+    }
+
+    QMap<quint64, Task>::const_iterator ci = _pausedTasks.find(id);
+
+    if (ci == _pausedTasks.constEnd()) return false;
+
+    task = ci.value();
+
+    return true;
+}
+
+int MainWindow::_taskRow(quint64 id) const
+{
+    if (id == 0) return -1;
+
+    for (int row = 0; row < _taskTable->rowCount(); ++row)
+    {
+        QTableWidgetItem *item = _taskTable->item(row, 0);
+
+        if (item && item->data(Qt::UserRole).toULongLong() == id) return row;
+    }
+
+    return -1;
+}
+
+QString MainWindow::_taskName(const Task &task)
+{
+    switch (task.operation)
+    {
+    case Client::getObjectOperation: return task.params.value<GetObjectParams>().objectKey;
+    case Client::putObjectOperation: return task.params.value<PutObjectParams>().objectKey;
+    case Client::deleteObjectOperation: return task.params.value<DeleteObjectParams>().objectKey;
+    case Client::copyObjectOperation:
+    case Client::moveObjectOperation:
+    {
+        CopyObjectParams params = task.params.value<CopyObjectParams>();
+
+        return params.sourceObjectKey + " => " + params.destinationObjectKey;
+    }
+    default: return "";
+    }
+}
+
+// 分块、分段等请求归入所属的任务
+QString MainWindow::_taskName(const RequestContext &context)
+{
+    if (context.sourceObjectKey.isEmpty()) return context.objectKey;
+
+    return context.sourceObjectKey + " => " + context.destinationObjectKey;
+}
 
-    Task task = _jobQueue->pop();
+QString MainWindow::_taskAction(const Task &task)
+{
+    switch (task.operation)
+    {
+    case Client::getObjectOperation: return "下载";
+    case Client::putObjectOperation: return task.params.value<PutObjectParams>().filePath.isEmpty() ? "新建" : "上传";
+    case Client::deleteObjectOperation: return "删除";
+    case Client::copyObjectOperation: return "复制";
+    case Client::moveObjectOperation: return "移动";
+    default: return "";
+    }
+}
 
-    _workQueue->push(task);
+CancelObjectParams MainWindow::_cancelParams(const Task &task, bool pause)
+{
+    CancelObjectParams params = { .objectKey = "", .downloadPath = "", .pause = pause };
 
     switch (task.operation)
     {
-    case Client::getObjectOperation: _downloadObject(task); break;
-    case Client::putObjectOperation: _putObject(task); break;
-    case Client::deleteObjectOperation: _deleteObject(task); break;
-    case Client::copyObjectOperation: _copyObject(task); break;
-    case Client::moveObjectOperation: _moveObject(task); break;
-    default: qDebug() << "Unknown operation";
+    case Client::getObjectOperation:
+    {
+        GetObjectParams getParams = task.params.value<GetObjectParams>();
+
+        params.objectKey = getParams.objectKey;
+        params.downloadPath = getParams.filePath;
+
+        break;
+    }
+    case Client::copyObjectOperation:
+    case Client::moveObjectOperation:
+        params.objectKey = task.params.value<CopyObjectParams>().sourceObjectKey;
+
+        break;
+    default:
+        params.objectKey = _taskName(task);
+    }
+
+    return params;
+}
+
+TaskRecord MainWindow::_taskRecord(Client::Operation operation, const QStringHash &params, const QString &group) const
+{
+    TaskRecord record;
+    record.account = _currentAccount.name;
+    record.bucket = _client->getBucket();
+    record.operation = operation;
+    record.params = params;
+    record.group = group;
+
+    return record;
+}
+
+QStringHash MainWindow::_journalParams(const Task &task)
+{
+    switch (task.operation)
+    {
+    case Client::getObjectOperation:
+    {
+        GetObjectParams params = task.params.value<GetObjectParams>();
+
+        return {
+            { "objectKey", params.objectKey },
+            { "filePath", params.filePath },
+            { "fileSize", QString::number(params.fileSize) }
+        };
+    }
+    case Client::putObjectOperation:
+    {
+        PutObjectParams params = task.params.value<PutObjectParams>();
+
+        return {
+            { "objectKey", params.objectKey },
+            { "filePath", params.filePath },
+            { "fileSize", QString::number(params.fileSize) }
+        };
+    }
+    case Client::deleteObjectOperation: return {{ "objectKey", task.params.value<DeleteObjectParams>().objectKey }};
+    case Client::copyObjectOperation:
+    case Client::moveObjectOperation:
+    {
+        CopyObjectParams params = task.params.value<CopyObjectParams>();
+
+        return {
+            { "sourceBucketName", params.sourceBucketName },
+            { "sourceObjectKey", params.sourceObjectKey },
+            { "destinationBucketName", params.destinationBucketName },
+            { "destinationObjectKey", params.destinationObjectKey }
+        };
+    }
+    default: return QStringHash();
+    }
+}
+
+QVariant MainWindow::_taskParams(const TaskRecord &record)
+{
+    const QStringHash &params = record.params;
+
+    switch (record.operation)
+    {
+    case Client::getObjectOperation:
+    {
+        GetObjectParams getParams(params["objectKey"], params["filePath"]);
+        getParams.fileSize = params["fileSize"].toLongLong();
+
+        return QVariant::fromValue<GetObjectParams>(getParams);
+    }
+    case Client::putObjectOperation:
+    {
+        PutObjectParams putParams = { .objectKey = params["objectKey"], .filePath = params["filePath"], .fileSize = params["fileSize"].toLongLong() };
+
+        return QVariant::fromValue<PutObjectParams>(putParams);
+    }
+    case Client::deleteObjectOperation:
+    {
+        DeleteObjectParams deleteParams = { .objectKey = params["objectKey"] };
+
+        return QVariant::fromValue<DeleteObjectParams>(deleteParams);
+    }
+    case Client::copyObjectOperation:
+    case Client::moveObjectOperation:
+    {
+        CopyObjectParams copyParams(params["sourceBucketName"], params["sourceObjectKey"], params["destinationBucketName"], params["destinationObjectKey"]);
+
+        return QVariant::fromValue<CopyObjectParams>(copyParams);
+    }
+    default: return QVariant();
+    }
+}
+
+// 上次退出时当前桶还有未完成的任务，询问是否继续；已完成的任务不会再查询或上传
+void MainWindow::_resumeJournal()
+{
+    QList<TaskRecord> records = _taskJournal->takeRecovered(_currentAccount.name, _client->getBucket());
+
+    if (records.isEmpty()) return;
+
+    int startedCount = 0;
+
+    foreach (const TaskRecord &record, records)
+    {
+        if (record.started) ++startedCount;
+    }
+
+    QString text = QString("桶 %1 有 %2 个上次未完成的任务（其中 %3 个已开始），是否继续？")
+            .arg(_client->getBucket()).arg(records.count()).arg(startedCount);
+
+    QMessageBox::StandardButton button = QMessageBox::question(this,
+                                                               "继续任务",
+                                                               text,
+                                                               QMessageBox::Yes|QMessageBox::No,
+                                                               QMessageBox::Yes);
+
+    if (button != QMessageBox::Yes)
+    {
+        foreach (const TaskRecord &record, records) _taskJournal->finish(record.id);
+
+        return;
+    }
+
+    // 已开始的任务先执行，它们的续传记录还在
+    std::stable_sort(records.begin(), records.end(), [](const TaskRecord &a, const TaskRecord &b) {
+        return a.started && !b.started;
+    });
+
+    foreach (const TaskRecord &record, records)
+    {
+        Client::Operation operation = static_cast<Client::Operation>(record.operation);
+
+        if (operation == Client::headObjectOperation)
+        {
+            _headObject(record.params["objectKey"], record.params["filePath"], record.params["fileSize"].toLongLong(), record.group, record.id);
+
+            continue;
+        }
+
+        QVariant params = _taskParams(record);
+
+        if (!params.isValid())
+        {
+            _taskJournal->finish(record.id);
+
+            continue;
+        }
+
+        Task task(operation, params, record.group);
+        task.journalId = record.id;
+
+        _enqueueTask(task);
     }
 }
 
@@ -1120,126 +1593,199 @@ void MainWindow::_resortObjects()
 
 void MainWindow::_sortDirs(QStringVector &dirs)
 {
-    if (_lastSortColumn == 0 && _lastSortOrder == Qt::DescendingOrder)
-    {
-        std::sort(dirs.begin(), dirs.end(), [](const QString &dir1, const QString &dir2) {
-            return (dir1 > dir2);
-        });
-    }
-    else std::sort(dirs.begin(), dirs.end());
+    std::sort(dirs.begin(), dirs.end(), [this](const QString &dir1, const QString &dir2) {
+        return _dirLessThan(dir1, dir2);
+    });
 }
 
 void MainWindow::_sortFiles(QVector<File> &files)
 {
-    std::sort(files.begin(), files.end(), [=](const File &file1, const File &file2) {
-        if (_lastSortColumn == 0)
-        {
-            if (_lastSortOrder == Qt::AscendingOrder) return (file1.key < file2.key);
-            else return (file1.key > file2.key);
-        }
-        else if (_lastSortColumn == 1)
-        {
-            if (_lastSortOrder == Qt::AscendingOrder) return (file1.size < file2.size);
-            else return (file1.size > file2.size);
-        }
-        else
-        {
-            if (_lastSortOrder == Qt::AscendingOrder) return (file1.lastModified < file2.lastModified);
-            else return (file1.lastModified > file2.lastModified);
-        }
+    std::sort(files.begin(), files.end(), [this](const File &file1, const File &file2) {
+        return _fileLessThan(file1, file2);
     });
 }
 
-void MainWindow::_listDirs(int startRow, int totalRowCount)
+bool MainWindow::_dirLessThan(const QString &dir1, const QString &dir2) const
 {
-    QString path = _paths.last();
+    if (_lastSortColumn == 0 && _lastSortOrder == Qt::DescendingOrder) return (dir1 > dir2);
+
+    return (dir1 < dir2);
+}
+
+bool MainWindow::_fileLessThan(const File &file1, const File &file2) const
+{
+    if (_lastSortColumn == 0)
+    {
+        if (_lastSortOrder == Qt::AscendingOrder) return (file1.key < file2.key);
+        else return (file1.key > file2.key);
+    }
+    else if (_lastSortColumn == 1)
+    {
+        if (_lastSortOrder == Qt::AscendingOrder) return (file1.size < file2.size);
+        else return (file1.size > file2.size);
+    }
+    else
+    {
+        if (_lastSortOrder == Qt::AscendingOrder) return (file1.lastModified < file2.lastModified);
+        else return (file1.lastModified > file2.lastModified);
+    }
+}
 
+void MainWindow::_listDirs(int startRow, int totalRowCount)
+{
     for (int row = 0; row < _storeDirs.length(); ++row)
     {
         int currentRow = row + startRow;
 
         if (currentRow >= totalRowCount) _objectTable->insertRow(currentRow);
 
-        for (int col = 0; col < _objectTable->columnCount(); ++col)
-        {
-            QString text = "";
+        _setDirRow(currentRow, _storeDirs.at(row));
+    }
+}
 
-            if (col == 0)
-            {
-                QString dir(_storeDirs.at(row));
-                text = path == "" ? dir : dir.replace(dir.indexOf(path), path.size(), "");
-            }
+void MainWindow::_listFiles(int startRow, int totalRowCount)
+{
+    for (int row = 0; row < _storeFiles.length(); ++row)
+    {
+        int currentRow = row + startRow;
 
-            QTableWidgetItem *item = _objectTable->item(currentRow, col);
+        if (currentRow >= totalRowCount) _objectTable->insertRow(currentRow);
 
-            if (!item)
-            {
-                item = new QTableWidgetItem;
+        _setFileRow(currentRow, _storeFiles.at(row));
+    }
+}
 
-                _objectTable->setItem(currentRow, col, item);
-            }
+void MainWindow::_setDirRow(int row, const QString &dir)
+{
+    QString path = _paths.last();
+
+    for (int col = 0; col < _objectTable->columnCount(); ++col)
+    {
+        QString text = "";
+
+        if (col == 0)
+        {
+            text = dir;
+
+            if (path != "") text.replace(text.indexOf(path), path.size(), "");
+        }
 
-            if (col == 0) item->setIcon(QIcon(":/dir-20.png"));
+        QTableWidgetItem *item = _objectTable->item(row, col);
 
-            item->setText(text);
+        if (!item)
+        {
+            item = new QTableWidgetItem;
+
+            _objectTable->setItem(row, col, item);
         }
+
+        if (col == 0) item->setIcon(QIcon(":/dir-20.png"));
+
+        item->setText(text);
     }
 }
 
-void MainWindow::_listFiles(int startRow, int totalRowCount)
+void MainWindow::_setFileRow(int row, const File &file)
 {
     QString path = _paths.last();
 
-    for (int row = 0; row < _storeFiles.length(); ++row)
+    for (int col = 0; col < _objectTable->columnCount(); ++col)
     {
-        int currentRow = row + startRow;
+        QString text = "";
 
-        if (currentRow >= totalRowCount) _objectTable->insertRow(currentRow);
+        switch (col)
+        {
+        case 0:
+            text = file.key;
+
+            if (path != "") text.replace(text.indexOf(path), path.size(), "");
+
+            break;
+        case 1:
+            text = Client::humanReadableSize(file.size, 2);
+
+            break;
+        case 2:
+            text = file.lastModified;
 
-        for (int col = 0; col < _objectTable->columnCount(); ++col)
+            break;
+        }
+
+        QTableWidgetItem *item = _objectTable->item(row, col);
+
+        if (!item)
         {
-            QString text = "";
+            item = new QTableWidgetItem;
 
-            switch (col)
-            {
-            case 0:
-            {
-                QString key(_storeFiles.at(row).key);
-                text = path == "" ? key : key.replace(key.indexOf(path), path.size(), "");
+            _objectTable->setItem(row, col, item);
+        }
 
-                break;
-            }
-            case 1:
-            {
-                quint64 size = _storeFiles.at(row).size;
+        if (col == 0) item->setIcon(QIcon(":/file-20.png"));
+        if (col == 1 || col == 2) item->setTextAlignment(Qt::AlignCenter);
 
-                text = Client::humanReadableSize(size, 2);
+        item->setText(text);
+    }
+}
 
-                break;
-            }
-            case 2:
-                text = _storeFiles.at(row).lastModified;
+// 后续页按当前排序插入到对应位置，已显示的行不再重绘
+void MainWindow::_insertObjects(const QStringVector &dirs, const QVector<File> &files)
+{
+    _objectTable->setUpdatesEnabled(false);
 
-                break;
-            }
+    foreach (const QString &dir, dirs)
+    {
+        if (dir == _paths.last()) continue;
 
-            QTableWidgetItem *item = _objectTable->item(currentRow, col);
+        QStringVector::iterator it = std::upper_bound(_storeDirs.begin(), _storeDirs.end(), dir, [this](const QString &dir1, const QString &dir2) {
+            return _dirLessThan(dir1, dir2);
+        });
 
-            if (!item)
-            {
-                item = new QTableWidgetItem;
+        int index = static_cast<int>(it - _storeDirs.begin());
+        int row = index + (_lastSortOrder == Qt::AscendingOrder ? 0 : _storeFiles.count());
 
-                _objectTable->setItem(currentRow, col, item);
-            }
+        _storeDirs.insert(index, dir);
 
-            if (col == 0) item->setIcon(QIcon(":/file-20.png"));
-            if (col == 1 || col == 2) item->setTextAlignment(Qt::AlignCenter);
+        _objectTable->insertRow(row);
 
-            item->setText(text);
-        }
+        _setDirRow(row, dir);
+    }
+
+    foreach (const File &file, files)
+    {
+        QVector<File>::iterator it = std::upper_bound(_storeFiles.begin(), _storeFiles.end(), file, [this](const File &file1, const File &file2) {
+            return _fileLessThan(file1, file2);
+        });
+
+        int index = static_cast<int>(it - _storeFiles.begin());
+        int row = index + (_lastSortOrder == Qt::AscendingOrder ? _storeDirs.count() : 0);
+
+        _storeFiles.insert(index, file);
+
+        _objectTable->insertRow(row);
+
+        _setFileRow(row, file);
+    }
+
+    _objectTable->setUpdatesEnabled(true);
+
+    if (_objectRowCount != _objectTable->rowCount())
+    {
+        _objectRowCount = _objectTable->rowCount();
+
+        _objectTable->setFirstColumnWidth(width(), height());
     }
 }
 
+// 请求当前目录的下一页，同一时间只有一页在请求中
+void MainWindow::_listNextObjects()
+{
+    if (_isListing || _nextMarker.isEmpty()) return;
+
+    ListObjectParams params(_paths.last(), _nextMarker);
+
+    _listObject(params);
+}
+
 void MainWindow::_listBucket()
 {
     emit listBucket();
@@ -1252,14 +1798,23 @@ void MainWindow::_listObject(const ListObjectParams &params)
     // 2. 进入其他目录
     QHash<QString, DirAction>::const_iterator ci = _dirActions.find(params.prefix);
 
-    if (ci == _dirActions.end() && params.marker.isEmpty())
+    if (ci == _dirActions.end())
     {
-        _storeDirs.clear();
-        _storeFiles.clear();
+        if (params.marker.isEmpty())
+        {
+            _storeDirs.clear();
+            _storeFiles.clear();
+
+            _nextMarker.clear();
+            _isListingAll = false;
+
+            _objectTable->clearSelectedRows();
+            _objectTable->setCurrentItem(nullptr);
+            _objectTable->toggleRowHidden(true);
+        }
 
-        _objectTable->clearSelectedRows();
-        _objectTable->setCurrentItem(nullptr);
-        _objectTable->toggleRowHidden(true);
+        _listingMarker = params.marker;
+        _isListing = true;
     }
 
     emit listObject(params);
@@ -1272,27 +1827,36 @@ void MainWindow::_listCurrentObject()
     _listObject(params);
 }
 
-void MainWindow::_headObject(const QString &objectKey, const QString &filePath, qint64 fileSize)
+void MainWindow::_headObject(const QString &objectKey, const QString &filePath, qint64 fileSize, const QString &group, quint64 journalId)
 {
     HeadObjectParams params(objectKey, filePath, fileSize);
 
+    if (!group.isEmpty()) _headGroups.insert(objectKey, group);
+
+    // 查询也记入日志，中途退出后不必重新扫描整个文件夹
+    if (journalId == 0)
+    {
+        QStringHash journalParams = {
+            { "objectKey", objectKey },
+            { "filePath", filePath },
+            { "fileSize", QString::number(fileSize) }
+        };
+
+        journalId = _taskJournal->add(_taskRecord(Client::headObjectOperation, journalParams, group));
+    }
+
+    _headJournalIds.insertMulti(objectKey, journalId);
+
     emit headObject(params);
 }
 
-void MainWindow::_addPutObjectTask(const QString &objectKey, const QString &filePath, qint64 fileSize)
+void MainWindow::_addPutObjectTask(const QString &objectKey, const QString &filePath, qint64 fileSize, const QString &group)
 {
     PutObjectParams params = { .objectKey = objectKey, .filePath = filePath, .fileSize = fileSize };
 
-    Task task(Client::putObjectOperation, QVariant::fromValue<PutObjectParams>(params));
-
-    _jobQueue->push(task);
-
-    if (!_taskTimer->isActive()) _taskTimer->start(1000);
-    if (!_progressTimer->isActive()) _progressTimer->start(1000);
-
-    ++_totalTaskCount;
+    Task task(Client::putObjectOperation, QVariant::fromValue<PutObjectParams>(params), group);
 
-    _perform();
+    _enqueueTask(task);
 }
 
 void MainWindow::_putObject(const Task &task)
@@ -1300,10 +1864,10 @@ void MainWindow::_putObject(const Task &task)
     PutObjectParams params = task.params.value<PutObjectParams>();
 
     if (params.filePath.isEmpty())
-        _insertTask("新建", params.objectKey, "-", "新建中...");
+        _insertTask("新建", params.objectKey, "-", "新建中...", task.id);
     else
     {
-        _insertTask("上传", params.objectKey, Client::humanReadableSize(params.fileSize, 2), "上传中...");
+        _insertTask("上传", params.objectKey, Client::humanReadableSize(params.fileSize, 2), "上传中...", task.id);
 
         _uploadBytesHash.insert(params.objectKey, 0);
     }
@@ -1311,104 +1875,77 @@ void MainWindow::_putObject(const Task &task)
     emit putObject(params);
 }
 
-void MainWindow::_addDownloadObjectTask(const QString &objectKey, const QString &filePath)
+void MainWindow::_addDownloadObjectTask(const QString &objectKey, const QString &filePath, qint64 fileSize, const QString &group)
 {
     GetObjectParams params(objectKey, filePath);
+    params.fileSize = fileSize;
 
-    Task task(Client::getObjectOperation, QVariant::fromValue<GetObjectParams>(params));
+    Task task(Client::getObjectOperation, QVariant::fromValue<GetObjectParams>(params), group);
 
-    _jobQueue->push(task);
-
-    if (!_taskTimer->isActive()) _taskTimer->start(1000);
-    if (!_progressTimer->isActive()) _progressTimer->start(1000);
-
-    ++_totalTaskCount;
-
-    _perform();
+    _enqueueTask(task);
 }
 
 void MainWindow::_downloadObject(const Task &task)
 {
     GetObjectParams params = task.params.value<GetObjectParams>();
 
-    _insertTask("下载", params.objectKey, "", "下载中...");
+    _insertTask("下载", params.objectKey, "", "下载中...", task.id);
 
     emit getObject(params);
 }
 
-void MainWindow::_addDeleteObjectTask(const QString &objectKey)
+void MainWindow::_addDeleteObjectTask(const QString &objectKey, const QString &group)
 {
     DeleteObjectParams params = { .objectKey = objectKey };
 
-    Task task(Client::deleteObjectOperation, QVariant::fromValue<DeleteObjectParams>(params));
-
-    _jobQueue->push(task);
+    Task task(Client::deleteObjectOperation, QVariant::fromValue<DeleteObjectParams>(params), group);
 
-    if (!_taskTimer->isActive()) _taskTimer->start(1000);
-    if (!_progressTimer->isActive()) _progressTimer->start(1000);
-
-    ++_totalTaskCount;
-
-    _perform();
+    _enqueueTask(task);
 }
 
 void MainWindow::_deleteObject(const Task &task)
 {
     DeleteObjectParams params = task.params.value<DeleteObjectParams>();
 
-    _insertTask("删除", params.objectKey, "-", "删除中...");
+    _insertTask("删除", params.objectKey, "-", "删除中...", task.id);
 
 //    qDebug() << "DeleteObjectParams:" << params;
 
     emit deleteObject(params);
 }
 
-void MainWindow::_addCopyObjectTask(const QString &sourceObjectKey, const QString &destinationObjectKey)
+void MainWindow::_addCopyObjectTask(const QString &sourceObjectKey, const QString &destinationObjectKey, const QString &group)
 {
     CopyObjectParams params(_client->getBucket(), sourceObjectKey, _client->getBucket(), destinationObjectKey);
 
-    Task task(Client::copyObjectOperation, QVariant::fromValue<CopyObjectParams>(params));
-
-    _jobQueue->push(task);
-
-    if (!_taskTimer->isActive()) _taskTimer->start(1000);
-    if (!_progressTimer->isActive()) _progressTimer->start(1000);
-
-    ++_totalTaskCount;
+    Task task(Client::copyObjectOperation, QVariant::fromValue<CopyObjectParams>(params), group);
 
-    _perform();
+    _enqueueTask(task);
 }
 
 void MainWindow::_copyObject(const Task &task)
 {
     CopyObjectParams params = task.params.value<CopyObjectParams>();
 
-    _insertTask("复制", params.sourceObjectKey + " => " + params.destinationObjectKey, "-", "复制中...");
+    _insertTask("复制", params.sourceObjectKey + " => " + params.destinationObjectKey, "-", "复制中...", task.id);
 
     emit copyObject(params);
 }
 
-void MainWindow::_addMoveObjectTask(const QString &sourceObjectKey, const QString &destinationObjectKey)
+void MainWindow::_addMoveObjectTask(const QString &sourceObjectKey, const QString &destinationObjectKey, const QString &group)
 {
     MoveObjectParams params(_client->getBucket(), sourceObjectKey, _client->getBucket(), destinationObjectKey);
 
-    Task task(Client::moveObjectOperation, QVariant::fromValue<MoveObjectParams>(params));
-
-    _jobQueue->push(task);
-
-    if (!_taskTimer->isActive()) _taskTimer->start(1000);
-    if (!_progressTimer->isActive()) _progressTimer->start(1000);
-
-    ++_totalTaskCount;
+    Task task(Client::moveObjectOperation, QVariant::fromValue<MoveObjectParams>(params), group);
 
-    _perform();
+    _enqueueTask(task);
 }
 
 void MainWindow::_moveObject(const Task &task)
 {
     MoveObjectParams params = task.params.value<MoveObjectParams>();
 
-    _insertTask("移动", params.sourceObjectKey + " => " + params.destinationObjectKey, "-", "移动中...");
+    _insertTask("移动", params.sourceObjectKey + " => " + params.destinationObjectKey, "-", "移动中...", task.id);
 
     emit moveObject(params);
 }
@@ -1442,7 +1979,9 @@ void MainWindow::_uploadDir(const QString &dirPath)
 
     QString path = _paths.last();
 
-    _addPutObjectTask(path + dirName + "/", "", 0);
+    QString group = path + dirName + "/";
+
+    _addPutObjectTask(group, "", 0, group);
 
     QDirIterator dirIter(dirPath, QDir::Dirs|QDir::Files|QDir::NoSymLinks|QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
 
@@ -1460,7 +1999,7 @@ void MainWindow::_uploadDir(const QString &dirPath)
         {
             filePath.replace(filePath.indexOf(dirPath), dirPath.size(), "");
 
-            _addPutObjectTask(path + dirName + filePath + "/", "", 0);
+            _addPutObjectTask(path + dirName + filePath + "/", "", 0, group);
 
             continue;
         }
@@ -1472,12 +2011,12 @@ void MainWindow::_uploadDir(const QString &dirPath)
 
         qDebug() << "objectKey:" << objectKey;
 
-        if (_config.skipOlder) _headObject(objectKey, filePath, fileInfo.size());
-        else _addPutObjectTask(objectKey, filePath, fileInfo.size());
+        if (_config.skipOlder) _headObject(objectKey, filePath, fileInfo.size(), group);
+        else _addPutObjectTask(objectKey, filePath, fileInfo.size(), group);
     }
 }
 
-void MainWindow::_insertTask(const QString &action, const QString &name, const QString &size, const QString &status)
+void MainWindow::_insertTask(const QString &action, const QString &name, const QString &size, const QString &status, quint64 id)
 {
     qDebug() << "_insertTask action:" << action << "name:" << name << "size:" << size << "status:" << status;
 
@@ -1487,6 +2026,7 @@ void MainWindow::_insertTask(const QString &action, const QString &name, const Q
 
     QTableWidgetItem *actionItem = new QTableWidgetItem(action);
     actionItem->setTextAlignment(Qt::AlignCenter);
+    actionItem->setData(Qt::UserRole, id);
 
     _taskTable->setItem(rowCount, 0, actionItem);
     _taskTable->setItem(rowCount, 1, new QTableWidgetItem(name));
@@ -1597,31 +2137,16 @@ void MainWindow::_updateProgress(const QString &name, const QString &part, qint6
     }
     else
     {
-        qint64 bytesCompleted = 0;
-        qint64 bytesPart = 0;
-        int partNum = 1;
-
-        while (bytesPart < bytesTotal)
-        {
-            QString partKey = name + "|" + QString::number(partNum);
+        // 分块大小由 Client 按文件选择，这里只累计各分块已发送的字节数
+        QHash<int, qint64> &parts = _uploadPartBytesHash[name];
 
-            qDebug() << "partKey:" << partKey;
+        int partNumber = part.toInt();
 
-            qint64 bytesPartCompleted = _uploadBytesHash[partKey];
+        if (bytesSent > parts.value(partNumber)) parts.insert(partNumber, bytesSent);
 
-            if (part.toInt() == partNum && bytesSent > bytesPartCompleted)
-            {
-                _uploadBytesHash[partKey] = bytesSent;
-                bytesPartCompleted = bytesSent;
-            }
-
-            qDebug() << "bytesPartCompleted:" << bytesPartCompleted;
-
-            bytesCompleted += bytesPartCompleted;
+        qint64 bytesCompleted = 0;
 
-            ++partNum;
-            bytesPart += Client::PartSize;
-        }
+        foreach (qint64 bytes, parts) bytesCompleted += bytes;
 
         qDebug() << "bytesCompleted:" << bytesCompleted;
 
@@ -1636,6 +2161,33 @@ void MainWindow::_updateProgress(const QString &name, const QString &part, qint6
     }
 }
 
+void MainWindow::_updateRetry(const QString &name, int attempt, const QString &tip)
+{
+    _taskReadMutex.lock();
+    QTableWidgetItem *item = _taskItemHash.value(name);
+    _taskReadMutex.unlock();
+
+    if (!item) return;
+
+    // 上传显示在进度条上，其余任务显示在状态中，完成时由 _updateTask 覆盖
+    QProgressBar *progressBar = qobject_cast<QProgressBar*>(_taskTable->cellWidget(item->row(), 3));
+
+    if (progressBar)
+    {
+        progressBar->setFormat(QString("%p% (第 %1 次重试)").arg(attempt));
+        progressBar->setToolTip(tip);
+
+        return;
+    }
+
+    QTableWidgetItem *statusItem = _taskTable->item(item->row(), 3);
+
+    if (!statusItem) return;
+
+    statusItem->setText(QString("第 %1 次重试").arg(attempt));
+    statusItem->setToolTip(tip);
+}
+
 void MainWindow::_updateObject(const QString &objectKey, const QString &name)
 {
     qDebug() << "updateObject objectKey:" << objectKey << "name:" << name;
@@ -1687,24 +2239,9 @@ void MainWindow::_removeObject(const QString &objectKey)
     }
 }
 
-void MainWindow::_removeUpload(const QString &objectKey, const QString &fileSize)
+void MainWindow::_removeUpload(const QString &objectKey)
 {
-    qint64 size = fileSize.toLongLong();
-
-    if (size > Client::PartSize)
-    {
-        qint64 bytes = 0;
-        int partNum = 1;
-
-        while (bytes < size)
-        {
-            _uploadBytesHash.remove(objectKey + "|" + QString::number(partNum));
-
-            ++partNum;
-            bytes += Client::PartSize;
-        }
-    }
-
+    _uploadPartBytesHash.remove(objectKey);
     _uploadBytesHash.remove(objectKey);
 }
 
@@ -1712,12 +2249,13 @@ void MainWindow::_updateTotal()
 {
     _objectCountLabel->setText("文件夹: " + QString::number(_storeDirs.count()) +
                                " 文件: " + QString::number(_storeFiles.count()) +
-                               " 合计: " + QString::number(_storeDirs.count() + _storeFiles.count()));
+                               " 合计: " + QString::number(_storeDirs.count() + _storeFiles.count()) +
+                               (_nextMarker.isEmpty() ? "" : " (滚动加载更多)"));
 }
 
 void MainWindow::_checkWorkDone()
 {
-    if (_workQueue->count() > 0) return;
+    if (_scheduler->runningCount() > 0) return;
 
     _dirActions.clear();
     _transferFiles.clear();
@@ -1730,7 +2268,7 @@ void MainWindow::_checkWorkDone()
 
 void MainWindow::_checkWorkDoneAndReload()
 {
-    if (_workQueue->count() > 0) return;
+    if (_scheduler->runningCount() > 0) return;
 
     _dirActions.clear();
     _transferFiles.clear();
@@ -1880,6 +2418,45 @@ void MainWindow::_changeSkipOlder(bool skipOlder)
     _config.skipOlder = skipOlder;
 }
 
+void MainWindow::_changeRateLimit(qint64 uploadLimit, qint64 downloadLimit)
+{
+    _config.uploadLimit = uploadLimit > 0 ? uploadLimit : 0;
+    _config.downloadLimit = downloadLimit > 0 ? downloadLimit : 0;
+
+    auto limitText = [](qint64 limit) {
+        return limit > 0 ? QString::number(limit) + " KB/s" : QString("不限");
+    };
+
+    _uploadLimitAction->setText("上传限速: " + limitText(_config.uploadLimit));
+    _downloadLimitAction->setText("下载限速: " + limitText(_config.downloadLimit));
+
+    emit setRateLimit(_config.uploadLimit * 1024, _config.downloadLimit * 1024);
+}
+
+void MainWindow::_rateLimitClicked(bool upload)
+{
+    bool okClicked;
+
+    int limit = QInputDialog::getInt(this,
+                                     upload ? "上传限速" : "下载限速",
+                                     "请输入限速（KB/s），0 表示不限速",
+                                     static_cast<int>(upload ? _config.uploadLimit : _config.downloadLimit),
+                                     0,
+                                     1048576,
+                                     100,
+                                     &okClicked,
+                                     Qt::MSWindowsFixedSizeDialogHint);
+
+    if (!okClicked) return;
+
+    if (upload)
+        _changeRateLimit(limit, _config.downloadLimit);
+    else
+        _changeRateLimit(_config.uploadLimit, limit);
+
+    _writeConfigToJSON();
+}
+
 void MainWindow::_changeDomain(const QString &name)
 {
     _currentDomain = name;
@@ -1897,6 +2474,8 @@ void MainWindow::_changeBucket(const QString &bucket)
 
     _listObject(params);
 
+    _resumeJournal();
+
     for (int i = 0; i < _bucketList->layout()->count(); ++i)
     {
         QLayoutItem *item = _bucketList->layout()->itemAt(i);
@@ -2033,7 +2612,19 @@ void MainWindow::_downloadObjectClicked()
             QString filePath = objectKey;
             filePath.replace(filePath.indexOf(pathAtDownload), pathAtDownload.size(), "");
 
-            _addDownloadObjectTask(objectKey, downloadDirPath + filePath);
+            qint64 fileSize = 0;
+
+            foreach (auto file, _storeFiles)
+            {
+                if (file.key == objectKey)
+                {
+                    fileSize = file.size;
+
+                    break;
+                }
+            }
+
+            _addDownloadObjectTask(objectKey, downloadDirPath + filePath, fileSize);
         }
     }
 }
@@ -2538,6 +3129,22 @@ void MainWindow::_sortByColumn(int column)
 
     _setLastSortOrder();
     _resortObjects();
+
+    // 排序需要完整的列表，剩余的页在后台继续加载并按新的顺序插入
+    if (!_nextMarker.isEmpty())
+    {
+        _isListingAll = true;
+
+        _listNextObjects();
+    }
+}
+
+void MainWindow::_objectTableScrolled(int value)
+{
+    QScrollBar *scrollBar = _objectTable->verticalScrollBar();
+
+    // 距离底部不足一屏时加载下一页
+    if (value >= scrollBar->maximum() - scrollBar->pageStep()) _listNextObjects();
 }
 
 void MainWindow::_cellDoubleClicked(int row, int column)
@@ -2640,19 +3247,112 @@ void MainWindow::_showObjectTableMenu(const QPoint &)
     menu = nullptr;
 }
 
+void MainWindow::_showTaskTableMenu(const QPoint &pos)
+{
+    QTableWidgetItem *item = _taskTable->itemAt(pos);
+
+    if (!item) return;
+
+    QTableWidgetItem *actionItem = _taskTable->item(item->row(), 0);
+
+    if (!actionItem) return;
+
+    quint64 id = actionItem->data(Qt::UserRole).toULongLong();
+
+    Task task(Client::getObjectOperation, QVariant());
+
+    if (id == 0 || !_findTask(id, task)) return;
+
+    QMenu *menu = new QMenu(_taskTable);
+
+    if (_pausedTasks.contains(id))
+    {
+        QAction *resumeAction = new QAction("继续");
+        connect(resumeAction, &QAction::triggered, [this, id] {
+            _resumeTasks([id](const Task &t) { return t.id == id; });
+        });
+        menu->addAction(resumeAction);
+    }
+    else
+    {
+        QAction *pauseAction = new QAction("暂停");
+        connect(pauseAction, &QAction::triggered, [this, id] {
+            _stopTasks([id](const Task &t) { return t.id == id; }, true);
+        });
+        menu->addAction(pauseAction);
+    }
+
+    QAction *cancelAction = new QAction("取消");
+    connect(cancelAction, &QAction::triggered, [this, id] {
+        _stopTasks([id](const Task &t) { return t.id == id; }, false);
+    });
+    menu->addAction(cancelAction);
+
+    // 文件夹操作拆出的任务可以整体暂停、继续或取消
+    if (!task.group.isEmpty())
+    {
+        QString group = task.group;
+
+        menu->addSeparator();
+
+        QAction *pauseGroupAction = new QAction("暂停整个文件夹操作");
+        connect(pauseGroupAction, &QAction::triggered, [this, group] {
+            _stopTasks([group](const Task &t) { return t.group == group; }, true);
+        });
+        menu->addAction(pauseGroupAction);
+
+        QAction *resumeGroupAction = new QAction("继续整个文件夹操作");
+        connect(resumeGroupAction, &QAction::triggered, [this, group] {
+            _resumeTasks([group](const Task &t) { return t.group == group; });
+        });
+        menu->addAction(resumeGroupAction);
+
+        QAction *cancelGroupAction = new QAction("取消整个文件夹操作");
+        connect(cancelGroupAction, &QAction::triggered, [this, group] {
+            _stopTasks([group](const Task &t) { return t.group == group; }, false);
+        });
+        menu->addAction(cancelGroupAction);
+    }
+
+    menu->move(cursor().pos());
+    menu->exec();
+
+    menu->deleteLater();
+    menu = nullptr;
+}
+
+void MainWindow::_cancelAllClicked()
+{
+    if (_scheduler->pendingCount() + _scheduler->runningCount() + _pausedTasks.count() == 0) return;
+
+    QMessageBox::StandardButton button = QMessageBox::warning(this,
+                                                              "确认取消",
+                                                              "确定取消全部任务吗？",
+                                                              QMessageBox::Cancel|QMessageBox::Ok,
+                                                              QMessageBox::Cancel);
+
+    if (button != QMessageBox::Ok) return;
+
+    _stopTasks([](const Task &) { return true; }, false);
+}
+
 void MainWindow::_updateTaskCount()
 {
     qDebug() << "enter updateTaskCount";
 
-    int jobCount = _jobQueue->count();
-    int taskCount = _workQueue->count();
+    int jobCount = _scheduler->pendingCount();
+    int taskCount = _scheduler->runningCount();
 
     qDebug() << "jobCount:" << jobCount;
     qDebug() << "taskCount:" << taskCount;
 
     if (taskCount == 0 && _taskTimer->isActive()) _taskTimer->stop();
 
-    _taskCountLabel->setText("当前任务: " + QString::number(jobCount + taskCount));
+    QString text = "当前任务: " + QString::number(jobCount + taskCount);
+
+    if (!_pausedTasks.isEmpty()) text += "（已暂停 " + QString::number(_pausedTasks.count()) + "）";
+
+    _taskCountLabel->setText(text);
 }
 
 void MainWindow::_updateTaskbarProgress()
@@ -2712,6 +3412,8 @@ void MainWindow::_listBucketResponse(QNetworkReply::NetworkError error, const QS
 
         _listObject(params);
 
+        _resumeJournal();
+
         QWidget *parentWidget = _bucketList->parentWidget();
 
         for (int i = 0; i < buckets.length(); ++i)
@@ -2746,6 +3448,14 @@ void MainWindow::_listObjectResponse(QNetworkReply::NetworkError error,
 
     if (error != QNetworkReply::NoError)
     {
+        if (!_dirActions.contains(params["prefix"]))
+        {
+            _isListing = false;
+            _isListingAll = false;
+
+            _refreshButton->setEnabled(true);
+        }
+
         _dirActions.remove(params["prefix"]);
         _transferFiles.remove(params["prefix"]);
 
@@ -2764,71 +3474,88 @@ void MainWindow::_listObjectResponse(QNetworkReply::NetworkError error,
 
     if (ci == _dirActions.end())
     {
-        _storeDirs += dirs;
-        _storeDirs.removeOne(_paths.last());
-        _storeFiles += files;
-    }
-    else
-    {
-        QHash<QString, QVector<File>>::iterator fi = _transferFiles.find(params["prefix"]);
+        _showObjectPage(params, dirs, files);
 
-        if (fi == _transferFiles.end()) _transferFiles.insert(params["prefix"], files);
-        else fi.value() += files;
+        return;
     }
 
+    QHash<QString, QVector<File>>::iterator fi = _transferFiles.find(params["prefix"]);
+
+    if (fi == _transferFiles.end()) _transferFiles.insert(params["prefix"], files);
+    else fi.value() += files;
+
+    // 目录操作需要完整的对象列表，一次取完
     if (params["isTruncated"] == "true")
     {
-        ListObjectParams listParams(params["prefix"], params["nextMarker"]);
-
-        if (ci != _dirActions.end()) listParams.delimiter = "";
+        ListObjectParams listParams(params["prefix"], params["nextMarker"], "");
 
         _listObject(listParams);
 
         return;
     }
 
-    if (ci != _dirActions.end())
-    {
-        DirAction dirAction = ci.value();
+    DirAction dirAction = ci.value();
 
-        qDebug() << "files:" << _transferFiles[params["prefix"]];
+    qDebug() << "files:" << _transferFiles[params["prefix"]];
 
-        QString prefix;
+    QString prefix;
 
-        if (dirAction.dirMode == moveDir || dirAction.dirMode == copyDir) prefix = params["prefix"];
-        if (dirAction.dirMode == downloadDir) prefix = dirAction.dirOptions["pathAtDownload"];
+    if (dirAction.dirMode == moveDir || dirAction.dirMode == copyDir) prefix = params["prefix"];
+    if (dirAction.dirMode == downloadDir) prefix = dirAction.dirOptions["pathAtDownload"];
 
-        foreach (auto file, _transferFiles[params["prefix"]])
-        {
-            QString objectKey = file.key;
-            QString filePath = objectKey.replace(objectKey.indexOf(prefix), prefix.size(), "");
+    foreach (auto file, _transferFiles[params["prefix"]])
+    {
+        QString objectKey = file.key;
+        QString filePath = objectKey.replace(objectKey.indexOf(prefix), prefix.size(), "");
 
-            switch (dirAction.dirMode)
-            {
-            case deleteDir:
-//                qDebug() << "DELETE:" << file.key;
-                _addDeleteObjectTask(file.key);
-                break;
-            case moveDir:
-//                qDebug() << "MOVE:" << file.key << " => " << dirAction.dirOptions["transferDirPath"] + filePath;
-                _addMoveObjectTask(file.key, dirAction.dirOptions["transferDirPath"] + filePath);
-                break;
-            case copyDir:
-//                qDebug() << "COPY:" << file.key << " => " << dirAction.dirOptions["transferDirPath"] + filePath;
-                _addCopyObjectTask(file.key, dirAction.dirOptions["transferDirPath"] + filePath);
-                break;
-            case downloadDir:
-//                qDebug() << "DOWNLOAD:" << file.key << " => " << dirAction.dirOptions["downloadDirPath"] + filePath;
-                _addDownloadObjectTask(file.key, dirAction.dirOptions["downloadDirPath"] + filePath);
-                break;
-            }
+        switch (dirAction.dirMode)
+        {
+        case deleteDir:
+//            qDebug() << "DELETE:" << file.key;
+            _addDeleteObjectTask(file.key, params["prefix"]);
+            break;
+        case moveDir:
+//            qDebug() << "MOVE:" << file.key << " => " << dirAction.dirOptions["transferDirPath"] + filePath;
+            _addMoveObjectTask(file.key, dirAction.dirOptions["transferDirPath"] + filePath, params["prefix"]);
+            break;
+        case copyDir:
+//            qDebug() << "COPY:" << file.key << " => " << dirAction.dirOptions["transferDirPath"] + filePath;
+            _addCopyObjectTask(file.key, dirAction.dirOptions["transferDirPath"] + filePath, params["prefix"]);
+            break;
+        case downloadDir:
+//            qDebug() << "DOWNLOAD:" << file.key << " => " << dirAction.dirOptions["downloadDirPath"] + filePath;
+            _addDownloadObjectTask(file.key, dirAction.dirOptions["downloadDirPath"] + filePath, file.size, params["prefix"]);
+            break;
         }
+    }
+
+    _isReady = true;
+}
+
+// 当前目录的一页：第一页直接显示，之后的页插入到已显示的列表中
+void MainWindow::_showObjectPage(const QStringHash &params, const QStringVector &dirs, const QVector<File> &files)
+{
+    // 忽略已切换的目录或刷新前发出的请求
+    if (!_isListing || params["prefix"] != _paths.last() || params["marker"] != _listingMarker) return;
+
+    _isListing = false;
+    _nextMarker = params["isTruncated"] == "true" ? params["nextMarker"] : "";
+
+    if (!params["marker"].isEmpty())
+    {
+        _insertObjects(dirs, files);
+        _updateTotal();
 
-        _isReady = true;
+        if (_isListingAll) _listNextObjects();
+        else _objectTableScrolled(_objectTable->verticalScrollBar()->value());
 
         return;
     }
 
+    _storeDirs = dirs;
+    _storeDirs.removeOne(_paths.last());
+    _storeFiles = files;
+
     _resortObjects();
 
     int dirCount = _storeDirs.count();
@@ -2850,16 +3577,23 @@ void MainWindow::_listObjectResponse(QNetworkReply::NetworkError error,
     _refreshButton->setEnabled(true);
 
     _updateTotal();
+
+    // 第一页不足一屏时直接加载下一页
+    _objectTableScrolled(_objectTable->verticalScrollBar()->value());
 }
 
-void MainWindow::_getObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params, const QByteArray &data)
+void MainWindow::_getObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params, qint64 bytesReceived)
 {
     qDebug() << "receive getObjectResponse";
     qDebug() << "params:" << params;
+    qDebug() << "bytesReceived:" << bytesReceived;
 
     QString taskName = params["objectKey"];
     QString filePath = params["filePath"];
 
+    // 已取消或暂停的任务不再处理结果，暂停后马上继续时旧请求的中止结果也要忽略
+    if (error == QNetworkReply::OperationCanceledError || !_finishTask(taskName)) return;
+
     QString msg = "NOS " + params["objectKey"] + " => 本地 " + filePath;
 
     if (error != QNetworkReply::NoError && !taskName.endsWith("/"))
@@ -2870,46 +3604,6 @@ void MainWindow::_getObjectResponse(QNetworkReply::NetworkError error, const QSt
     }
     else
     {
-        QStringList filePaths = filePath.split("/");
-        filePaths.pop_back();
-
-        qDebug() << "filePaths:" << filePaths;
-
-        QString dirPath = filePaths.join("/");
-        QDir dir(dirPath);
-
-        qDebug() << "dirPath:" << dirPath;
-
-        if (!dir.exists())
-        {
-            bool isOK = dir.mkpath(dirPath);
-
-            if (!isOK)
-            {
-                _updateTask("下载", taskName, "失败");
-
-                _log(Client::getObjectOperation, failure, "创建文件夹 " + dirPath + " 失败");
-
-                ++_doneTaskCount;
-
-                _workQueue->pop();
-
-                _perform();
-
-                _checkWorkDone();
-
-                return;
-            }
-        }
-
-        QFile file(filePath);
-
-        if (file.open(QIODevice::WriteOnly))
-        {
-            file.write(data);
-            file.close();
-        }
-
         _removeTask(taskName);
 
         _log(Client::getObjectOperation, success, msg);
@@ -2923,8 +3617,6 @@ void MainWindow::_getObjectResponse(QNetworkReply::NetworkError error, const QSt
 
     ++_doneTaskCount;
 
-    _workQueue->pop();
-
     _perform();
 
     _checkWorkDone();
@@ -2937,9 +3629,13 @@ void MainWindow::_headObjectResponse(QNetworkReply::NetworkError error, const QS
     qDebug() << "headers:" << headers;
 
     QString objectKey = params["objectKey"];
+    QString group = _headGroups.take(objectKey);
+    quint64 journalId = _headJournalIds.take(objectKey);
 
     if (error != QNetworkReply::NoError && error != QNetworkReply::ContentNotFoundError)
     {
+        _taskJournal->finish(journalId);
+
         QMessageBox::warning(this, "警告", "获取 " + objectKey + " 信息失败");
 
         return;
@@ -2952,9 +3648,12 @@ void MainWindow::_headObjectResponse(QNetworkReply::NetworkError error, const QS
 
     QString lastModified = headers["Last-Modified"];
 
+    // 先记下上传任务再结束查询，中途退出时不会漏掉
     if (lastModified.isEmpty())
     {
-        _addPutObjectTask(objectKey, filePath, fileSize);
+        _addPutObjectTask(objectKey, filePath, fileSize, group);
+
+        _taskJournal->finish(journalId);
 
         return;
     }
@@ -2973,9 +3672,11 @@ void MainWindow::_headObjectResponse(QNetworkReply::NetworkError error, const QS
     uint nosTime = nosUploaded.toTime_t();
 
     if (localTime > nosTime)
-        _addPutObjectTask(objectKey, filePath, fileSize);
+        _addPutObjectTask(objectKey, filePath, fileSize, group);
     else
         _log(Client::headObjectOperation, success, "本地 " + filePath + " => NOS " + objectKey);
+
+    _taskJournal->finish(journalId);
 }
 
 void MainWindow::_putObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params, const QStringHash &headers)
@@ -2987,7 +3688,9 @@ void MainWindow::_putObjectResponse(QNetworkReply::NetworkError error, const QSt
 
     QString objectKey = params["objectKey"];
     QString filePath = params["filePath"];
-    QString fileSize = params["fileSize"];
+
+    // 已取消或暂停的任务不再处理结果，暂停后马上继续时旧请求的中止结果也要忽略
+    if (error == QNetworkReply::OperationCanceledError || !_finishTask(objectKey)) return;
 
     QString msg = filePath.isEmpty() ? "NOS " + objectKey : "本地 " + filePath + " => NOS " + objectKey;
 
@@ -3002,12 +3705,10 @@ void MainWindow::_putObjectResponse(QNetworkReply::NetworkError error, const QSt
         _log(Client::putObjectOperation, success, msg);
     }
 
-    _removeUpload(objectKey, fileSize);
+    _removeUpload(objectKey);
 
     ++_doneTaskCount;
 
-    _workQueue->pop();
-
     _perform();
 
     _checkWorkDoneAndReload();
@@ -3018,6 +3719,10 @@ void MainWindow::_deleteObjectResponse(QNetworkReply::NetworkError error, const
     qDebug() << "receive deleteObjectResponse";
 
     QString objectKey = params["objectKey"];
+
+    // 已取消或暂停的任务不再处理结果，暂停后马上继续时旧请求的中止结果也要忽略
+    if (error == QNetworkReply::OperationCanceledError || !_finishTask(objectKey)) return;
+
     QString msg = "NOS " + objectKey;
 
     if (error != QNetworkReply::NoError)
@@ -3041,8 +3746,6 @@ void MainWindow::_deleteObjectResponse(QNetworkReply::NetworkError error, const
 
     ++_doneTaskCount;
 
-    _workQueue->pop();
-
     _perform();
 
     _objectTable->setCurrentItem(nullptr);
@@ -3058,6 +3761,10 @@ void MainWindow::_copyObjectResponse(QNetworkReply::NetworkError error, const QS
     QString sourceObjectKey = params["sourceObjectKey"];
     QString destinationObjectKey = params["destinationObjectKey"];
     QString taskName = sourceObjectKey + " => " + destinationObjectKey;
+
+    // 已取消或暂停的任务不再处理结果，暂停后马上继续时旧请求的中止结果也要忽略
+    if (error == QNetworkReply::OperationCanceledError || !_finishTask(taskName)) return;
+
     QString msg = "NOS " + sourceObjectKey + " => NOS " + destinationObjectKey;
 
     if (error != QNetworkReply::NoError)
@@ -3079,8 +3786,6 @@ void MainWindow::_copyObjectResponse(QNetworkReply::NetworkError error, const QS
 
     ++_doneTaskCount;
 
-    _workQueue->pop();
-
     _perform();
 
     _checkWorkDone();
@@ -3094,6 +3799,10 @@ void MainWindow::_moveObjectResponse(QNetworkReply::NetworkError error, const QS
     QString sourceObjectKey = params["sourceObjectKey"];
     QString destinationObjectKey = params["destinationObjectKey"];
     QString taskName = sourceObjectKey + " => " + destinationObjectKey;
+
+    // 已取消或暂停的任务不再处理结果，暂停后马上继续时旧请求的中止结果也要忽略
+    if (error == QNetworkReply::OperationCanceledError || !_finishTask(taskName)) return;
+
     QString msg = "NOS " + sourceObjectKey + " => NOS " + destinationObjectKey;
 
     if (error != QNetworkReply::NoError)
@@ -3133,30 +3842,50 @@ void MainWindow::_moveObjectResponse(QNetworkReply::NetworkError error, const QS
 
     ++_doneTaskCount;
 
-    _workQueue->pop();
-
     _perform();
 
     _checkWorkDone();
 }
 
-void MainWindow::_updateProgressResponse(Client::Operation operation,
-                                         const QStringHash &params,
-                                         const QStringHash &extras,
-                                         qint64 bytesSent)
+void MainWindow::_updateProgressResponse(Client::Operation operation, const RequestContext &context, qint64 bytesSent)
 {
     qDebug() << "receive updateProgress";
     qDebug() << "operation:" << operation;
-    qDebug() << "params:" << params;
-    qDebug() << "extras:" << extras;
+    qDebug() << "objectKey:" << context.objectKey << "partNumber:" << context.partNumber;
     qDebug() << "bytesSent:" << bytesSent;
 
     if (operation != Client::putObjectOperation && operation != Client::uploadPartOperation) return;
     if (bytesSent == 0) return;
 
-    QString part = operation == Client::uploadPartOperation ? extras["part"] : "";
+    QString part = operation == Client::uploadPartOperation ? QString::number(context.partNumber) : "";
+
+    _updateProgress(context.objectKey, part, bytesSent, context.fileSize);
+}
+
+void MainWindow::_retryResponse(Client::Operation operation, const RequestContext &context, const QString &reason, qint64 delay)
+{
+    qDebug() << "receive retryResponse operation:" << operation << "attempt:" << context.attempt << "reason:" << reason << "delay:" << delay;
+
+    QString name = _taskName(context);
+
+    if (name.isEmpty()) return;
+
+    QString tip = QString("%1，%2 秒后重试").arg(reason).arg(delay / 1000.0, 0, 'f', 1);
+
+    if (operation == Client::uploadPartOperation) tip = QString("分块 %1 ").arg(context.partNumber) + tip;
+
+    _updateRetry(name, context.attempt, tip);
+}
+
+void MainWindow::_stallResponse(Client::Operation operation, const RequestContext &context, const QString &reason, int stallCount)
+{
+    qDebug() << "receive stallResponse operation:" << operation << "reason:" << reason << "stallCount:" << stallCount;
+
+    QString name = _taskName(context);
 
-    _updateProgress(params["objectKey"], part, bytesSent, extras["fileSize"].toLongLong());
+    _stallLabel->setText("停滞: " + QString::number(stallCount));
+    _stallLabel->setToolTip(name.isEmpty() ? reason : "最近一次: " + name + "，" + reason);
+    _stallLabel->show();
 }
 
 // CDN
@@ -3196,6 +3925,19 @@ void MainWindow::_purgeResponse(QNetworkReply::NetworkError error, const QString
     QMessageBox::information(this, "提示", "创建缓存刷新请求成功！ID: " + id);
 }
 
+void MainWindow::_concurrencyChanged(int limit, const QString &reason)
+{
+    qDebug() << "receive concurrencyChanged limit:" << limit << "reason:" << reason;
+
+    // 同时进行的任务数跟随 Client 的并发上限
+    _scheduler->setCapacity(limit);
+
+    _concurrencyLabel->setText("并发: " + QString::number(limit));
+    _concurrencyLabel->setToolTip(reason);
+
+    _perform();
+}
+
 void MainWindow::_errorResponse(const QString &message)
 {
 //    qDebug() << "receive errorResponse";
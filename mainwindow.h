@@ -3,6 +3,8 @@
 
 #include <QMainWindow>
 
+#include <functional>
+
 QT_BEGIN_NAMESPACE
 class QString;
 class QStringList;
@@ -33,6 +35,7 @@ QT_END_NAMESPACE
 
 #include "client.h"
 #include "cdn.h"
+#include "taskjournal.h"
 
 #include "account.h"
 #include "config.h"
@@ -62,6 +65,8 @@ signals:
     void moveObject(const MoveObjectParams &params);
     void listDomain(const ListDomainParams &params);
     void purge(const PurgeParams &params);
+    void setRateLimit(qint64 uploadRate, qint64 downloadRate);
+    void cancelObject(const CancelObjectParams &params);
 
 protected:
     void keyPressEvent(QKeyEvent *event) override;
@@ -90,8 +95,12 @@ private:
     {
         Client::Operation operation;
         QVariant params;
+        quint64 id;         // 加入队列时分配
+        QString group;      // 所属的文件夹操作，单个文件为空
+        quint64 journalId;  // 任务日志中的记录，加入队列时分配
 
-        task(Client::Operation pOperation, const QVariant &pParams) : operation(pOperation), params(pParams) {}
+        task(Client::Operation pOperation, const QVariant &pParams, const QString &pGroup = "") :
+            operation(pOperation), params(pParams), id(0), group(pGroup), journalId(0) {}
     } Task;
 
     typedef struct dirAction
@@ -114,21 +123,35 @@ private:
     Account _currentAccount;
     Account _emptyAccount; // 重置 _currentAccount 时使用
 
-    JobQueue<Task> *_jobQueue;
-    WorkerQueue<Task> *_workQueue;
+    LaneScheduler<Task> *_scheduler;
+    TaskJournal *_taskJournal;
+
+    // 进行中的任务以任务名区分，暂停的任务按加入顺序保存
+    quint64 _lastTaskId = 0;
+    QHash<QString, Task> _runningTasks;
+    QMap<quint64, Task> _pausedTasks;
 
     // Data
     QStringList _paths = { "" };
     QStringVector _storeDirs;
 
     QVector<File> _storeFiles;
+
+    // 当前目录分页加载：_nextMarker 为空表示已全部加载，_listingMarker 为请求中的页
+    QString _nextMarker;
+    QString _listingMarker;
+    bool _isListing = false;
+    bool _isListingAll = false;
     QVector<Domain> _domains;
 
     QHash<QString, QTableWidgetItem*> _objectItemHash;
     QHash<QString, QTableWidgetItem*> _taskItemHash;
     QHash<QString, qint64> _uploadBytesHash;
+    QHash<QString, QHash<int, qint64>> _uploadPartBytesHash;
     QHash<QString, DirAction> _dirActions;
     QHash<QString, QVector<File>> _transferFiles;
+    QHash<QString, QString> _headGroups;
+    QHash<QString, quint64> _headJournalIds;
 
     QMutex _objectReadMutex;
     QMutex _objectWriteMutex;
@@ -165,6 +188,7 @@ private:
 
     QMenu *_accountMenu;
     QMenu *_cdnMenu;
+    QMenu *_transferMenu;
     QMenu *_helpMenu;
 
     QActionGroup *_accountGroup;
@@ -178,6 +202,11 @@ private:
     QAction *_skipAction;
     QAction *_listDomainAction;
     QAction *_listCacheAction;
+    QAction *_uploadLimitAction;
+    QAction *_downloadLimitAction;
+    QAction *_pauseAllAction;
+    QAction *_resumeAllAction;
+    QAction *_cancelAllAction;
     QAction *_aboutAction;
 
     QPushButton *_uploadFileButton;
@@ -189,6 +218,8 @@ private:
 
     QLabel *_objectCountLabel;
     QLabel *_taskCountLabel;
+    QLabel *_concurrencyLabel;
+    QLabel *_stallLabel;
 
     QWinTaskbarButton *_winTaskbarButton;
     QWinTaskbarProgress *_winTaskbarProgress;
@@ -215,28 +246,50 @@ private:
     void _resortObjects();
     void _sortDirs(QStringVector &dirs);
     void _sortFiles(QVector<File> &files);
+    bool _dirLessThan(const QString &dir1, const QString &dir2) const;
+    bool _fileLessThan(const File &file1, const File &file2) const;
     void _listDirs(int startRow, int totalRowCount);
     void _listFiles(int startRow, int totalRowCount);
+    void _setDirRow(int row, const QString &dir);
+    void _setFileRow(int row, const File &file);
+    void _insertObjects(const QStringVector &dirs, const QVector<File> &files);
+    void _showObjectPage(const QStringHash &params, const QStringVector &dirs, const QVector<File> &files);
 
     void _listBucket();
     void _listObject(const ListObjectParams &params);
     void _listCurrentObject();
-
-    void _headObject(const QString &objectKey, const QString &filePath, qint64 fileSize);
-
-    void _addPutObjectTask(const QString &objectKey, const QString &filePath, qint64 fileSize = 0);
+    void _listNextObjects();
+
+    void _headObject(const QString &objectKey, const QString &filePath, qint64 fileSize, const QString &group = "", quint64 journalId = 0);
+
+    void _enqueueTask(Task &task);
+    void _stopTasks(const std::function<bool(const Task&)> &match, bool pause);
+    void _resumeTasks(const std::function<bool(const Task&)> &match);
+    bool _finishTask(const QString &name);
+    bool _findTask(quint64 id, Task &task) const;
+    int _taskRow(quint64 id) const;
+    static QString _taskName(const Task &task);
+    static QString _taskName(const RequestContext &context);
+    static QString _taskAction(const Task &task);
+    static CancelObjectParams _cancelParams(const Task &task, bool pause);
+    TaskRecord _taskRecord(Client::Operation operation, const QStringHash &params, const QString &group) const;
+    static QStringHash _journalParams(const Task &task);
+    static QVariant _taskParams(const TaskRecord &record);
+    void _resumeJournal();
+
+    void _addPutObjectTask(const QString &objectKey, const QString &filePath, qint64 fileSize = 0, const QString &group = "");
     void _putObject(const Task &task);
 
-    void _addDownloadObjectTask(const QString &objectKey, const QString &filePath);
+    void _addDownloadObjectTask(const QString &objectKey, const QString &filePath, qint64 fileSize = 0, const QString &group = "");
     void _downloadObject(const Task &task);
 
-    void _addDeleteObjectTask(const QString &objectKey);
+    void _addDeleteObjectTask(const QString &objectKey, const QString &group = "");
     void _deleteObject(const Task &task);
 
-    void _addCopyObjectTask(const QString &sourceObjectKey, const QString &destinationObjectKey);
+    void _addCopyObjectTask(const QString &sourceObjectKey, const QString &destinationObjectKey, const QString &group = "");
     void _copyObject(const Task &task);
 
-    void _addMoveObjectTask(const QString &sourceObjectKey, const QString &destinationObjectKey);
+    void _addMoveObjectTask(const QString &sourceObjectKey, const QString &destinationObjectKey, const QString &group = "");
     void _moveObject(const Task &task);
 
     void _listDomain();
@@ -244,13 +297,14 @@ private:
 
     void _uploadDir(const QString &dirPath);
 
-    void _insertTask(const QString &action, const QString &name, const QString &size, const QString &status);
+    void _insertTask(const QString &action, const QString &name, const QString &size, const QString &status, quint64 id = 0);
     void _updateTask(const QString &action, const QString &name, const QString &status);
     void _removeTask(const QString &name);
     void _updateProgress(const QString &name, const QString &part, qint64 bytesSent, qint64 bytesTotal);
+    void _updateRetry(const QString &name, int attempt, const QString &tip);
     void _updateObject(const QString &objectKey, const QString &name);
     void _removeObject(const QString &objectKey);
-    void _removeUpload(const QString &objectKey, const QString &fileSize);
+    void _removeUpload(const QString &objectKey);
     void _updateTotal();
     void _checkWorkDone();
     void _checkWorkDoneAndReload();
@@ -260,6 +314,8 @@ private slots:
     void _changeAccount(const QString &name);
     void _deleteAccount();
     void _changeSkipOlder(bool skipOlder);
+    void _changeRateLimit(qint64 uploadLimit, qint64 downloadLimit);
+    void _rateLimitClicked(bool upload);
     void _changeDomain(const QString &name);
     void _changeBucket(const QString &bucket);
     void _uploadFileClicked();
@@ -281,7 +337,10 @@ private slots:
     void _pathClicked(int index);
     void _sortByColumn(int column);
     void _cellDoubleClicked(int row, int column);
+    void _objectTableScrolled(int value);
     void _showObjectTableMenu(const QPoint &pos);
+    void _showTaskTableMenu(const QPoint &pos);
+    void _cancelAllClicked();
     void _updateTaskCount();
     void _updateTaskbarProgress();
 
@@ -291,20 +350,24 @@ private slots:
                              const QStringHash &params,
                              const QStringVector &dirs,
                              const QVector<File> &files);
-    void _getObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params, const QByteArray &data);
+    void _getObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params, qint64 bytesReceived);
     void _headObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params, const QStringHash &headers);
     void _putObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params, const QStringHash &headers);
     void _deleteObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params);
     void _copyObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params);
     void _moveObjectResponse(QNetworkReply::NetworkError error, const QStringHash &params);
 
-    void _updateProgressResponse(Client::Operation operation, const QStringHash &params, const QStringHash &extras, qint64 bytesSent);
+    void _updateProgressResponse(Client::Operation operation, const RequestContext &context, qint64 bytesSent);
+    void _retryResponse(Client::Operation operation, const RequestContext &context, const QString &reason, qint64 delay);
+    void _stallResponse(Client::Operation operation, const RequestContext &context, const QString &reason, int stallCount);
 
     // CDN
     void _listDomainResponse(QNetworkReply::NetworkError error, bool isTruncated, int quantity, const QVector<Domain> &domains);
     void _purgeResponse(QNetworkReply::NetworkError error, const QString &id);
 
     void _errorResponse(const QString &message);
+
+    void _concurrencyChanged(int limit, const QString &reason);
 };
 
 #endif // MAINWINDOW_H
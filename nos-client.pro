@@ -1,4 +1,4 @@
-QT       += core xml
+QT       += core concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -39,29 +39,45 @@ SOURCES += \
     accountwindow.cpp \
     cdn.cpp \
     client.cpp \
+    concurrencycontroller.cpp \
+    downloadcheckpoint.cpp \
+    fileslicedevice.cpp \
     logger.cpp \
     main.cpp \
     mainwindow.cpp \
     otablewidget.cpp \
+    percentencoder.cpp \
+    ratelimiter.cpp \
     refreshwindow.cpp \
-    transferwindow.cpp
+    signer.cpp \
+    taskjournal.cpp \
+    transferwindow.cpp \
+    uploadjournal.cpp
 
 HEADERS += \
     account.h \
     accountwindow.h \
+    blockingqueue.h \
     cdn.h \
     client.h \
+    concurrencycontroller.h \
     config.h \
-    jobqueue.h \
+    downloadcheckpoint.h \
+    fileslicedevice.h \
+    lanescheduler.h \
     logger.h \
     mainwindow.h \
     otablewidget.h \
+    percentencoder.h \
     qstringhash.h \
     qstringmap.h \
     qstringvector.h \
+    ratelimiter.h \
     refreshwindow.h \
+    signer.h \
+    taskjournal.h \
     transferwindow.h \
-    workerqueue.h
+    uploadjournal.h
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
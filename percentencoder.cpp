@@ -0,0 +1,82 @@
+#include "percentencoder.h"
+
+#include <QByteArray>
+
+static const char HexDigits[] = "0123456789ABCDEF";
+
+// ASCII 字符是否原样保留：1 为字母、数字和 -._，2 为 ~
+static const unsigned char Unreserved[128] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0,     //  !"#$%&'()*+,-./
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,     // 0-9
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // @A-O
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1,     // P-Z _
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // a-o
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 2, 0      // p-z ~
+};
+
+static inline void appendEscaped(QChar *&out, unsigned char c)
+{
+    *out++ = QLatin1Char('%');
+    *out++ = QLatin1Char(HexDigits[c >> 4]);
+    *out++ = QLatin1Char(HexDigits[c & 0x0F]);
+}
+
+// Public Methods
+QString PercentEncoder::encode(const QString &text)
+{
+    QByteArray utf8 = text.toUtf8();
+
+    // 每个字节最多变为 3 个字符，先按最大长度分配，写完后截断
+    QString result(utf8.size() * 3, Qt::Uninitialized);
+    QChar *out = result.data();
+
+    for (int i = 0; i < utf8.size(); ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(utf8.at(i));
+
+        if (c < 128 && Unreserved[c]) *out++ = QLatin1Char(static_cast<char>(c));
+        else appendEscaped(out, c);
+    }
+
+    result.truncate(static_cast<int>(out - result.constData()));
+
+    return result;
+}
+
+void PercentEncoder::encodeObjectKey(const QString &objectKey, QString &url, QString &resource)
+{
+    QByteArray utf8 = objectKey.toUtf8();
+
+    url = QString(utf8.size() * 3, Qt::Uninitialized);
+    resource = QString(utf8.size() * 3, Qt::Uninitialized);
+
+    QChar *urlOut = url.data();
+    QChar *resourceOut = resource.data();
+
+    for (int i = 0; i < utf8.size(); ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(utf8.at(i));
+
+        if (c < 128 && Unreserved[c] == 1)
+        {
+            *urlOut++ = QLatin1Char(static_cast<char>(c));
+            *resourceOut++ = QLatin1Char(static_cast<char>(c));
+        }
+        else if (c == '/')
+        {
+            *urlOut++ = QLatin1Char('/');
+
+            appendEscaped(resourceOut, c);
+        }
+        else
+        {
+            appendEscaped(urlOut, c);
+            appendEscaped(resourceOut, c);
+        }
+    }
+
+    url.truncate(static_cast<int>(urlOut - url.constData()));
+    resource.truncate(static_cast<int>(resourceOut - resource.constData()));
+}
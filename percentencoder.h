@@ -0,0 +1,17 @@
+#ifndef PERCENTENCODER_H
+#define PERCENTENCODER_H
+
+#include <QString>
+
+// 查表实现的百分号编码，与 QUrl::toPercentEncoding 一样按 UTF-8 编码、使用大写十六进制
+class PercentEncoder
+{
+public:
+    // 保留字母、数字和 -._~，与 QUrl::toPercentEncoding 的默认行为相同
+    static QString encode(const QString &text);
+
+    // 对象名一次遍历同时得到两种形式：URL 中使用的保留 /，签名使用的把 / 编码为 %2F；两者都把 ~ 编码为 %7E
+    static void encodeObjectKey(const QString &objectKey, QString &url, QString &resource);
+};
+
+#endif // PERCENTENCODER_H
@@ -0,0 +1,85 @@
+#include "ratelimiter.h"
+
+#include <QMutexLocker>
+
+// 令牌不足时最短的等待时间，避免过于频繁的定时器
+static const qint64 MinDelay = 10;
+
+// Constructor
+RateLimiter::RateLimiter(qint64 rate) : _rate(0), _capacity(0), _tokens(0)
+{
+    _timer.start();
+
+    setRate(rate);
+}
+
+// Public Methods
+void RateLimiter::setRate(qint64 rate)
+{
+    QMutexLocker locker(&_mutex);
+
+    _refill();
+
+    _rate = rate > 0 ? rate : 0;
+
+    // 允许约 2 秒的突发
+    _capacity = _rate * 2;
+
+    if (_capacity < MinBurst) _capacity = MinBurst;
+
+    // 调整后桶是满的，新的限速立即生效但不打断正在进行的小传输
+    _tokens = _capacity;
+}
+
+qint64 RateLimiter::rate() const
+{
+    QMutexLocker locker(&_mutex);
+
+    return _rate;
+}
+
+qint64 RateLimiter::take(qint64 bytes)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (_rate == 0) return bytes;
+
+    _refill();
+
+    qint64 granted = static_cast<qint64>(_tokens);
+
+    if (granted > bytes) granted = bytes;
+
+    _tokens -= granted;
+
+    return granted;
+}
+
+qint64 RateLimiter::delay(qint64 bytes)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (_rate == 0) return 0;
+
+    _refill();
+
+    if (bytes > _capacity) bytes = _capacity;
+
+    double missing = bytes - _tokens;
+
+    qint64 ms = missing > 0 ? static_cast<qint64>(missing * 1000 / _rate) + 1 : 0;
+
+    return ms < MinDelay ? MinDelay : ms;
+}
+
+// Private Methods
+void RateLimiter::_refill()
+{
+    qint64 elapsed = _timer.restart();
+
+    if (_rate == 0) return;
+
+    _tokens += static_cast<double>(_rate) * elapsed / 1000;
+
+    if (_tokens > _capacity) _tokens = _capacity;
+}
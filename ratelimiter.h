@@ -0,0 +1,34 @@
+#ifndef RATELIMITER_H
+#define RATELIMITER_H
+
+#include <QtGlobal>
+#include <QElapsedTimer>
+#include <QMutex>
+
+// 令牌桶限速，rate 为每秒字节数，0 表示不限速
+// 桶容量至少为 MinBurst，空闲后的小文件可以不受限速一次传完
+// 可被多个线程同时使用
+class RateLimiter
+{
+public:
+    static const qint64 MinBurst = 4194304; // 4M
+
+    explicit RateLimiter(qint64 rate = 0);
+
+    void setRate(qint64 rate);
+    qint64 rate() const;
+
+    qint64 take(qint64 bytes);
+    qint64 delay(qint64 bytes);
+
+private:
+    qint64 _rate;
+    qint64 _capacity;
+    double _tokens;
+    QElapsedTimer _timer;
+    mutable QMutex _mutex;
+
+    void _refill();
+};
+
+#endif // RATELIMITER_H
@@ -0,0 +1,66 @@
+#include "signer.h"
+
+#include <QMessageAuthenticationCode>
+
+// Public Methods
+// 把除 excludedKeys 以外的参数拼成查询字符串，其中属于 subResourceKeys 的部分同时参与签名
+void Signer::splitQuery(const QStringHash &resources,
+                        const QStringList &excludedKeys,
+                        const QStringList &subResourceKeys,
+                        QString &subResources,
+                        QString &query)
+{
+    subResources.clear();
+    query.clear();
+
+    QStringMap params;
+
+    for (QStringHash::const_iterator rci = resources.cbegin(); rci != resources.cend(); ++rci)
+    {
+        if (!excludedKeys.contains(rci.key())) params.insert(rci.key(), rci.value());
+    }
+
+    for (QStringMap::const_iterator pci = params.cbegin(); pci != params.cend(); ++pci)
+    {
+        QString subQuery = pci.key();
+
+        if (!pci.value().isEmpty()) subQuery += "=" + pci.value();
+
+        if (!query.isEmpty()) query += "&";
+
+        query += subQuery;
+
+        if (!subResourceKeys.contains(pci.key())) continue;
+
+        if (!subResources.isEmpty()) subResources += "&";
+
+        subResources += subQuery;
+    }
+}
+
+void Signer::canonicalString(QByteArray &out,
+                             const QString &method,
+                             const QByteArray &contentMd5,
+                             const QString &contentType,
+                             const QByteArray &date,
+                             const QStringMap &headers,
+                             const QString &resource)
+{
+    // 调用方可传入预留了容量的缓冲区重复使用
+    out.truncate(0);
+
+    out.append(method.toLatin1()).append('\n');
+    out.append(contentMd5).append('\n');
+    out.append(contentType.toUtf8()).append('\n');
+    out.append(date).append('\n');
+
+    for (QStringMap::const_iterator hci = headers.cbegin(); hci != headers.cend(); ++hci)
+        out.append(hci.key().toUtf8()).append(':').append(hci.value().toUtf8()).append('\n');
+
+    out.append(resource.toUtf8());
+}
+
+QByteArray Signer::signature(const QByteArray &canonicalString, const QByteArray &secretKey)
+{
+    return QMessageAuthenticationCode::hash(canonicalString, secretKey, QCryptographicHash::Sha256).toBase64();
+}
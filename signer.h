@@ -0,0 +1,37 @@
+#ifndef SIGNER_H
+#define SIGNER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMap>
+
+#include "qstringhash.h"
+#include "qstringmap.h"
+
+// NOS 与 NCDN 共用的请求签名，结果只取决于传入的参数
+// 待签名字符串为：
+//   Method\nContent-MD5\nContent-Type\nDate\n[name:value\n ...]Resource[?subResource&...]
+// 其中自定义头按名称排序；查询参数和子资源同样按名称排序，值为空时只保留名称
+class Signer
+{
+public:
+    static void splitQuery(const QStringHash &resources,
+                           const QStringList &excludedKeys,
+                           const QStringList &subResourceKeys,
+                           QString &subResources,
+                           QString &query);
+
+    static void canonicalString(QByteArray &out,
+                                const QString &method,
+                                const QByteArray &contentMd5,
+                                const QString &contentType,
+                                const QByteArray &date,
+                                const QStringMap &headers,
+                                const QString &resource);
+
+    static QByteArray signature(const QByteArray &canonicalString, const QByteArray &secretKey);
+};
+
+#endif // SIGNER_H
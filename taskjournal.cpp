@@ -0,0 +1,265 @@
+#include "taskjournal.h"
+
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// 新记录最迟这么久后写入磁盘，意外退出或断电时最多丢失这段时间内的记录
+static const int FlushInterval = 1000;
+
+// 多余的行数超过这个值且超过未完成任务数时压缩
+static const int CompactThreshold = 10000;
+
+// Constructor
+TaskJournal::TaskJournal(const QString &path) : _path(path), _file(path)
+{
+    QDir().mkpath(QFileInfo(_path).absolutePath());
+
+    _load();
+
+    // 启动时总是压缩一次，丢掉上次运行已结束的记录
+    _compact();
+
+    _flushTimer.setSingleShot(true);
+    _flushTimer.setInterval(FlushInterval);
+
+    QObject::connect(&_flushTimer, &QTimer::timeout, [this] { flush(); });
+}
+
+// Destructor
+TaskJournal::~TaskJournal()
+{
+    flush();
+
+    _file.close();
+}
+
+// Public Methods
+quint64 TaskJournal::add(const TaskRecord &record)
+{
+    TaskRecord added = record;
+    added.id = ++_lastId;
+    added.started = false;
+
+    _records.insert(added.id, added);
+
+    _append(_recordLine(added));
+
+    return added.id;
+}
+
+void TaskJournal::start(quint64 id)
+{
+    QMap<quint64, TaskRecord>::iterator it = _records.find(id);
+
+    if (it == _records.end() || it.value().started) return;
+
+    it.value().started = true;
+
+    _append(QJsonDocument(QJsonObject({
+        { "type", "start" },
+        { "id", QString::number(id) }
+    })).toJson(QJsonDocument::Compact));
+}
+
+void TaskJournal::finish(quint64 id)
+{
+    if (_records.remove(id) == 0) return;
+
+    _recovered.remove(id);
+
+    _append(QJsonDocument(QJsonObject({
+        { "type", "finish" },
+        { "id", QString::number(id) }
+    })).toJson(QJsonDocument::Compact));
+
+    if (_lineCount - _records.count() > CompactThreshold && _lineCount > 2 * _records.count()) _compact();
+}
+
+// 取出上次运行留下的、属于指定账号和桶的未完成任务，之后不再重复取出
+QList<TaskRecord> TaskJournal::takeRecovered(const QString &account, const QString &bucket)
+{
+    QList<TaskRecord> records;
+
+    if (_recovered.isEmpty()) return records;
+
+    foreach (const TaskRecord &record, _records)
+    {
+        if (!_recovered.contains(record.id) || record.account != account || record.bucket != bucket) continue;
+
+        _recovered.remove(record.id);
+
+        records.append(record);
+    }
+
+    return records;
+}
+
+void TaskJournal::flush()
+{
+    _flushTimer.stop();
+
+    if (!_isDirty) return;
+
+    if (!_file.flush() || !_sync()) qWarning() << "Write task journal failure:" << _path;
+
+    _isDirty = false;
+}
+
+// Private Methods
+void TaskJournal::_load()
+{
+    QFile file(_path);
+
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    // 最后一行可能只写了一半，解析失败的行直接跳过
+    while (!file.atEnd())
+    {
+        QByteArray line = file.readLine().trimmed();
+
+        if (line.isEmpty()) continue;
+
+        QJsonObject obj = QJsonDocument::fromJson(line).object();
+
+        QString type = obj["type"].toString();
+        quint64 id = obj["id"].toString().toULongLong();
+
+        if (id == 0) continue;
+
+        if (id > _lastId) _lastId = id;
+
+        if (type == "add")
+        {
+            TaskRecord record;
+            record.id = id;
+            record.account = obj["account"].toString();
+            record.bucket = obj["bucket"].toString();
+            record.operation = obj["operation"].toInt();
+            record.group = obj["group"].toString();
+            record.started = obj["started"].toBool();
+
+            QJsonObject params = obj["params"].toObject();
+
+            for (QJsonObject::const_iterator pci = params.constBegin(); pci != params.constEnd(); ++pci)
+                record.params.insert(pci.key(), pci.value().toString());
+
+            _records.insert(id, record);
+        }
+        else if (type == "start")
+        {
+            QMap<quint64, TaskRecord>::iterator it = _records.find(id);
+
+            if (it != _records.end()) it.value().started = true;
+        }
+        else if (type == "finish")
+        {
+            _records.remove(id);
+        }
+    }
+
+    file.close();
+
+    foreach (quint64 id, _records.keys()) _recovered.insert(id);
+
+    qDebug() << "Task journal unfinished:" << _records.count();
+}
+
+void TaskJournal::_append(const QByteArray &line)
+{
+    if (!_file.isOpen() && !_openForAppend()) return;
+
+    _file.write(line);
+    _file.write("\n");
+
+    ++_lineCount;
+
+    _isDirty = true;
+
+    if (!_flushTimer.isActive()) _flushTimer.start();
+}
+
+// 把未完成的任务重写为新文件，开始状态合并进加入记录
+void TaskJournal::_compact()
+{
+    if (_file.isOpen())
+    {
+        _file.flush();
+        _file.close();
+    }
+
+    QSaveFile file(_path);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Open task journal failure:" << _path;
+
+        return;
+    }
+
+    foreach (const TaskRecord &record, _records)
+    {
+        file.write(_recordLine(record));
+        file.write("\n");
+    }
+
+    if (!file.commit()) qWarning() << "Write task journal failure:" << _path;
+
+    _lineCount = _records.count();
+
+    _isDirty = false;
+
+    _openForAppend();
+}
+
+bool TaskJournal::_openForAppend()
+{
+    if (_file.open(QIODevice::WriteOnly | QIODevice::Append)) return true;
+
+    qWarning() << "Open task journal failure:" << _path;
+
+    return false;
+}
+
+// 写出系统缓存，QFile::flush 只把内容交给系统
+bool TaskJournal::_sync()
+{
+#ifdef Q_OS_WIN
+    return FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(_file.handle())));
+#else
+    return ::fsync(_file.handle()) == 0;
+#endif
+}
+
+QByteArray TaskJournal::_recordLine(const TaskRecord &record)
+{
+    QJsonObject params;
+
+    for (QStringHash::const_iterator ci = record.params.cbegin(); ci != record.params.cend(); ++ci)
+        params.insert(ci.key(), ci.value());
+
+    // 64 位整数以字符串保存，避免 JSON double 精度问题
+    QJsonObject obj = {
+        { "type", "add" },
+        { "id", QString::number(record.id) },
+        { "account", record.account },
+        { "bucket", record.bucket },
+        { "operation", record.operation },
+        { "params", params },
+        { "group", record.group },
+        { "started", record.started }
+    };
+
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact);
+}
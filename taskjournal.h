@@ -0,0 +1,61 @@
+#ifndef TASKJOURNAL_H
+#define TASKJOURNAL_H
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QFile>
+#include <QTimer>
+
+#include "qstringhash.h"
+
+typedef struct taskRecord
+{
+    quint64 id;
+    QString account;
+    QString bucket;
+    int operation;      // Client::Operation
+    QStringHash params;
+    QString group;
+    bool started;       // 已开始执行，上传、下载的进度另有记录
+
+    taskRecord() : id(0), operation(0), started(false) {}
+} TaskRecord;
+
+// 只追加写入的任务日志：加入队列、开始执行、结束各记一行，程序意外退出后可以只继续未完成的任务
+// 已结束的记录超过一定数量时压缩，只保留未完成的任务
+class TaskJournal
+{
+public:
+    explicit TaskJournal(const QString &path);
+    ~TaskJournal();
+
+    quint64 add(const TaskRecord &record);
+    void start(quint64 id);
+    void finish(quint64 id);
+    QList<TaskRecord> takeRecovered(const QString &account, const QString &bucket);
+    void flush();
+
+private:
+    QString _path;
+    QFile _file;
+    QMap<quint64, TaskRecord> _records; // 未完成的任务，按加入顺序
+    QSet<quint64> _recovered;           // 上次运行留下、尚未处理的任务
+
+    quint64 _lastId = 0;
+    int _lineCount = 0;
+
+    bool _isDirty = false;
+    QTimer _flushTimer; // 有新记录时启动，到时写入磁盘
+
+    void _load();
+    void _append(const QByteArray &line);
+    void _compact();
+    bool _openForAppend();
+    bool _sync();
+
+    static QByteArray _recordLine(const TaskRecord &record);
+};
+
+#endif // TASKJOURNAL_H
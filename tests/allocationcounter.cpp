@@ -0,0 +1,110 @@
+#include "allocationcounter.h"
+
+#include <cerrno>
+#include <cstddef>
+
+static thread_local quint64 allocationCount = 0;
+
+quint64 AllocationCounter::count()
+{
+    return allocationCount;
+}
+
+#if defined(__GLIBC__)
+
+bool AllocationCounter::isSupported()
+{
+    return true;
+}
+
+// 覆盖 C 库的全部分配函数，Qt 容器直接调用 malloc，operator new 在 libstdc++ 中也经过 malloc
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void *pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void* __libc_valloc(size_t size);
+void* __libc_pvalloc(size_t size);
+void __libc_free(void *pointer);
+
+void* malloc(size_t size)
+{
+    ++allocationCount;
+
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    ++allocationCount;
+
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void *pointer, size_t size)
+{
+    ++allocationCount;
+
+    return __libc_realloc(pointer, size);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    ++allocationCount;
+
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    ++allocationCount;
+
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **pointer, size_t alignment, size_t size)
+{
+    // 对齐必须是 2 的幂，且是指针大小的倍数
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+
+    ++allocationCount;
+
+    void *result = __libc_memalign(alignment, size);
+
+    if (!result) return ENOMEM;
+
+    *pointer = result;
+
+    return 0;
+}
+
+void* valloc(size_t size)
+{
+    ++allocationCount;
+
+    return __libc_valloc(size);
+}
+
+void* pvalloc(size_t size)
+{
+    ++allocationCount;
+
+    return __libc_pvalloc(size);
+}
+
+void free(void *pointer)
+{
+    __libc_free(pointer);
+}
+
+}
+
+#else
+
+bool AllocationCounter::isSupported()
+{
+    return false;
+}
+
+#endif
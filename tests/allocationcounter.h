@@ -0,0 +1,16 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+
+// 统计当前线程的堆分配次数，基准测试用来比较两种实现的分配量
+// 只支持 glibc：覆盖 malloc、calloc、realloc 及各对齐分配函数，Qt 容器和 operator new 的分配都能计入；
+// 其他平台无法以同样的口径统计，isSupported 返回 false，依赖分配次数的测试应跳过
+class AllocationCounter
+{
+public:
+    static bool isSupported();
+    static quint64 count();
+};
+
+#endif // ALLOCATIONCOUNTER_H
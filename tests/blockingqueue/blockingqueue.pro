@@ -0,0 +1,11 @@
+include(../tests.pri)
+
+TARGET = tst_blockingqueue
+
+HEADERS += \
+    ../../blockingqueue.h \
+    jobqueue.h \
+    workerqueue.h
+
+SOURCES += \
+    tst_blockingqueue.cpp
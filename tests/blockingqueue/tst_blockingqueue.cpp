@@ -0,0 +1,459 @@
+#include <QtTest>
+#include <QThread>
+#include <QAtomicInt>
+
+#include "blockingqueue.h"
+#include "jobqueue.h"
+#include "workerqueue.h"
+
+// BlockingQueue 的入队、出队、超时和关闭，以及多线程争用时与原来的 JobQueue、WorkerQueue 的吞吐量比较
+// jobqueue.h、workerqueue.h 为改动前的原样副本
+
+// 等待另一个线程进入阻塞的时间，毫秒
+static const int SettleTime = 50;
+
+// 超时测试允许的计时误差，毫秒
+static const int TimerSlack = 10;
+
+// 争用基准中每个线程入队、出队的元素数
+static const int ItemsPerThread = 50000;
+
+// 争用基准中 BlockingQueue 生产、消费同时进行时的容量
+static const int MixedCapacity = 64;
+
+// popItem 原来的队列 pop 直接返回元素，BlockingQueue 通过指针返回
+template <class Queue>
+static int popItem(Queue &queue) { return queue.pop(); }
+
+static int popItem(BlockingQueue<int> &queue)
+{
+    int value = 0;
+
+    queue.pop(&value);
+
+    return value;
+}
+
+// runThreads 启动 count 个线程执行 function(index)，等待全部结束
+template <class Function>
+static void runThreads(int count, Function function)
+{
+    QVector<QThread*> threads;
+
+    for (int i = 0; i < count; ++i) threads.append(QThread::create([function, i] { function(i); }));
+
+    foreach (QThread *thread, threads) thread->start();
+
+    foreach (QThread *thread, threads)
+    {
+        thread->wait();
+
+        delete thread;
+    }
+}
+
+// phased 多个生产者同时入队，全部结束后多个消费者同时出队，返回出队元素之和
+// 原来的队列入队、出队并发时会同时修改同一个 QList，只能这样分两步比较；
+// 每个消费者取出的数量固定，总数与入队数相同，取空前不会走到 pop 的 throw
+template <class Queue>
+static qint64 phased(Queue &queue, int threadCount)
+{
+    QAtomicInteger<qint64> sum;
+
+    runThreads(threadCount, [&queue](int index) {
+        for (int i = 0; i < ItemsPerThread; ++i) queue.push(index * ItemsPerThread + i);
+    });
+
+    runThreads(threadCount, [&queue, &sum](int) {
+        qint64 local = 0;
+
+        for (int i = 0; i < ItemsPerThread; ++i) local += popItem(queue);
+
+        sum.fetchAndAddRelaxed(local);
+    });
+
+    return sum;
+}
+
+// mixed 生产者和消费者同时运行，队列容量很小，入队、出队经常阻塞
+static qint64 mixed(BlockingQueue<int> &queue, int threadCount)
+{
+    QAtomicInteger<qint64> sum;
+
+    runThreads(threadCount * 2, [&queue, &sum, threadCount](int index) {
+        if (index < threadCount)
+        {
+            for (int i = 0; i < ItemsPerThread; ++i) queue.push(index * ItemsPerThread + i);
+
+            return;
+        }
+
+        qint64 local = 0;
+        int value;
+
+        for (int i = 0; i < ItemsPerThread; ++i)
+        {
+            if (queue.pop(&value)) local += value;
+        }
+
+        sum.fetchAndAddRelaxed(local);
+    });
+
+    return sum;
+}
+
+class BlockingQueueTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void fifo();
+    void tryPushFull();
+    void tryPopEmpty();
+    void timeout();
+    void popWaitsForPush();
+    void pushWaitsForPop();
+    void setCapacity();
+    void close();
+    void closeWakesWaiters();
+    void manyProducersConsumers();
+
+    void contention_data();
+    void contention();
+};
+
+void BlockingQueueTest::fifo()
+{
+    BlockingQueue<int> queue;
+
+    for (int i = 0; i < 5; ++i) QVERIFY(queue.push(i));
+
+    QCOMPARE(queue.count(), 5);
+    QVERIFY(!queue.isFull());
+
+    int value = -1;
+
+    for (int i = 0; i < 5; ++i)
+    {
+        QVERIFY(queue.pop(&value));
+        QCOMPARE(value, i);
+    }
+
+    QVERIFY(queue.isEmpty());
+}
+
+void BlockingQueueTest::tryPushFull()
+{
+    BlockingQueue<int> queue(2);
+
+    QVERIFY(queue.tryPush(1));
+    QVERIFY(queue.tryPush(2));
+    QVERIFY(queue.isFull());
+
+    // 满时不丢弃也不覆盖
+    QVERIFY(!queue.tryPush(3));
+    QCOMPARE(queue.count(), 2);
+
+    // 不带参数的 tryPop 丢弃队首
+    QVERIFY(queue.tryPop());
+    QVERIFY(queue.tryPush(3));
+
+    int value = 0;
+
+    QVERIFY(queue.tryPop(&value));
+    QCOMPARE(value, 2);
+}
+
+void BlockingQueueTest::tryPopEmpty()
+{
+    BlockingQueue<int> queue;
+
+    int value = 42;
+
+    QVERIFY(!queue.tryPop(&value));
+    QCOMPARE(value, 42);
+    QVERIFY(!queue.tryPop());
+}
+
+void BlockingQueueTest::timeout()
+{
+    BlockingQueue<int> queue(1);
+    QElapsedTimer timer;
+
+    timer.start();
+    QVERIFY(!queue.tryPop(nullptr, SettleTime));
+    QVERIFY(timer.elapsed() >= SettleTime - TimerSlack);
+
+    QVERIFY(queue.tryPush(1));
+
+    timer.start();
+    QVERIFY(!queue.tryPush(2, SettleTime));
+    QVERIFY(timer.elapsed() >= SettleTime - TimerSlack);
+
+    // 等待期间有空位时立即入队
+    QThread *consumer = QThread::create([&queue] {
+        QThread::msleep(SettleTime);
+        queue.pop();
+    });
+
+    consumer->start();
+
+    QVERIFY(queue.tryPush(2, 10000));
+
+    consumer->wait();
+    delete consumer;
+
+    int value = 0;
+
+    QVERIFY(queue.tryPop(&value));
+    QCOMPARE(value, 2);
+}
+
+void BlockingQueueTest::popWaitsForPush()
+{
+    BlockingQueue<int> queue;
+    QAtomicInt popped(-1);
+
+    QThread *consumer = QThread::create([&queue, &popped] {
+        int value = 0;
+
+        if (queue.pop(&value)) popped.storeRelease(value);
+    });
+
+    consumer->start();
+
+    QThread::msleep(SettleTime);
+    QCOMPARE(popped.loadAcquire(), -1);
+
+    queue.push(7);
+
+    QVERIFY(consumer->wait(10000));
+    QCOMPARE(popped.loadAcquire(), 7);
+
+    delete consumer;
+}
+
+void BlockingQueueTest::pushWaitsForPop()
+{
+    BlockingQueue<int> queue(1);
+    QAtomicInt pushed(0);
+
+    queue.push(1);
+
+    QThread *producer = QThread::create([&queue, &pushed] {
+        if (queue.push(2)) pushed.storeRelease(1);
+    });
+
+    producer->start();
+
+    QThread::msleep(SettleTime);
+    QCOMPARE(pushed.loadAcquire(), 0);
+    QCOMPARE(queue.count(), 1);
+
+    int value = 0;
+
+    QVERIFY(queue.pop(&value));
+    QCOMPARE(value, 1);
+
+    QVERIFY(producer->wait(10000));
+    QCOMPARE(pushed.loadAcquire(), 1);
+
+    QVERIFY(queue.pop(&value));
+    QCOMPARE(value, 2);
+
+    delete producer;
+}
+
+void BlockingQueueTest::setCapacity()
+{
+    BlockingQueue<int> queue(1);
+
+    queue.push(1);
+
+    QThread *producer = QThread::create([&queue] { queue.push(2); });
+
+    producer->start();
+
+    QThread::msleep(SettleTime);
+    QCOMPARE(queue.count(), 1);
+
+    // 调大容量唤醒等待的生产者
+    queue.setCapacity(2);
+
+    QVERIFY(producer->wait(10000));
+    QCOMPARE(queue.count(), 2);
+
+    delete producer;
+
+    // 调小容量时已有元素保留
+    queue.setCapacity(1);
+
+    QCOMPARE(queue.count(), 2);
+    QVERIFY(queue.isFull());
+    QVERIFY(!queue.tryPush(3));
+}
+
+void BlockingQueueTest::close()
+{
+    BlockingQueue<int> queue;
+
+    queue.push(1);
+    queue.push(2);
+    queue.close();
+
+    QVERIFY(queue.isClosed());
+    QVERIFY(!queue.push(3));
+    QVERIFY(!queue.tryPush(3));
+
+    // 关闭前入队的元素仍可取出，取完后立即返回 false
+    int value = 0;
+
+    QVERIFY(queue.pop(&value));
+    QCOMPARE(value, 1);
+    QVERIFY(queue.tryPop(&value, 10000));
+    QCOMPARE(value, 2);
+
+    QElapsedTimer timer;
+
+    timer.start();
+    QVERIFY(!queue.pop(&value));
+    QVERIFY(!queue.tryPop(&value, 10000));
+    QVERIFY(timer.elapsed() < 10000);
+}
+
+void BlockingQueueTest::closeWakesWaiters()
+{
+    BlockingQueue<int> empty;
+    BlockingQueue<int> full(1);
+    QAtomicInt results(0);
+
+    full.push(1);
+
+    QThread *consumer = QThread::create([&empty, &results] {
+        if (!empty.pop()) results.fetchAndAddOrdered(1);
+    });
+
+    QThread *producer = QThread::create([&full, &results] {
+        if (!full.push(2)) results.fetchAndAddOrdered(1);
+    });
+
+    consumer->start();
+    producer->start();
+
+    QThread::msleep(SettleTime);
+    QCOMPARE(results.loadAcquire(), 0);
+
+    empty.close();
+    full.close();
+
+    QVERIFY(consumer->wait(10000));
+    QVERIFY(producer->wait(10000));
+    QCOMPARE(results.loadAcquire(), 2);
+    QCOMPARE(full.count(), 1);
+
+    delete consumer;
+    delete producer;
+}
+
+// 多个生产者、消费者同时运行，每个元素恰好取出一次
+void BlockingQueueTest::manyProducersConsumers()
+{
+    const int threadCount = 4;
+    const int items = 20000;
+
+    BlockingQueue<int> queue(8);
+    QVector<QAtomicInt> seen(threadCount * items);
+    QAtomicInt *counts = seen.data();
+
+    QThread *closer = QThread::create([&queue, threadCount, items] {
+        runThreads(threadCount, [&queue, items](int index) {
+            for (int i = 0; i < items; ++i) queue.push(index * items + i);
+        });
+
+        queue.close();
+    });
+
+    closer->start();
+
+    runThreads(threadCount, [&queue, counts](int) {
+        int value;
+
+        while (queue.pop(&value)) counts[value].fetchAndAddRelaxed(1);
+    });
+
+    closer->wait();
+    delete closer;
+
+    for (int i = 0; i < seen.count(); ++i)
+    {
+        int count = seen.at(i).loadAcquire();
+
+        if (count != 1) QFAIL(qPrintable(QString("item %1 popped %2 times").arg(i).arg(count)));
+    }
+}
+
+void BlockingQueueTest::contention_data()
+{
+    QTest::addColumn<QString>("queue");
+    QTest::addColumn<int>("threads");
+
+    foreach (int threads, QList<int>({ 1, 2, 4, 8 }))
+    {
+        QTest::addRow("JobQueue, %d threads", threads) << "JobQueue" << threads;
+        QTest::addRow("WorkerQueue, %d threads", threads) << "WorkerQueue" << threads;
+        QTest::addRow("BlockingQueue, %d threads", threads) << "BlockingQueue" << threads;
+        QTest::addRow("BlockingQueue mixed, %d threads", threads) << "mixed" << threads;
+    }
+}
+
+// 每个线程入队、出队 ItemsPerThread 个元素，输出每秒完成的入队加出队次数
+void BlockingQueueTest::contention()
+{
+    QFETCH(QString, queue);
+    QFETCH(int, threads);
+
+    qint64 total = qint64(threads) * ItemsPerThread;
+    qint64 expected = total * (total - 1) / 2;
+    qint64 operations = 0;
+
+    QElapsedTimer timer;
+
+    timer.start();
+
+    QBENCHMARK {
+        qint64 sum;
+
+        if (queue == "JobQueue")
+        {
+            JobQueue<int> jobQueue;
+            sum = phased(jobQueue, threads);
+        }
+        else if (queue == "WorkerQueue")
+        {
+            WorkerQueue<int> workerQueue(total);
+            sum = phased(workerQueue, threads);
+        }
+        else if (queue == "BlockingQueue")
+        {
+            BlockingQueue<int> blockingQueue;
+            sum = phased(blockingQueue, threads);
+        }
+        else
+        {
+            BlockingQueue<int> blockingQueue(MixedCapacity);
+            sum = mixed(blockingQueue, threads);
+        }
+
+        QCOMPARE(sum, expected);
+
+        operations += total * 2;
+    }
+
+    qint64 elapsed = timer.elapsed();
+
+    qInfo("%s: %.0f operations/s", QTest::currentDataTag(), operations * 1000.0 / qMax<qint64>(elapsed, 1));
+}
+
+QTEST_GUILESS_MAIN(BlockingQueueTest)
+
+#include "tst_blockingqueue.moc"
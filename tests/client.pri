@@ -0,0 +1,16 @@
+# 需要链接 Client 的测试、基准共用，在 tests.pri 之后 include
+QT += network concurrent
+
+SOURCES += \
+    $$PWD/../client.cpp \
+    $$PWD/../concurrencycontroller.cpp \
+    $$PWD/../downloadcheckpoint.cpp \
+    $$PWD/../fileslicedevice.cpp \
+    $$PWD/../percentencoder.cpp \
+    $$PWD/../ratelimiter.cpp \
+    $$PWD/../signer.cpp \
+    $$PWD/../uploadjournal.cpp
+
+HEADERS += \
+    $$PWD/../client.h \
+    $$PWD/../fileslicedevice.h
@@ -0,0 +1,18 @@
+#ifndef MOVETOTHREAD_H
+#define MOVETOTHREAD_H
+
+#include <QObject>
+#include <QThread>
+
+// Client、CDN 构造后把自己移到了自己的线程；测试要直接调用内部方法时，在那个线程里把它移回当前线程
+// 原来的线程继续空转，对象删除时退出，调用方需要等待并删除它
+inline void moveToCurrentThread(QObject *object)
+{
+    QThread *thread = QThread::currentThread();
+
+    QMetaObject::invokeMethod(object, [object, thread] {
+        object->moveToThread(thread);
+    }, Qt::BlockingQueuedConnection);
+}
+
+#endif // MOVETOTHREAD_H
@@ -0,0 +1,8 @@
+include(../tests.pri)
+
+QT += network
+
+TARGET = tst_networkscaling
+
+SOURCES += \
+    tst_networkscaling.cpp
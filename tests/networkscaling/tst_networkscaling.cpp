@@ -0,0 +1,260 @@
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkProxy>
+#include <QThread>
+
+// 每个线程一个 QNetworkAccessManager 时，收发小请求的吞吐量随线程数的变化
+// 用于判断 Client 是否值得把请求分到多个网络线程：单线程的吞吐量远高于并发上限能达到的请求数时不必分
+
+// 请求总数，平均分给各线程
+static const int RequestCount = 20000;
+
+// 每个 QNetworkAccessManager 对同一主机最多 6 个连接
+static const int ConcurrencyPerManager = 6;
+
+// 模拟 HEAD、删除等小请求的应答
+static const QByteArray Response = "HTTP/1.1 200 OK\r\n"
+                                   "Content-Length: 0\r\n"
+                                   "Connection: keep-alive\r\n"
+                                   "\r\n";
+
+// 应答所在线程中的连接
+class Responder : public QObject
+{
+    Q_OBJECT
+
+public:
+    void accept(qintptr socketDescriptor)
+    {
+        QTcpSocket *socket = new QTcpSocket(this);
+        socket->setSocketDescriptor(socketDescriptor);
+
+        connect(socket, &QTcpSocket::readyRead, socket, [this, socket] {
+            QByteArray &buffer = _buffers[socket];
+            buffer += socket->readAll();
+
+            // 请求都没有请求体，每个空行对应一个请求
+            int end;
+
+            while ((end = buffer.indexOf("\r\n\r\n")) >= 0)
+            {
+                buffer.remove(0, end + 4);
+
+                socket->write(Response);
+            }
+        });
+
+        connect(socket, &QTcpSocket::disconnected, socket, [this, socket] {
+            _buffers.remove(socket);
+
+            socket->deleteLater();
+        });
+    }
+
+private:
+    QHash<QTcpSocket*, QByteArray> _buffers;
+};
+
+// 本地 HTTP 服务，连接轮流交给各应答线程，避免服务端成为瓶颈
+class HttpServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    explicit HttpServer(int threadCount)
+    {
+        for (int i = 0; i < threadCount; ++i)
+        {
+            QThread *thread = new QThread;
+            Responder *responder = new Responder;
+
+            responder->moveToThread(thread);
+
+            connect(thread, &QThread::finished, responder, &QObject::deleteLater);
+
+            thread->start();
+
+            _threads.append(thread);
+            _responders.append(responder);
+        }
+    }
+
+    ~HttpServer()
+    {
+        foreach (QThread *thread, _threads)
+        {
+            thread->quit();
+            thread->wait();
+
+            delete thread;
+        }
+    }
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override
+    {
+        Responder *responder = _responders.at(_next++ % _responders.count());
+
+        QMetaObject::invokeMethod(responder, [responder, socketDescriptor] {
+            responder->accept(socketDescriptor);
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    QVector<QThread*> _threads;
+    QVector<Responder*> _responders;
+    int _next = 0;
+};
+
+// 在所在线程中用自己的 QNetworkAccessManager 发出 count 个请求
+class Requester : public QObject
+{
+    Q_OBJECT
+
+public:
+    Requester(const QUrl &url, int count) : _url(url), _remaining(count), _pending(count) {}
+
+public slots:
+    void start()
+    {
+        _manager = new QNetworkAccessManager(this);
+        _manager->setProxy(QNetworkProxy::NoProxy);
+
+        connect(_manager, &QNetworkAccessManager::finished, this, &Requester::_finished);
+
+        for (int i = 0; i < ConcurrencyPerManager; ++i) _send();
+    }
+
+signals:
+    void done(int errors);
+
+private:
+    QUrl _url;
+    QNetworkAccessManager *_manager = nullptr;
+    int _remaining;
+    int _pending;
+    int _errors = 0;
+
+    void _send()
+    {
+        if (_remaining == 0) return;
+
+        --_remaining;
+
+        _manager->head(QNetworkRequest(_url));
+    }
+
+    void _finished(QNetworkReply *reply)
+    {
+        if (reply->error() != QNetworkReply::NoError) ++_errors;
+
+        reply->deleteLater();
+
+        if (--_pending == 0)
+        {
+            emit done(_errors);
+
+            return;
+        }
+
+        _send();
+    }
+};
+
+class NetworkScalingBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void requests_data();
+    void requests();
+
+private:
+    HttpServer *_server = nullptr;
+};
+
+void NetworkScalingBenchmark::initTestCase()
+{
+    _server = new HttpServer(qMax(2, QThread::idealThreadCount()));
+
+    QVERIFY(_server->listen(QHostAddress::LocalHost));
+}
+
+void NetworkScalingBenchmark::cleanupTestCase()
+{
+    delete _server;
+    _server = nullptr;
+}
+
+void NetworkScalingBenchmark::requests_data()
+{
+    QTest::addColumn<int>("threadCount");
+
+    for (int threadCount = 1; threadCount <= 8; threadCount *= 2)
+        QTest::newRow(qPrintable(QString("%1 threads").arg(threadCount))) << threadCount;
+}
+
+void NetworkScalingBenchmark::requests()
+{
+    QFETCH(int, threadCount);
+
+    QUrl url(QString("http://127.0.0.1:%1/bucket/object").arg(_server->serverPort()));
+
+    QVector<QThread*> threads;
+    int finished = 0;
+    int errors = 0;
+
+    QEventLoop loop;
+    QElapsedTimer timer;
+
+    for (int i = 0; i < threadCount; ++i)
+    {
+        QThread *thread = new QThread;
+        Requester *requester = new Requester(url, RequestCount / threadCount);
+
+        requester->moveToThread(thread);
+
+        connect(thread, &QThread::started, requester, &Requester::start);
+        connect(thread, &QThread::finished, requester, &QObject::deleteLater);
+        connect(requester, &Requester::done, &loop, [&, threadCount](int requesterErrors) {
+            errors += requesterErrors;
+
+            if (++finished == threadCount) loop.quit();
+        }, Qt::QueuedConnection);
+
+        threads.append(thread);
+    }
+
+    QBENCHMARK_ONCE {
+        timer.start();
+
+        foreach (QThread *thread, threads) thread->start();
+
+        loop.exec();
+    }
+
+    qint64 elapsed = timer.elapsed();
+
+    foreach (QThread *thread, threads)
+    {
+        thread->quit();
+        thread->wait();
+
+        delete thread;
+    }
+
+    QCOMPARE(errors, 0);
+
+    qInfo("%d threads: %d requests in %lld ms, %.0f requests/s",
+          threadCount, RequestCount, elapsed, RequestCount * 1000.0 / qMax<qint64>(elapsed, 1));
+}
+
+QTEST_GUILESS_MAIN(NetworkScalingBenchmark)
+
+#include "tst_networkscaling.moc"
@@ -0,0 +1,7 @@
+include(../tests.pri)
+
+TARGET = tst_percentencoder
+
+SOURCES += \
+    ../../percentencoder.cpp \
+    tst_percentencoder.cpp
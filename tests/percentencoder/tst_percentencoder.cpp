@@ -0,0 +1,179 @@
+#include <QtTest>
+#include <QUrl>
+
+#include "percentencoder.h"
+
+// PercentEncoder 与原来的 QUrl::toPercentEncoding 写法逐字节比较，并比较两者在常见对象名上的吞吐量
+
+static const int CorpusSize = 20000;
+
+// 原来的写法：URL 中的对象名
+static QString legacyUrl(const QString &objectKey)
+{
+    QString encodeKey = QUrl::toPercentEncoding(objectKey);
+    encodeKey.replace("~", "%7E").replace("%2F", "/");
+
+    return encodeKey;
+}
+
+// 原来的写法：签名中的对象名
+static QString legacyResource(const QString &objectKey)
+{
+    QString object = legacyUrl(objectKey);
+    object.replace("/", "%2F");
+
+    return object;
+}
+
+class PercentEncoderTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void everyByte();
+    void everyPair();
+    void nonAscii_data();
+    void nonAscii();
+
+    void throughput_data();
+    void throughput();
+
+private:
+    void _compare(const QString &text);
+};
+
+// 0x00 到 0xFF 的每个字符单独编码，以及夹在普通字符中间编码
+void PercentEncoderTest::everyByte()
+{
+    for (int c = 0; c < 256; ++c)
+    {
+        QString single(QChar(static_cast<ushort>(c)));
+
+        _compare(single);
+        _compare("a" + single + "/b" + single);
+
+        if (QTest::currentTestFailed()) return;
+    }
+}
+
+// 任意两个 ASCII 字符相邻时结果也相同，覆盖 ~、/ 与 %2F 的替换互相影响的情况
+void PercentEncoderTest::everyPair()
+{
+    for (int a = 0; a < 128; ++a)
+    {
+        for (int b = 0; b < 128; ++b)
+        {
+            _compare(QString(QChar(static_cast<ushort>(a))) + QChar(static_cast<ushort>(b)));
+
+            if (QTest::currentTestFailed()) return;
+        }
+    }
+}
+
+void PercentEncoderTest::nonAscii_data()
+{
+    QTest::addColumn<QString>("text");
+
+    QTest::newRow("CJK") << "照片/2024/相册 一/IMG_0001.jpg";
+    QTest::newRow("fullwidth") << "文件（副本）～１.txt";
+    QTest::newRow("emoji") << QString::fromUtf8("\xF0\x9F\x93\x81/\xF0\x9F\x98\x80 ~.png");
+    QTest::newRow("combining") << QString::fromUtf8("Cafe\xCC\x81/re\xCC\x81sume\xCC\x81.doc");
+    QTest::newRow("percent") << "100%/%2F%7E~/a%20b";
+    QTest::newRow("reserved") << "!*'();:@&=+$,/?#[]";
+}
+
+void PercentEncoderTest::nonAscii()
+{
+    QFETCH(QString, text);
+
+    _compare(text);
+}
+
+void PercentEncoderTest::throughput_data()
+{
+    QTest::addColumn<bool>("legacy");
+    QTest::addColumn<QStringList>("corpus");
+
+    QStringList ascii;
+    QStringList cjk;
+    QStringList deep;
+
+    for (int i = 0; i < CorpusSize; ++i)
+    {
+        ascii.append(QString("logs/2024-10-%1/server-%2.log.gz").arg(i % 31 + 1).arg(i));
+        cjk.append(QString("照片/%1 年/家庭相册 第 %2 组/合影 %3.jpg").arg(2000 + i % 25).arg(i / 100).arg(i));
+
+        // 深层目录：上传整个项目时的对象名
+        QString key;
+
+        for (int depth = 0; depth < 12; ++depth) key += QString("目录-%1/sub_dir~%2/").arg(depth).arg(i % 7);
+
+        deep.append(key + QString("文件 %1.txt").arg(i));
+    }
+
+    QTest::newRow("ascii, before") << true << ascii;
+    QTest::newRow("ascii, after") << false << ascii;
+    QTest::newRow("cjk, before") << true << cjk;
+    QTest::newRow("cjk, after") << false << cjk;
+    QTest::newRow("deep prefix, before") << true << deep;
+    QTest::newRow("deep prefix, after") << false << deep;
+}
+
+// 每个对象名同时得到 URL 和签名两种形式，与 Client 构造请求时相同
+void PercentEncoderTest::throughput()
+{
+    QFETCH(bool, legacy);
+    QFETCH(QStringList, corpus);
+
+    qint64 bytes = 0;
+
+    foreach (const QString &key, corpus) bytes += key.toUtf8().size();
+
+    qint64 total = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+
+    QBENCHMARK {
+        foreach (const QString &key, corpus)
+        {
+            QString url;
+            QString resource;
+
+            // 原来签名时由 URL 形式再替换一次
+            if (legacy)
+            {
+                url = legacyUrl(key);
+                resource = url;
+                resource.replace("/", "%2F");
+            }
+            else
+            {
+                PercentEncoder::encodeObjectKey(key, url, resource);
+            }
+        }
+
+        total += bytes;
+    }
+
+    qint64 elapsed = timer.elapsed();
+
+    qInfo("%s: %.1f MB/s", QTest::currentDataTag(), total * 1000.0 / 1048576 / qMax<qint64>(elapsed, 1));
+}
+
+// _compare 三种结果都与原来的写法相同
+void PercentEncoderTest::_compare(const QString &text)
+{
+    QString url;
+    QString resource;
+
+    PercentEncoder::encodeObjectKey(text, url, resource);
+
+    QCOMPARE(PercentEncoder::encode(text), QString(QUrl::toPercentEncoding(text)));
+    QCOMPARE(url, legacyUrl(text));
+    QCOMPARE(resource, legacyResource(text));
+}
+
+QTEST_GUILESS_MAIN(PercentEncoderTest)
+
+#include "tst_percentencoder.moc"
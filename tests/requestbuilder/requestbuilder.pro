@@ -0,0 +1,10 @@
+include(../tests.pri)
+include(../client.pri)
+
+TARGET = tst_requestbuilder
+
+HEADERS += \
+    ../movetothread.h
+
+SOURCES += \
+    tst_requestbuilder.cpp
@@ -0,0 +1,351 @@
+#include <QtTest>
+#include <QLoggingCategory>
+#include <QMessageAuthenticationCode>
+#include <QMimeDatabase>
+#include <QNetworkRequest>
+
+#include "client.h"
+#include "movetothread.h"
+
+// 构造并签名请求的吞吐量：缓存 Date、MIME 类型、签名密钥之前的实现与当前的 Client::_buildRequest 比较
+// 请求组合接近一次文件夹上传：小文件 PUT、HEAD、分块上传和列表
+
+static const int RequestCount = 20000;
+
+static const QString Bucket = "benchmark-bucket";
+
+// 常见的扩展名，同一扩展名的文件名各不相同
+static const QStringList FileNames = {
+    "IMG_%1.jpg", "截图 %1.png", "notes-%1.txt", "backup.%1.tar.gz", "video_%1.mp4", "report %1.pdf", "Makefile"
+};
+
+typedef struct requestSpec
+{
+    QString method;
+    QStringHash headers;
+    qint64 bodySize;
+    QByteArray bodyHash;
+    Client::Action action;
+    QStringHash resources;       // 当前实现使用的资源，含签名用的 objectResource
+    QStringHash legacyResources; // 改动前的资源，只有 bucket、object 和查询参数
+} RequestSpec;
+
+class RequestBuilderBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void sameSignature();
+
+    void build_data();
+    void build();
+
+private:
+    Client *_client = nullptr;
+    QThread *_clientThread = nullptr;
+    QVector<RequestSpec> _specs;
+
+    QNetworkRequest _legacyBuildRequest(const RequestSpec &spec);
+    void _legacySignRequest(const QString &method,
+                            QNetworkRequest &request,
+                            const QStringMap &nosHeaders,
+                            const Client::Action &action,
+                            const QStringHash &resources);
+};
+
+void RequestBuilderBenchmark::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+
+    // 每个请求都有调试输出，计时时关掉
+    QLoggingCategory::setFilterRules("default.debug=false");
+
+    _client = new Client;
+    _clientThread = _client->_thread;
+
+    moveToCurrentThread(_client);
+
+    _client->setAccount(Account("benchmark", "nos-eastchina1.126.net", "0123456789abcdef", "fedcba9876543210fedcba9876543210"));
+
+    for (int i = 0; i < RequestCount; ++i)
+    {
+        QString fileName = FileNames.at(i % FileNames.count()).arg(i);
+        QString objectKey = QString("uploads/2024/第 %1 组/").arg(i / 100) + fileName;
+
+        QStringHash resources = Client::_objectResources(Bucket, objectKey);
+        QStringHash legacyResources = { { "bucket", Bucket }, { "object", resources["object"] } };
+
+        RequestSpec spec = {
+            .method = "PUT",
+            .headers = { { "host", Bucket + ".nos-eastchina1.126.net" } },
+            .bodySize = 0,
+            .bodyHash = QByteArray(),
+            .action = Client::objectAction,
+            .resources = resources,
+            .legacyResources = legacyResources
+        };
+
+        switch (i % 4)
+        {
+        case 0:
+            spec.bodySize = 4096 + i;
+            spec.bodyHash = QCryptographicHash::hash(objectKey.toUtf8(), QCryptographicHash::Md5);
+            break;
+        case 1:
+            spec.method = "HEAD";
+            break;
+        case 2:
+            spec.bodySize = 10485760;
+            spec.bodyHash = QCryptographicHash::hash(objectKey.toUtf8(), QCryptographicHash::Md5);
+            spec.resources.insert("partNumber", QString::number(i % 100 + 1));
+            spec.resources.insert("uploadId", "upload-" + QString::number(i / 100));
+            spec.legacyResources.insert("partNumber", QString::number(i % 100 + 1));
+            spec.legacyResources.insert("uploadId", "upload-" + QString::number(i / 100));
+            break;
+        case 3:
+            spec.method = "GET";
+            spec.action = Client::bucketAction;
+            spec.resources = {
+                { "bucket", Bucket },
+                { "prefix", QString("uploads/2024/第 %1 组/").arg(i / 100) },
+                { "delimiter", "/" },
+                { "max-keys", "1000" }
+            };
+            spec.legacyResources = spec.resources;
+            break;
+        }
+
+        _specs.append(spec);
+    }
+}
+
+void RequestBuilderBenchmark::cleanupTestCase()
+{
+    delete _client;
+    _client = nullptr;
+
+    _clientThread->wait();
+
+    delete _clientThread;
+    _clientThread = nullptr;
+}
+
+// 两种实现在同一秒内构造的请求完全相同
+void RequestBuilderBenchmark::sameSignature()
+{
+    for (int i = 0; i < 200; ++i)
+    {
+        const RequestSpec &spec = _specs.at(i);
+
+        QNetworkRequest legacy;
+        QNetworkRequest current;
+
+        // 跨秒时 Date 不同，重来一次
+        do
+        {
+            legacy = _legacyBuildRequest(spec);
+            current = _client->_buildRequest(spec.method, spec.headers, spec.bodySize, spec.bodyHash, spec.action, spec.resources);
+        } while (legacy.rawHeader("date") != current.rawHeader("date"));
+
+        QCOMPARE(current.url(), legacy.url());
+        QCOMPARE(current.header(QNetworkRequest::ContentTypeHeader), legacy.header(QNetworkRequest::ContentTypeHeader));
+        QCOMPARE(current.rawHeader("authorization"), legacy.rawHeader("authorization"));
+    }
+}
+
+void RequestBuilderBenchmark::build_data()
+{
+    QTest::addColumn<bool>("legacy");
+
+    QTest::newRow("before") << true;
+    QTest::newRow("after") << false;
+}
+
+void RequestBuilderBenchmark::build()
+{
+    QFETCH(bool, legacy);
+
+    int count = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+
+    QBENCHMARK {
+        foreach (const RequestSpec &spec, _specs)
+        {
+            QNetworkRequest request = legacy
+                ? _legacyBuildRequest(spec)
+                : _client->_buildRequest(spec.method, spec.headers, spec.bodySize, spec.bodyHash, spec.action, spec.resources);
+
+            if (!request.rawHeader("authorization").isEmpty()) ++count;
+        }
+    }
+
+    qint64 elapsed = timer.elapsed();
+
+    QVERIFY(count > 0);
+
+    qInfo("%s: %.0f requests/s", legacy ? "before" : "after", count * 1000.0 / qMax<qint64>(elapsed, 1));
+}
+
+// _legacyBuildRequest 改动前的 Client::_buildRequest，每个请求重新格式化 Date、查询 MIME 类型
+QNetworkRequest RequestBuilderBenchmark::_legacyBuildRequest(const RequestSpec &spec)
+{
+    QNetworkRequest request;
+
+    QString url = "http://" + _client->_account.endpoint + "/";
+
+    if (spec.action == Client::objectAction) url += spec.legacyResources["object"];
+
+    request.setUrl(url);
+
+    QDateTime dateTime = QDateTime::currentDateTimeUtc();
+    QLocale locale = QLocale::English;
+    QString format = "ddd, dd MMM yyyy HH:mm:ss";
+
+    auto date = locale.toString(dateTime, format) + " GMT";
+
+    request.setRawHeader("date", date.toUtf8());
+
+    QStringMap nosHeaders;
+
+    QStringHash::const_iterator ci;
+
+    for (ci = spec.headers.cbegin(); ci != spec.headers.cend(); ++ci)
+    {
+        QString key = ci.key();
+        QString value = ci.value();
+
+        if (value != "") {
+            request.setRawHeader(key.toUtf8(), value.toUtf8());
+
+            if (key.startsWith("x-nos-")) nosHeaders.insert(key, value);
+        }
+    }
+
+    if (spec.bodySize > 0)
+    {
+        request.setHeader(QNetworkRequest::ContentLengthHeader, spec.bodySize);
+
+        request.setRawHeader("content-md5", spec.bodyHash.toHex());
+    }
+
+    QString contentType = request.header(QNetworkRequest::ContentTypeHeader).toString();
+
+    if (contentType.isEmpty() && spec.action == Client::objectAction)
+    {
+        QString filename = spec.legacyResources["object"].split("/").last();
+        QMimeDatabase db;
+        QMimeType mimeType = db.mimeTypeForFile(filename, QMimeDatabase::MatchExtension);
+        contentType = mimeType.name();
+
+        if (contentType.isEmpty()) contentType = "application/octet-stream";
+
+        request.setHeader(QNetworkRequest::ContentTypeHeader, contentType);
+    }
+
+    _legacySignRequest(spec.method, request, nosHeaders, spec.action, spec.legacyResources);
+
+    return request;
+}
+
+// _legacySignRequest 改动前的 Client::_signRequest，每个请求重新转换密钥、拼接临时字符串
+void RequestBuilderBenchmark::_legacySignRequest(const QString &method,
+                                                 QNetworkRequest &request,
+                                                 const QStringMap &nosHeaders,
+                                                 const Client::Action &action,
+                                                 const QStringHash &resources)
+{
+    QStringList sign = {
+        method,
+        request.rawHeader("content-md5"),
+        request.header(QNetworkRequest::ContentTypeHeader).toString(),
+        request.rawHeader("date")
+    };
+
+    QStringMap::const_iterator nci;
+
+    if (nosHeaders.size() > 0)
+    {
+        QString headerString;
+
+        for (nci = nosHeaders.cbegin(); nci != nosHeaders.cend(); ++nci)
+            headerString += nci.key() + ":" + nci.value() + "\n";
+
+        sign.append(headerString);
+    }
+    else
+        sign.append("");
+
+    QString resource;
+
+    switch (action) {
+        case Client::listBucketAction:
+            resource = "/";
+            break;
+
+        case Client::bucketAction: resource = "/" + resources["bucket"] + "/"; break;
+        case Client::objectAction:
+            QString object = resources["object"];
+            object.replace("/", "%2F");
+
+            resource = "/" + resources["bucket"] + "/" + object;
+
+            break;
+    }
+
+    QStringHash::const_iterator rci;
+    QStringMap params;
+
+    for (rci = resources.cbegin(); rci != resources.cend(); ++rci)
+    {
+        QString key = rci.key();
+
+        if (key != "bucket" && key != "object")
+        {
+            params.insert(key, rci.value());
+        }
+    }
+
+    QString url = request.url().toString();
+
+    if (params.size() > 0)
+    {
+        QStringList subResourceList = { "acl", "location", "uploadId", "uploads", "partNumber", "delete" };
+
+        QStringList subResources;
+        QStringList query;
+        QStringMap::const_iterator pci;
+
+        for (pci = params.cbegin(); pci != params.cend(); ++pci)
+        {
+            QString subQuery = pci.key();
+            if (!pci.value().isEmpty()) subQuery += "=" + pci.value();
+
+            query.append(subQuery);
+
+            if (subResourceList.contains(pci.key())) subResources.append(subQuery);
+        }
+
+        if (subResources.size() > 0) resource += "?" + subResources.join("&");
+
+        url += "?" + query.join("&");
+
+        request.setUrl(QUrl(url));
+    }
+
+    QString signString = sign.join("\n") + resource;
+
+    QString signature = QMessageAuthenticationCode::hash(signString.toUtf8(),
+                                                         _client->_account.accessSecret.toUtf8(),
+                                                         QCryptographicHash::Sha256).toBase64();
+
+    request.setRawHeader("authorization", ("NOS " + _client->_account.accessKey + ":" + signature).toUtf8());
+}
+
+QTEST_GUILESS_MAIN(RequestBuilderBenchmark)
+
+#include "tst_requestbuilder.moc"
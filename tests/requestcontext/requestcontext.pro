@@ -0,0 +1,11 @@
+include(../tests.pri)
+include(../client.pri)
+
+TARGET = tst_requestcontext
+
+HEADERS += \
+    ../allocationcounter.h
+
+SOURCES += \
+    ../allocationcounter.cpp \
+    tst_requestcontext.cpp
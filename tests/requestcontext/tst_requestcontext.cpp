@@ -0,0 +1,365 @@
+#include <QtTest>
+#include <QNetworkReply>
+
+#include "allocationcounter.h"
+#include "client.h"
+
+// 小文件上传时每个请求的记录开销：改为 RequestContext 前后各处理一遍同样的请求，比较耗时和堆分配次数
+// 两边都从同一个 putObject 任务开始，经过发送、记录、响应结束到 _putObjectHandler，
+// 只去掉构造请求、网络收发、连接和发出信号的语句
+
+static const int RequestCount = 100000;
+
+class RequestContextBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void legacyTables();
+    void requestContext();
+    void allocations();
+
+private:
+    class LegacyClient;
+    class ContextClient;
+
+    QVector<Client::Job> _jobs;
+    QVector<QStringHash> _resources;
+
+    template <class Recorder>
+    double _run(Recorder &recorder, int count);
+};
+
+// 改动前（430f7cb^）Client 中的记录方式：操作、统计、对象参数和附加信息各存一张以响应为键的表，
+// 文件大小、开始时间等数值以字符串保存。下面的成员和函数体摘自当时的 client.h、client.cpp
+class RequestContextBenchmark::LegacyClient
+{
+public:
+    typedef struct
+    {
+        qint64 startTime;
+        qint64 latency; // 收到响应头的耗时，-1 表示不计
+        qint64 bytes;
+    } RequestStat;
+
+    QHash<QNetworkReply*, int> _replyShards;
+    QMap<QNetworkReply*, Client::Operation> _operationMap;
+    QHash<QNetworkReply*, RequestStat> _requestStats;
+    QHash<QNetworkReply*, QStringHash> _objectHash;
+    QHash<QNetworkReply*, QStringHash> _extraHash;
+    QSet<QNetworkReply*> _pacedReplies;
+
+    double _uploadRate = 0;
+    qint64 _recordedBytes = 0;
+
+    void _putObject(QNetworkReply *reply, const Client::Job &job, const QStringHash &resources, qint64 fileSize);
+    void _trackReply(QNetworkReply *reply,
+                     qint64 bodySize,
+                     const Client::Action &action,
+                     const QStringHash &resources,
+                     const Client::Operation &operation,
+                     const QStringHash &extras);
+    void _requestFinished(QNetworkReply *reply);
+    void _recordRequest(QNetworkReply *reply);
+    void _putObjectHandler(QNetworkReply *reply);
+    void _updateUploadRate(qint64 bytes, const QStringHash &extras);
+};
+
+// 当前的记录方式，与 Client 中对应函数的写法相同
+class RequestContextBenchmark::ContextClient
+{
+public:
+    const QString METHOD_PUT = "PUT";
+
+    QHash<QNetworkReply*, Client::Request> _requests;
+
+    double _uploadRate = 0;
+    qint64 _recordedBytes = 0;
+
+    void _putObject(QNetworkReply *reply, const Client::Job &job, const QStringHash &resources, qint64 fileSize);
+    void _trackReply(QNetworkReply *reply, const Client::Request &request);
+    void _requestFinished(QNetworkReply *reply);
+    void _recordRequest(QNetworkReply *reply, const Client::Request &request);
+    void _putObjectHandler(QNetworkReply *reply, const Client::Request &request);
+    void _updateUploadRate(qint64 bytes, qint64 startTime);
+};
+
+void RequestContextBenchmark::initTestCase()
+{
+    _jobs.reserve(RequestCount);
+    _resources.reserve(RequestCount);
+
+    for (int i = 0; i < RequestCount; ++i)
+    {
+        PutObjectParams params = {
+            .objectKey = QString("photos/2024/相册/IMG_%1.jpg").arg(i, 6, 10, QChar('0')),
+            .filePath = QString("/home/user/Pictures/相册/IMG_%1.jpg").arg(i, 6, 10, QChar('0')),
+            .fileSize = 4096 + i
+        };
+
+        _jobs.append(Client::Job(Client::putObjectOperation, QVariant::fromValue(params)));
+        _resources.append(Client::_objectResources("benchmark-bucket", params.objectKey));
+    }
+}
+
+// _run 发出、处理 count 个请求，返回上传速度，避免被优化掉
+template <class Recorder>
+double RequestContextBenchmark::_run(Recorder &recorder, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        QNetworkReply *reply = reinterpret_cast<QNetworkReply*>(quintptr(i + 1));
+        const Client::Job &job = _jobs.at(i);
+
+        recorder._putObject(reply, job, _resources.at(i), job.params.value<PutObjectParams>().fileSize);
+        recorder._requestFinished(reply);
+    }
+
+    return recorder._uploadRate;
+}
+
+void RequestContextBenchmark::legacyTables()
+{
+    LegacyClient recorder;
+
+    QBENCHMARK {
+        _run(recorder, RequestCount);
+    }
+
+    QVERIFY(recorder._operationMap.isEmpty());
+    QVERIFY(recorder._requestStats.isEmpty());
+    QVERIFY(recorder._extraHash.isEmpty());
+}
+
+void RequestContextBenchmark::requestContext()
+{
+    ContextClient recorder;
+
+    QBENCHMARK {
+        _run(recorder, RequestCount);
+    }
+
+    QVERIFY(recorder._requests.isEmpty());
+}
+
+void RequestContextBenchmark::allocations()
+{
+    if (!AllocationCounter::isSupported()) QSKIP("allocation counting needs glibc");
+
+    LegacyClient legacyRecorder;
+    ContextClient contextRecorder;
+
+    // 先各跑一遍，让表的桶数组分配好，只统计每个请求自身的分配
+    _run(legacyRecorder, RequestCount);
+    _run(contextRecorder, RequestCount);
+
+    quint64 start = AllocationCounter::count();
+    _run(legacyRecorder, RequestCount);
+    quint64 legacy = AllocationCounter::count() - start;
+
+    start = AllocationCounter::count();
+    _run(contextRecorder, RequestCount);
+    quint64 context = AllocationCounter::count() - start;
+
+    qInfo("allocations per request: %.2f before, %.2f after",
+          double(legacy) / RequestCount, double(context) / RequestCount);
+
+    QVERIFY2(context < legacy, qPrintable(QString("%1 >= %2").arg(context).arg(legacy)));
+}
+
+// RequestContextBenchmark::LegacyClient
+
+// _putObject 小文件分支，MD5 算好之后发送
+void RequestContextBenchmark::LegacyClient::_putObject(QNetworkReply *reply, const Client::Job &job, const QStringHash &resources, qint64 fileSize)
+{
+    PutObjectParams params = job.params.value<PutObjectParams>();
+
+    QStringHash extras = {
+        { "objectKey", params.objectKey },
+        { "filePath", params.filePath },
+        { "fileSize", QString::number(params.fileSize) }
+    };
+
+    extras.insert("bodySize", QString::number(fileSize));
+
+    QStringHash sendExtras = extras;
+    sendExtras.insert("startTime", QString::number(QDateTime::currentMSecsSinceEpoch()));
+
+    // _sendRequest
+    _trackReply(reply, fileSize, Client::objectAction, resources, Client::putObjectOperation, sendExtras);
+}
+
+void RequestContextBenchmark::LegacyClient::_trackReply(QNetworkReply *reply,
+                                                        qint64 bodySize,
+                                                        const Client::Action &action,
+                                                        const QStringHash &resources,
+                                                        const Client::Operation &operation,
+                                                        const QStringHash &extras)
+{
+    _operationMap.insert(reply, operation);
+
+    RequestStat stat = {
+        .startTime = QDateTime::currentMSecsSinceEpoch(),
+        .latency = -1,
+        .bytes = bodySize
+    };
+
+    _requestStats.insert(reply, stat);
+
+    QStringHash params;
+
+    if (action == Client::objectAction)
+    {
+        params.insert("objectKey", resources["object"]);
+
+        if (operation == Client::uploadPartOperation)
+        {
+            params.insert("partNumber", resources["partNumber"]);
+            params.insert("uploadId", resources["uploadId"]);
+        }
+
+        _objectHash.insert(reply, params);
+    }
+
+    if (extras.size() > 0) _extraHash.insert(reply, extras);
+}
+
+void RequestContextBenchmark::LegacyClient::_requestFinished(QNetworkReply *reply)
+{
+    Client::Operation operation = _operationMap.value(reply);
+
+    _recordRequest(reply);
+
+    switch (operation)
+    {
+    case Client::putObjectOperation: _putObjectHandler(reply); break;
+    default: break;
+    }
+
+    _operationMap.remove(reply);
+    _pacedReplies.remove(reply);
+
+    if (_replyShards.contains(reply)) _replyShards.take(reply);
+}
+
+void RequestContextBenchmark::LegacyClient::_recordRequest(QNetworkReply *reply)
+{
+    RequestStat stat = _requestStats.take(reply);
+
+    // 交给并发控制的部分换成累加
+    _recordedBytes += stat.bytes;
+}
+
+void RequestContextBenchmark::LegacyClient::_putObjectHandler(QNetworkReply *reply)
+{
+    QStringHash headers;
+    QStringHash params = _objectHash.value(reply);
+    QStringHash extras = _extraHash.value(reply);
+
+    params.insert("objectKey", extras["objectKey"]);
+    params.insert("filePath", extras["filePath"]);
+    params.insert("fileSize", extras["fileSize"]);
+
+    _extraHash.remove(reply);
+    _objectHash.remove(reply);
+
+    _updateUploadRate(extras["bodySize"].toLongLong(), extras);
+}
+
+void RequestContextBenchmark::LegacyClient::_updateUploadRate(qint64 bytes, const QStringHash &extras)
+{
+    qint64 elapsed = QDateTime::currentMSecsSinceEpoch() - extras["startTime"].toLongLong();
+
+    // 小请求主要是往返延迟，不能反映带宽
+    if (bytes < Client::MinPartSize || elapsed <= 0) return;
+
+    double rate = static_cast<double>(bytes) / elapsed;
+
+    _uploadRate = _uploadRate > 0 ? _uploadRate * 0.7 + rate * 0.3 : rate;
+}
+
+// RequestContextBenchmark::ContextClient
+
+// _putObject 小文件分支，MD5 算好之后发送
+void RequestContextBenchmark::ContextClient::_putObject(QNetworkReply *reply, const Client::Job &job, const QStringHash &resources, qint64 fileSize)
+{
+    PutObjectParams params = job.params.value<PutObjectParams>();
+
+    RequestContext context(params.objectKey, params.filePath, params.fileSize);
+    context.attempt = job.attempt;
+
+    // _sendRequest
+    Client::Request request = {
+        .operation = Client::putObjectOperation,
+        .context = context,
+        .job = job,
+        .method = METHOD_PUT,
+        .headers = QStringHash(),
+        .body = QByteArray(),
+        .action = Client::objectAction,
+        .resources = resources,
+        .file = nullptr,
+        .paced = false,
+        .bodySize = fileSize,
+        .startTime = QDateTime::currentMSecsSinceEpoch(),
+        .latency = -1,
+        .bytes = fileSize,
+        .activeTime = -1,
+        .stall = QString(),
+        .error = QNetworkReply::NoError,
+        .readKey = job.readKey
+    };
+
+    _trackReply(reply, request);
+}
+
+void RequestContextBenchmark::ContextClient::_trackReply(QNetworkReply *reply, const Client::Request &request)
+{
+    _requests.insert(reply, request);
+}
+
+void RequestContextBenchmark::ContextClient::_requestFinished(QNetworkReply *reply)
+{
+    // 请求的全部信息一次取出，交给各处理函数
+    Client::Request request = _requests.take(reply);
+
+    _recordRequest(reply, request);
+
+    switch (request.operation)
+    {
+    case Client::putObjectOperation: _putObjectHandler(reply, request); break;
+    default: break;
+    }
+}
+
+void RequestContextBenchmark::ContextClient::_recordRequest(QNetworkReply *, const Client::Request &request)
+{
+    // 交给并发控制的部分换成累加
+    _recordedBytes += request.bytes;
+}
+
+void RequestContextBenchmark::ContextClient::_putObjectHandler(QNetworkReply *, const Client::Request &request)
+{
+    QStringHash headers;
+    QStringHash params = Client::_objectParams(request.context);
+
+    _updateUploadRate(request.bodySize, request.startTime);
+}
+
+void RequestContextBenchmark::ContextClient::_updateUploadRate(qint64 bytes, qint64 startTime)
+{
+    qint64 elapsed = QDateTime::currentMSecsSinceEpoch() - startTime;
+
+    // 小请求主要是往返延迟，不能反映带宽
+    if (bytes < Client::MinPartSize || elapsed <= 0) return;
+
+    double rate = static_cast<double>(bytes) / elapsed;
+
+    _uploadRate = _uploadRate > 0 ? _uploadRate * 0.7 + rate * 0.3 : rate;
+}
+
+QTEST_GUILESS_MAIN(RequestContextBenchmark)
+
+#include "tst_requestcontext.moc"
@@ -0,0 +1,15 @@
+include(../tests.pri)
+include(../client.pri)
+
+# 对照用的 QDomDocument 实现
+QT += xml
+
+TARGET = tst_responseparser
+
+HEADERS += \
+    ../allocationcounter.h \
+    ../movetothread.h
+
+SOURCES += \
+    ../allocationcounter.cpp \
+    tst_responseparser.cpp
@@ -0,0 +1,354 @@
+#include <QtTest>
+#include <QLoggingCategory>
+#include <QDomDocument>
+
+#include "allocationcounter.h"
+#include "client.h"
+#include "movetothread.h"
+
+// 列举对象、列举分块响应的解析：原来的 QDomDocument 实现与当前的 QXmlStreamReader 实现比较耗时和堆分配次数
+// 响应按 NOS 返回的格式生成，每页 1000 条，对象名含中文和多级目录
+
+static const int EntryCount = 1000;
+
+class ResponseParserBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void sameResult();
+
+    void parse_data();
+    void parse();
+
+    void allocations();
+
+private:
+    Client *_client = nullptr;
+    QThread *_clientThread = nullptr;
+    QByteArray _listObject;
+    QByteArray _listParts;
+
+    bool _parse(const QString &corpus, bool dom);
+
+    static bool _domListObject(const QByteArray &data, QStringHash &params, QStringVector &dirs, QVector<File> &files);
+    static bool _domListParts(const QByteArray &data, QHash<QString, QVariant> &params, QList<QHash<QString, QVariant>> &parts);
+};
+
+void ResponseParserBenchmark::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+
+    QLoggingCategory::setFilterRules("default.debug=false");
+
+    _client = new Client;
+    _clientThread = _client->_thread;
+
+    moveToCurrentThread(_client);
+
+    // 一页对象列表：前 20 条是子目录，其余是文件
+    QByteArray list = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<ListBucketResult>"
+                      "<Name>photos</Name><Prefix>2024/家庭相册/</Prefix><Marker></Marker>"
+                      "<NextMarker>2024/家庭相册/合影 000999.jpg</NextMarker>"
+                      "<MaxKeys>1000</MaxKeys><Delimiter>/</Delimiter><IsTruncated>true</IsTruncated>";
+
+    for (int i = 0; i < 20; ++i)
+        list += QString("<CommonPrefixes><Prefix>2024/家庭相册/第 %1 组/</Prefix></CommonPrefixes>").arg(i).toUtf8();
+
+    for (int i = 20; i < EntryCount; ++i)
+    {
+        list += QString("<Contents>"
+                        "<Key>2024/家庭相册/合影 %1.jpg</Key>"
+                        "<LastModified>2024-10-16T08:%2:%3 +0800</LastModified>"
+                        "<Etag>%4</Etag>"
+                        "<Size>%5</Size>"
+                        "<StorageClass>STANDARD</StorageClass>"
+                        "</Contents>")
+                .arg(i, 6, 10, QChar('0'))
+                .arg(i / 60 % 60, 2, 10, QChar('0'))
+                .arg(i % 60, 2, 10, QChar('0'))
+                .arg(QString(QCryptographicHash::hash(QByteArray::number(i), QCryptographicHash::Md5).toHex()))
+                .arg(1048576 + i * 4096)
+                .toUtf8();
+    }
+
+    _listObject = list + "</ListBucketResult>";
+
+    // 一页分块列表
+    QByteArray parts = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                       "<ListPartsResult>"
+                       "<Bucket>videos</Bucket><Key>2024/家庭录像/婚礼 全程.mp4</Key><UploadId>8f3c2a9d1e</UploadId>"
+                       "<Owner><ID>1234567890</ID><DisplayName>用户</DisplayName></Owner>"
+                       "<StorageClassName>STANDARD</StorageClassName>"
+                       "<PartNumberMarker>0</PartNumberMarker><NextPartNumberMarker>1000</NextPartNumberMarker>"
+                       "<MaxParts>1000</MaxParts><IsTruncated>true</IsTruncated>";
+
+    for (int i = 1; i <= EntryCount; ++i)
+    {
+        parts += QString("<Part>"
+                         "<PartNumber>%1</PartNumber>"
+                         "<LastModified>2024-10-16T08:00:00 +0800</LastModified>"
+                         "<ETag>%2</ETag>"
+                         "<Size>10485760</Size>"
+                         "</Part>")
+                 .arg(i)
+                 .arg(QString(QCryptographicHash::hash(QByteArray::number(i), QCryptographicHash::Md5).toHex()))
+                 .toUtf8();
+    }
+
+    _listParts = parts + "</ListPartsResult>";
+}
+
+void ResponseParserBenchmark::cleanupTestCase()
+{
+    delete _client;
+    _client = nullptr;
+
+    _clientThread->wait();
+
+    delete _clientThread;
+    _clientThread = nullptr;
+}
+
+// 两种实现的解析结果相同
+void ResponseParserBenchmark::sameResult()
+{
+    QStringHash domParams, streamParams;
+    QStringVector domDirs, streamDirs;
+    QVector<File> domFiles, streamFiles;
+
+    QVERIFY(_domListObject(_listObject, domParams, domDirs, domFiles));
+    QVERIFY(_client->_parseListObject(_listObject, streamParams, streamDirs, streamFiles));
+
+    QCOMPARE(streamParams, domParams);
+    QCOMPARE(streamDirs, domDirs);
+    QCOMPARE(streamFiles.count(), domFiles.count());
+
+    for (int i = 0; i < domFiles.count(); ++i)
+    {
+        QCOMPARE(streamFiles.at(i).key, domFiles.at(i).key);
+        QCOMPARE(streamFiles.at(i).size, domFiles.at(i).size);
+        QCOMPARE(streamFiles.at(i).lastModified, domFiles.at(i).lastModified);
+    }
+
+    QHash<QString, QVariant> domPartParams, streamPartParams;
+    QList<QHash<QString, QVariant>> domParts, streamParts;
+
+    QVERIFY(_domListParts(_listParts, domPartParams, domParts));
+    QVERIFY(_client->_parseListParts(_listParts, streamPartParams, streamParts));
+
+    QCOMPARE(streamPartParams, domPartParams);
+    QCOMPARE(streamParts, domParts);
+}
+
+void ResponseParserBenchmark::parse_data()
+{
+    QTest::addColumn<QString>("corpus");
+    QTest::addColumn<bool>("dom");
+
+    foreach (const QString &corpus, QStringList({ "list objects", "list parts" }))
+    {
+        QTest::newRow(qPrintable(corpus + ", DOM")) << corpus << true;
+        QTest::newRow(qPrintable(corpus + ", stream")) << corpus << false;
+    }
+}
+
+void ResponseParserBenchmark::parse()
+{
+    QFETCH(QString, corpus);
+    QFETCH(bool, dom);
+
+    qint64 size = corpus == "list objects" ? _listObject.size() : _listParts.size();
+    qint64 total = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+
+    QBENCHMARK {
+        QVERIFY(_parse(corpus, dom));
+
+        total += size;
+    }
+
+    qint64 elapsed = timer.elapsed();
+
+    qInfo("%s: %.1f MB/s", QTest::currentDataTag(), total * 1000.0 / 1048576 / qMax<qint64>(elapsed, 1));
+}
+
+void ResponseParserBenchmark::allocations()
+{
+    if (!AllocationCounter::isSupported()) QSKIP("allocation counting needs glibc");
+
+    foreach (const QString &corpus, QStringList({ "list objects", "list parts" }))
+    {
+        quint64 start = AllocationCounter::count();
+        QVERIFY(_parse(corpus, true));
+        quint64 dom = AllocationCounter::count() - start;
+
+        start = AllocationCounter::count();
+        QVERIFY(_parse(corpus, false));
+        quint64 stream = AllocationCounter::count() - start;
+
+        qInfo("%s: %llu allocations with DOM, %llu with stream", qPrintable(corpus), dom, stream);
+
+        QVERIFY2(stream < dom, qPrintable(QString("%1: %2 >= %3").arg(corpus).arg(stream).arg(dom)));
+    }
+}
+
+// _parse 解析一页响应，结果随即丢弃
+bool ResponseParserBenchmark::_parse(const QString &corpus, bool dom)
+{
+    if (corpus == "list objects")
+    {
+        QStringHash params;
+        QStringVector dirs;
+        QVector<File> files;
+
+        return dom ? _domListObject(_listObject, params, dirs, files)
+                   : _client->_parseListObject(_listObject, params, dirs, files);
+    }
+
+    QHash<QString, QVariant> params;
+    QList<QHash<QString, QVariant>> parts;
+
+    return dom ? _domListParts(_listParts, params, parts) : _client->_parseListParts(_listParts, params, parts);
+}
+
+// _domListObject 原来 _listObjectHandler 中的解析
+bool ResponseParserBenchmark::_domListObject(const QByteArray &data, QStringHash &params, QStringVector &dirs, QVector<File> &files)
+{
+    QDomDocument doc;
+
+    if (!doc.setContent(data)) return false;
+
+    QDomElement root = doc.documentElement();
+    QDomNode node = root.firstChild();
+
+    while (!node.isNull())
+    {
+        if (node.isElement())
+        {
+            if (node.nodeName() == "Prefix") params.insert("prefix", node.toElement().text());
+            if (node.nodeName() == "Marker") params.insert("marker", node.toElement().text());
+            if (node.nodeName() == "NextMarker") params.insert("nextMarker", node.toElement().text());
+            if (node.nodeName() == "MaxKeys") params.insert("maxKeys", node.toElement().text());
+            if (node.nodeName() == "IsTruncated") params.insert("isTruncated", node.toElement().text());
+
+            if (node.nodeName() == "CommonPrefixes")
+            {
+                QDomNodeList childNodes = node.childNodes();
+                QDomNode child = childNodes.at(0);
+
+                if (child.isElement()) dirs.append(child.toElement().text());
+            }
+
+            if (node.nodeName() == "Contents")
+            {
+                QDomNodeList childNodes = node.childNodes();
+
+                File file;
+
+                for (int i = 0; i < childNodes.count(); ++i)
+                {
+                    QDomNode child = childNodes.at(i);
+
+                    if (child.isElement())
+                    {
+                        if (child.nodeName() == "Key") file.key = child.toElement().text();
+                        if (child.nodeName() == "Size") file.size = child.toElement().text().toULongLong();
+                        if (child.nodeName() == "LastModified")
+                        {
+                            QString lastModified = child.toElement().text();
+
+                            file.lastModified = lastModified.replace("T", " ").replace(" +0800", "");
+                        }
+                    }
+                }
+
+                files.append(file);
+            }
+        }
+
+        node = node.nextSibling();
+    }
+
+    return true;
+}
+
+// _domListParts 原来的 Client::_parseListParts
+bool ResponseParserBenchmark::_domListParts(const QByteArray &data, QHash<QString, QVariant> &params, QList<QHash<QString, QVariant>> &parts)
+{
+    QDomDocument doc;
+
+    if (!doc.setContent(data)) return false;
+
+    QDomElement root = doc.documentElement();
+    QDomNode node = root.firstChild();
+
+    while (!node.isNull())
+    {
+        if (node.isElement())
+        {
+            if (node.nodeName() == "Bucket") params.insert("bucket", node.toElement().text());
+            if (node.nodeName() == "Key") params.insert("key", node.toElement().text());
+            if (node.nodeName() == "UploadId") params.insert("uploadId", node.toElement().text());
+            if (node.nodeName() == "StorageClassName") params.insert("storageClassName", node.toElement().text());
+            if (node.nodeName() == "PartNumberMarker") params.insert("partNumberMarker", node.toElement().text());
+            if (node.nodeName() == "NextPartNumberMarker") params.insert("nextPartNumberMarker", node.toElement().text());
+            if (node.nodeName() == "MaxParts") params.insert("maxParts", node.toElement().text());
+            if (node.nodeName() == "IsTruncated") params.insert("isTruncated", node.toElement().text());
+
+            if (node.nodeName() == "Owner")
+            {
+                QHash<QString, QVariant> owner;
+
+                QDomNodeList childNodes = node.childNodes();
+
+                for (int i = 0; i < childNodes.count(); ++i)
+                {
+                    QDomNode child = childNodes.at(i);
+
+                    if (!child.isElement()) continue;
+
+                    if (child.nodeName() == "ID") owner.insert("id", child.toElement().text());
+                    if (child.nodeName() == "DisplayName") owner.insert("displayName", child.toElement().text());
+                }
+
+                params.insert("owner", owner);
+            }
+
+            if (node.nodeName() == "Part")
+            {
+                QDomNodeList childNodes = node.childNodes();
+
+                QHash<QString, QVariant> part;
+
+                for (int i = 0; i < childNodes.count(); ++i)
+                {
+                    QDomNode child = childNodes.at(i);
+
+                    if (!child.isElement()) continue;
+
+                    if (child.nodeName() == "PartNumber") part.insert("partNumber", child.toElement().text());
+                    if (child.nodeName() == "LastModified") part.insert("lastModified", child.toElement().text());
+                    if (child.nodeName() == "ETag") part.insert("etag", child.toElement().text());
+                    if (child.nodeName() == "Size") part.insert("size", child.toElement().text());
+                }
+
+                parts.append(part);
+            }
+        }
+
+        node = node.nextSibling();
+    }
+
+    return true;
+}
+
+QTEST_GUILESS_MAIN(ResponseParserBenchmark)
+
+#include "tst_responseparser.moc"
@@ -0,0 +1,12 @@
+include(../tests.pri)
+include(../client.pri)
+
+TARGET = tst_signer
+
+HEADERS += \
+    ../../cdn.h \
+    ../movetothread.h
+
+SOURCES += \
+    ../../cdn.cpp \
+    tst_signer.cpp
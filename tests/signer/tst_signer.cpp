@@ -0,0 +1,348 @@
+#include <QtTest>
+#include <QLoggingCategory>
+#include <QNetworkRequest>
+
+#include "cdn.h"
+#include "client.h"
+#include "percentencoder.h"
+#include "signer.h"
+#include "movetothread.h"
+
+// NOS、NCDN 请求签名的固定向量
+// 期望值按重构前的实现（QStringList 拼接、QUrl::toPercentEncoding 编码对象名）独立算出，
+// 覆盖常用方法、复制、CDN 刷新，以及中文、~、空格和 uploadId、partNumber、delete 等子资源
+
+static const QString AccessKey = "0123456789abcdef";
+static const QString AccessSecret = "fedcba9876543210fedcba9876543210";
+static const QByteArray Date = "Wed, 16 Oct 2024 08:00:00 GMT";
+
+static const int BenchmarkCount = 10000;
+
+class SignerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void nos_data();
+    void nos();
+
+    void ncdn_data();
+    void ncdn();
+
+    void signing_data();
+    void signing();
+
+private:
+    Client *_client = nullptr;
+    QThread *_clientThread = nullptr;
+    CDN *_cdn = nullptr;
+    QThread *_cdnThread = nullptr;
+
+    QNetworkRequest _nosRequest(Client::Action action,
+                                const QString &bucket,
+                                const QString &objectKey,
+                                const QStringHash &params,
+                                const QByteArray &contentMd5,
+                                const QString &contentType,
+                                const QString &copySource,
+                                QStringMap &nosHeaders,
+                                QStringHash &resources);
+};
+
+void SignerTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+
+    QLoggingCategory::setFilterRules("default.debug=false");
+
+    Account account("signer", "nos-eastchina1.126.net", AccessKey, AccessSecret);
+
+    _client = new Client;
+    _clientThread = _client->_thread;
+
+    moveToCurrentThread(_client);
+
+    _client->setAccount(account);
+
+    _cdn = new CDN;
+    _cdnThread = _cdn->_thread;
+
+    moveToCurrentThread(_cdn);
+
+    _cdn->setAccount(account);
+}
+
+void SignerTest::cleanupTestCase()
+{
+    delete _client;
+    _client = nullptr;
+
+    delete _cdn;
+    _cdn = nullptr;
+
+    foreach (QThread *thread, QList<QThread*>({ _clientThread, _cdnThread }))
+    {
+        thread->wait();
+
+        delete thread;
+    }
+}
+
+void SignerTest::nos_data()
+{
+    QTest::addColumn<QString>("method");
+    QTest::addColumn<int>("action");
+    QTest::addColumn<QString>("bucket");
+    QTest::addColumn<QString>("objectKey");
+    QTest::addColumn<QStringHash>("params");
+    QTest::addColumn<QByteArray>("contentMd5");
+    QTest::addColumn<QString>("contentType");
+    QTest::addColumn<QString>("copySource");
+    QTest::addColumn<QByteArray>("canonicalString");
+    QTest::addColumn<QByteArray>("authorization");
+
+    const QByteArray md5 = "9e107d9d372bb6826bd81d3542a419d6";
+
+    QTest::newRow("GET service")
+        << "GET" << int(Client::listBucketAction) << "" << "" << QStringHash() << QByteArray() << "" << ""
+        << QByteArray("GET\n\n\nWed, 16 Oct 2024 08:00:00 GMT\n/")
+        << QByteArray("NOS 0123456789abcdef:zju31qyfWzO2AHOy5chiyM7pfZ7GqVYYrVCTii6NQOA=");
+
+    QTest::newRow("GET bucket")
+        << "GET" << int(Client::bucketAction) << "photos" << ""
+        << QStringHash({ { "prefix", "2024/相册/" }, { "delimiter", "/" }, { "max-keys", "1000" } })
+        << QByteArray() << "" << ""
+        << QByteArray("GET\n\n\nWed, 16 Oct 2024 08:00:00 GMT\n/photos/")
+        << QByteArray("NOS 0123456789abcdef:E0oNZZV3vof/Ct9kzXe9wviTHALTcvpc6pfT3kIfuXQ=");
+
+    QTest::newRow("GET object")
+        << "GET" << int(Client::objectAction) << "photos" << "2024/相册/IMG 0001.jpg" << QStringHash() << QByteArray() << "" << ""
+        << QByteArray("GET\n\n\nWed, 16 Oct 2024 08:00:00 GMT\n/photos/2024%2F%E7%9B%B8%E5%86%8C%2FIMG%200001.jpg")
+        << QByteArray("NOS 0123456789abcdef:UAcVushhgZ5SQ9clVJ4xohb9nl1M5Qf2XlisQyvDqtQ=");
+
+    QTest::newRow("PUT object")
+        << "PUT" << int(Client::objectAction) << "docs" << "report~final v2.txt" << QStringHash() << md5 << "text/plain" << ""
+        << QByteArray("PUT\n9e107d9d372bb6826bd81d3542a419d6\ntext/plain\nWed, 16 Oct 2024 08:00:00 GMT\n/docs/report%7Efinal%20v2.txt")
+        << QByteArray("NOS 0123456789abcdef:FzxUwxNCIhmOnek2ZH5LhfO795O+FoVtV5tPIzL9s5s=");
+
+    QTest::newRow("HEAD object")
+        << "HEAD" << int(Client::objectAction) << "docs" << "a b/c+d=e&f.jpg" << QStringHash() << QByteArray() << "" << ""
+        << QByteArray("HEAD\n\n\nWed, 16 Oct 2024 08:00:00 GMT\n/docs/a%20b%2Fc%2Bd%3De%26f.jpg")
+        << QByteArray("NOS 0123456789abcdef:+APrgu//Vav6a0fx/bGt0aBRIZe2Vj1Uar+yTLxRo14=");
+
+    QTest::newRow("DELETE object")
+        << "DELETE" << int(Client::objectAction) << "docs" << "目录/" << QStringHash() << QByteArray() << "" << ""
+        << QByteArray("DELETE\n\n\nWed, 16 Oct 2024 08:00:00 GMT\n/docs/%E7%9B%AE%E5%BD%95%2F")
+        << QByteArray("NOS 0123456789abcdef:J2lI96rmFHkuHHb7o1cI8xKw3AYWfOGszr9J0WqGCCA=");
+
+    QTest::newRow("PUT copy")
+        << "PUT" << int(Client::objectAction) << "src-bucket" << "备份/a~b.txt" << QStringHash() << QByteArray()
+        << "application/octet-stream" << "/src-bucket/源 文件~1.txt"
+        << QByteArray("PUT\n\napplication/octet-stream\nWed, 16 Oct 2024 08:00:00 GMT\n"
+                      "x-nos-copy-source:%2Fsrc-bucket%2F%E6%BA%90%20%E6%96%87%E4%BB%B6~1.txt\n"
+                      "/src-bucket/%E5%A4%87%E4%BB%BD%2Fa%7Eb.txt")
+        << QByteArray("NOS 0123456789abcdef:v6tbqREJDenEv2tqnJ1V5wLethVaUIuh7k2vIxCenEM=");
+
+    QTest::newRow("PUT upload part")
+        << "PUT" << int(Client::objectAction) << "videos" << "video/big file.mp4"
+        << QStringHash({ { "partNumber", "3" }, { "uploadId", "a1b2c3" } }) << md5 << "video/mp4" << ""
+        << QByteArray("PUT\n9e107d9d372bb6826bd81d3542a419d6\nvideo/mp4\nWed, 16 Oct 2024 08:00:00 GMT\n"
+                      "/videos/video%2Fbig%20file.mp4?partNumber=3&uploadId=a1b2c3")
+        << QByteArray("NOS 0123456789abcdef:lO9FQTmAmmOzOTOf3WkJHe7TRZqpAauhAxVZ8k9og6M=");
+
+    QTest::newRow("POST initiate upload")
+        << "POST" << int(Client::objectAction) << "videos" << "video/big file.mp4"
+        << QStringHash({ { "uploads", "" } }) << QByteArray() << "video/mp4" << ""
+        << QByteArray("POST\n\nvideo/mp4\nWed, 16 Oct 2024 08:00:00 GMT\n/videos/video%2Fbig%20file.mp4?uploads")
+        << QByteArray("NOS 0123456789abcdef:haUDsPQ1Ach375eXv3iiTcdofQqqcPRG4PnMWIfsqIQ=");
+
+    QTest::newRow("GET list parts")
+        << "GET" << int(Client::objectAction) << "videos" << "video/big file.mp4"
+        << QStringHash({ { "uploadId", "a1b2c3" }, { "max-parts", "1000" }, { "part-number-marker", "2" } })
+        << QByteArray() << "video/mp4" << ""
+        << QByteArray("GET\n\nvideo/mp4\nWed, 16 Oct 2024 08:00:00 GMT\n/videos/video%2Fbig%20file.mp4?uploadId=a1b2c3")
+        << QByteArray("NOS 0123456789abcdef:Tu4w9NcFr+iBo2vCs8eZiQlp+Zho5yf8lg+hoh8rHgE=");
+
+    QTest::newRow("POST delete objects")
+        << "POST" << int(Client::bucketAction) << "docs" << "" << QStringHash({ { "delete", "" } }) << md5 << "" << ""
+        << QByteArray("POST\n9e107d9d372bb6826bd81d3542a419d6\n\nWed, 16 Oct 2024 08:00:00 GMT\n/docs/?delete")
+        << QByteArray("NOS 0123456789abcdef:p6+PmdWwtUYO5BG7U+HTlnh58xrd8aoITPOmgPz0k+k=");
+}
+
+void SignerTest::nos()
+{
+    QFETCH(QString, method);
+    QFETCH(int, action);
+    QFETCH(QString, bucket);
+    QFETCH(QString, objectKey);
+    QFETCH(QStringHash, params);
+    QFETCH(QByteArray, contentMd5);
+    QFETCH(QString, contentType);
+    QFETCH(QString, copySource);
+    QFETCH(QByteArray, canonicalString);
+    QFETCH(QByteArray, authorization);
+
+    QStringMap nosHeaders;
+    QStringHash resources;
+
+    QNetworkRequest request = _nosRequest(Client::Action(action), bucket, objectKey, params,
+                                          contentMd5, contentType, copySource, nosHeaders, resources);
+
+    _client->_signRequest(method, request, nosHeaders, Client::Action(action), resources);
+
+    QCOMPARE(_client->_signBuffer, canonicalString);
+    QCOMPARE(request.rawHeader("authorization"), authorization);
+}
+
+void SignerTest::ncdn_data()
+{
+    QTest::addColumn<QString>("method");
+    QTest::addColumn<int>("operation");
+    QTest::addColumn<QStringHash>("resources");
+    QTest::addColumn<QString>("contentType");
+    QTest::addColumn<QByteArray>("canonicalString");
+    QTest::addColumn<QByteArray>("authorization");
+
+    QTest::newRow("purge")
+        << "POST" << int(CDN::purgeOperation) << QStringHash({ { "domain", "cdn.example.com" } })
+        << "application/json;charset=UTF-8"
+        << QByteArray("POST\n\napplication/json;charset=UTF-8\nWed, 16 Oct 2024 08:00:00 GMT\n/domain/cdn.example.com/purge")
+        << QByteArray("NCDN 0123456789abcdef:E87ij+NnqmUWftttJIw8zFpV3ZbYMW4urz7N4KZFRAs=");
+
+    QTest::newRow("purge status")
+        << "GET" << int(CDN::getPurgeStatusOperation) << QStringHash({ { "domain", "cdn.example.com" }, { "id", "8f3c2a" } })
+        << ""
+        << QByteArray("GET\n\n\nWed, 16 Oct 2024 08:00:00 GMT\n/domain/cdn.example.com/purge/8f3c2a")
+        << QByteArray("NCDN 0123456789abcdef:1M2HzdTf5pU+3fe2t2MAQxih/HhLSJd7Jhr5xwSmmIU=");
+
+    QTest::newRow("list purge")
+        << "GET" << int(CDN::listPurgeOperation)
+        << QStringHash({ { "domain", "cdn.example.com" }, { "pageNum", "2" }, { "pageSize", "20" } })
+        << ""
+        << QByteArray("GET\n\n\nWed, 16 Oct 2024 08:00:00 GMT\n/domain/cdn.example.com/purge?pageNum=2&pageSize=20")
+        << QByteArray("NCDN 0123456789abcdef:II86ZHu+6+PadGQq4+Ufn8I3iCQnep4RK577GookSCE=");
+}
+
+void SignerTest::ncdn()
+{
+    QFETCH(QString, method);
+    QFETCH(int, operation);
+    QFETCH(QStringHash, resources);
+    QFETCH(QString, contentType);
+    QFETCH(QByteArray, canonicalString);
+    QFETCH(QByteArray, authorization);
+
+    QNetworkRequest request(QUrl("http://ncdn-eastchina1.126.net"));
+
+    request.setRawHeader("date", Date);
+
+    if (!contentType.isEmpty()) request.setHeader(QNetworkRequest::ContentTypeHeader, contentType);
+
+    _cdn->_signRequest(method, request, CDN::Operation(operation), resources);
+
+    // CDN 不保留待签名字符串，只能核对签名；待签名字符串单独按 Signer 的结果核对
+    QCOMPARE(Signer::signature(canonicalString, AccessSecret.toUtf8()), authorization.mid(authorization.indexOf(':') + 1));
+    QCOMPARE(request.rawHeader("authorization"), authorization);
+}
+
+void SignerTest::signing_data()
+{
+    QTest::addColumn<bool>("cdn");
+
+    QTest::newRow("NOS") << false;
+    QTest::newRow("NCDN") << true;
+}
+
+// 签名本身的吞吐量，不含请求头的构造
+void SignerTest::signing()
+{
+    QFETCH(bool, cdn);
+
+    QStringMap nosHeaders;
+    QStringHash resources;
+
+    QNetworkRequest request = _nosRequest(Client::objectAction, "videos", "video/2024/第 1 组/big file~1.mp4",
+                                          QStringHash({ { "partNumber", "3" }, { "uploadId", "a1b2c3" } }),
+                                          "9e107d9d372bb6826bd81d3542a419d6", "video/mp4", "", nosHeaders, resources);
+
+    QStringHash cdnResources = { { "domain", "cdn.example.com" }, { "pageNum", "2" }, { "pageSize", "20" } };
+    QNetworkRequest cdnRequest(QUrl("http://ncdn-eastchina1.126.net"));
+    cdnRequest.setRawHeader("date", Date);
+
+    QElapsedTimer timer;
+    int count = 0;
+
+    timer.start();
+
+    QBENCHMARK {
+        for (int i = 0; i < BenchmarkCount; ++i)
+        {
+            // 签名会在 URL 后追加查询参数，每次从原样的请求开始
+            if (cdn)
+            {
+                QNetworkRequest signing = cdnRequest;
+
+                _cdn->_signRequest("GET", signing, CDN::listPurgeOperation, cdnResources);
+            }
+            else
+            {
+                QNetworkRequest signing = request;
+
+                _client->_signRequest("PUT", signing, nosHeaders, Client::objectAction, resources);
+            }
+
+            ++count;
+        }
+    }
+
+    qint64 elapsed = timer.elapsed();
+
+    qInfo("%s: %.0f signatures/s", cdn ? "NCDN" : "NOS", count * 1000.0 / qMax<qint64>(elapsed, 1));
+}
+
+// _nosRequest 按 Client 发请求时的方式准备请求、自定义头和资源，Date 固定
+QNetworkRequest SignerTest::_nosRequest(Client::Action action,
+                                        const QString &bucket,
+                                        const QString &objectKey,
+                                        const QStringHash &params,
+                                        const QByteArray &contentMd5,
+                                        const QString &contentType,
+                                        const QString &copySource,
+                                        QStringMap &nosHeaders,
+                                        QStringHash &resources)
+{
+    resources.clear();
+
+    if (action == Client::objectAction) resources = Client::_objectResources(bucket, objectKey);
+    else if (action == Client::bucketAction) resources.insert("bucket", bucket);
+
+    for (QStringHash::const_iterator ci = params.cbegin(); ci != params.cend(); ++ci)
+        resources.insert(ci.key(), ci.value());
+
+    nosHeaders.clear();
+
+    if (!copySource.isEmpty()) nosHeaders.insert("x-nos-copy-source", PercentEncoder::encode(copySource));
+
+    QString url = "http://nos-eastchina1.126.net/";
+
+    if (action == Client::objectAction) url += resources["object"];
+
+    QNetworkRequest request((QUrl(url)));
+
+    request.setRawHeader("date", Date);
+
+    if (!contentMd5.isEmpty()) request.setRawHeader("content-md5", contentMd5);
+    if (!contentType.isEmpty()) request.setHeader(QNetworkRequest::ContentTypeHeader, contentType);
+
+    for (QStringMap::const_iterator nci = nosHeaders.cbegin(); nci != nosHeaders.cend(); ++nci)
+        request.setRawHeader(nci.key().toUtf8(), nci.value().toUtf8());
+
+    return request;
+}
+
+QTEST_GUILESS_MAIN(SignerTest)
+
+#include "tst_signer.moc"
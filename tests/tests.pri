@@ -0,0 +1,13 @@
+# 各测试、基准共用的设置，在各自的 .pro 中 include
+QT       += testlib
+QT       -= gui
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+QMAKE_CXXFLAGS += -Wno-missing-field-initializers
+
+DEFINES += QT_MESSAGELOGCONTEXT
+
+INCLUDEPATH += $$PWD/..
+DEPENDPATH += $$PWD/..
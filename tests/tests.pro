@@ -0,0 +1,10 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    blockingqueue \
+    networkscaling \
+    percentencoder \
+    requestbuilder \
+    requestcontext \
+    responseparser \
+    signer
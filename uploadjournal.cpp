@@ -0,0 +1,154 @@
+#include "uploadjournal.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+// 分块完成后最多每隔这么久写一次文件，漏记的 ETag 会在续传时通过 listParts 补回
+static const qint64 FlushInterval = 2000;
+
+// Constructor
+UploadJournal::UploadJournal(const QString &path) : _path(path)
+{
+    QDir().mkpath(QFileInfo(_path).absolutePath());
+
+    _load();
+
+    _lastWrite.start();
+}
+
+// Public Methods
+bool UploadJournal::find(const QString &bucket, const QString &objectKey, UploadRecord &record) const
+{
+    QHash<QString, UploadRecord>::const_iterator ci = _records.find(_key(bucket, objectKey));
+
+    if (ci == _records.cend()) return false;
+
+    record = ci.value();
+
+    return true;
+}
+
+void UploadJournal::save(const UploadRecord &record)
+{
+    _records.insert(_key(record.bucket, record.objectKey), record);
+
+    _write();
+}
+
+void UploadJournal::setPart(const QString &bucket, const QString &objectKey, int partNumber, const QString &etag)
+{
+    QHash<QString, UploadRecord>::iterator it = _records.find(_key(bucket, objectKey));
+
+    if (it == _records.end()) return;
+
+    it.value().parts.insert(partNumber, etag);
+
+    _isDirty = true;
+
+    if (_lastWrite.elapsed() >= FlushInterval) _write();
+}
+
+void UploadJournal::remove(const QString &bucket, const QString &objectKey)
+{
+    if (_records.remove(_key(bucket, objectKey)) > 0) _write();
+}
+
+void UploadJournal::flush()
+{
+    if (_isDirty) _write();
+}
+
+// Private Methods
+QString UploadJournal::_key(const QString &bucket, const QString &objectKey)
+{
+    return bucket + "/" + objectKey;
+}
+
+void UploadJournal::_load()
+{
+    QFile file(_path);
+
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(file.readAll());
+
+    file.close();
+
+    foreach (const QJsonValue &value, jsonDoc.object()["uploads"].toArray())
+    {
+        QJsonObject obj = value.toObject();
+
+        UploadRecord record;
+        record.bucket = obj["bucket"].toString();
+        record.objectKey = obj["objectKey"].toString();
+        record.filePath = obj["filePath"].toString();
+        record.fileSize = obj["fileSize"].toString().toLongLong();
+        record.lastModified = obj["lastModified"].toString().toLongLong();
+        record.partSize = obj["partSize"].toString().toLongLong();
+        record.uploadId = obj["uploadId"].toString();
+
+        QJsonObject parts = obj["parts"].toObject();
+
+        for (QJsonObject::const_iterator pci = parts.constBegin(); pci != parts.constEnd(); ++pci)
+            record.parts.insert(pci.key().toInt(), pci.value().toString());
+
+        if (record.uploadId.isEmpty() || record.partSize <= 0) continue;
+
+        _records.insert(_key(record.bucket, record.objectKey), record);
+    }
+}
+
+void UploadJournal::_write()
+{
+    QJsonArray uploads;
+
+    foreach (const UploadRecord &record, _records)
+    {
+        QJsonObject parts;
+
+        QMap<int, QString>::const_iterator pci;
+
+        for (pci = record.parts.cbegin(); pci != record.parts.cend(); ++pci)
+            parts.insert(QString::number(pci.key()), pci.value());
+
+        // 64 位整数以字符串保存，避免 JSON double 精度问题
+        QJsonObject obj = {
+            { "bucket", record.bucket },
+            { "objectKey", record.objectKey },
+            { "filePath", record.filePath },
+            { "fileSize", QString::number(record.fileSize) },
+            { "lastModified", QString::number(record.lastModified) },
+            { "partSize", QString::number(record.partSize) },
+            { "uploadId", record.uploadId },
+            { "parts", parts }
+        };
+
+        uploads.append(obj);
+    }
+
+    QJsonObject root;
+    root.insert("uploads", uploads);
+
+    QSaveFile file(_path);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Open upload journal failure:" << _path;
+
+        return;
+    }
+
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+
+    if (!file.commit()) qWarning() << "Write upload journal failure:" << _path;
+
+    _isDirty = false;
+
+    _lastWrite.restart();
+}
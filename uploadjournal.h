@@ -0,0 +1,48 @@
+#ifndef UPLOADJOURNAL_H
+#define UPLOADJOURNAL_H
+
+#include <QString>
+#include <QHash>
+#include <QMap>
+#include <QElapsedTimer>
+
+typedef struct uploadRecord
+{
+    QString bucket;
+    QString objectKey;
+    QString filePath;
+    qint64 fileSize;
+    qint64 lastModified; // 本地文件修改时间，毫秒
+    qint64 partSize;
+    QString uploadId;
+    QMap<int, QString> parts; // partNumber => ETag
+
+    uploadRecord() : fileSize(0), lastModified(0), partSize(0) {}
+} UploadRecord;
+
+// 记录未完成的大对象上传，程序重启后可继续上传剩余分块
+class UploadJournal
+{
+public:
+    explicit UploadJournal(const QString &path);
+
+    bool find(const QString &bucket, const QString &objectKey, UploadRecord &record) const;
+    void save(const UploadRecord &record);
+    void setPart(const QString &bucket, const QString &objectKey, int partNumber, const QString &etag);
+    void remove(const QString &bucket, const QString &objectKey);
+    void flush();
+
+private:
+    QString _path;
+    QHash<QString, UploadRecord> _records;
+
+    bool _isDirty = false;
+    QElapsedTimer _lastWrite;
+
+    static QString _key(const QString &bucket, const QString &objectKey);
+
+    void _load();
+    void _write();
+};
+
+#endif // UPLOADJOURNAL_H